@@ -0,0 +1,152 @@
+/* Layout of a compiled .cflx file, shared by FileWriter and the interpreter loader.
+ *
+ *   [CflxHeader][CflxSection x sectionCount][section data...]
+ *
+ * Every section starts at a multiple of CFLX_SECTION_ALIGNMENT so the code section (and the tables)
+ * can be used in place from a memory mapped file. Everything is in host byte order.
+ * Loader skips section types it doesn't know, so new optional sections only bump the minor version.
+*/
+#ifndef UNNAMED_CFLX_FORMAT_HPP
+#define UNNAMED_CFLX_FORMAT_HPP
+
+#include <cstdint>
+#include <cstddef>
+
+#define CFLX_VERSION_MAJOR     3  //Bumped when older interpreters can't run the file anymore
+#define CFLX_VERSION_MINOR     2  //Bumped for additions older interpreters can safely ignore
+#define CFLX_VERSION_MAX_STACK 2  //First minor version with CflxFunction::maxStack filled in
+#define CFLX_MODULE_VERSION    4  //Major version of .fluxm files, 4 stopped copying in defines of included modules
+#define CFLX_SECTION_ALIGNMENT 16
+
+constexpr char CFLX_MAGIC[4] = {'C', 'F', 'L', 'X'};
+
+enum CflxFlags : std::uint32_t
+{
+    CFLX_FLAG_NONE            = 0,
+    CFLX_FLAG_HAS_DEBUG_LINES = 1 << 0,
+    CFLX_FLAG_COMPACT_CODE    = 1 << 1, //Code is in CFLX_SECTION_COMPACT_CODE instead of CFLX_SECTION_CODE
+    CFLX_FLAG_MODULE          = 1 << 2  //Precompiled module (.fluxm) imported by the compiler, not something to run
+};
+
+enum CflxSectionType : std::uint32_t
+{
+    CFLX_SECTION_CODE,          //VMInstruction records
+    CFLX_SECTION_CONSTANT_POOL, //CflxConstant records, deduplicated literals referenced by PUSH_CONST
+    CFLX_SECTION_STRING_TABLE,  //'\0' terminated identifiers, offset 0 is always the empty string
+    CFLX_SECTION_FUNCTIONS,     //CflxFunction records, index 0 is main
+    CFLX_SECTION_DEBUG_LINES,   //CflxLine records sorted by code offset (optional)
+    CFLX_SECTION_EXPORTS,       //CflxExport records, top level functions visible to other modules
+    CFLX_SECTION_COMPACT_CODE,  //Variable length encoded code (see below), expanded to VMInstruction records on load
+    CFLX_SECTION_DEFINES,       //CflxDefine records, everything a module defines itself (modules only)
+    CFLX_SECTION_INCLUDES       //uint32 string table offsets, files a module includes in order (modules only)
+};
+
+/* Compact code encoding, one opcode byte followed by its operand (operand kind of every opcode is in opcode_table.hpp):
+ *  - Slots, frame sizes, builtin ids, shifts, iterator params, counts, PUSH_UINT64, PUSH_CONST: ULEB128
+ *  - Variable instructions: slot ULEB128, scope index ULEB128
+ *  - PUSH_INT64: SLEB128, PUSH_FLOAT: raw 8 bytes
+ *  - JUMP, JUMP_IF_FALSE, ITER_HAS_NEXT, ITER_NEXT: int32 relative to the instruction itself
+ *  - FUNC_CALL: ULEB128 function index
+ *  - RETURN: ULEB128 of (FUNC_END index << 1 | returns value)
+ * Offsets are in instructions, not bytes, so descriptors and line table mean the same thing in both encodings.
+ * Every function starts at its descriptor's compactOffset, so each one can be expanded on its own.
+ * These short forms exist only in compact code, the loader expands them.
+*/
+enum CflxCompactInstruction : std::uint8_t
+{
+    PUSH_SMALL_INT = 0xF0, //int8 inline             -> PUSH_INT64
+    JUMP_SHORT,            //int8 relative offset    -> JUMP
+    JUMP_SHORT16           //int16 relative offset   -> JUMP
+};
+
+struct CflxHeader
+{
+    char          magic[4];
+    std::uint16_t versionMajor;
+    std::uint16_t versionMinor;
+    std::uint32_t flags;
+    std::uint32_t sectionCount;
+    std::uint64_t checksum; //FNV-1a of everything after the header
+    std::uint64_t reserved;
+};
+
+struct CflxSection
+{
+    std::uint32_t type;
+    std::uint32_t reserved;
+    std::uint64_t offset; //From the start of the file
+    std::uint64_t size;   //In bytes
+};
+
+enum CflxFunctionFlags : std::uint8_t
+{
+    CFLX_FUNCTION_NONE          = 0,
+    CFLX_FUNCTION_RETURNS_VALUE = 1 << 0 //Some RETURN in the body returns a value, callers may USE_RETURN_VAL
+};
+
+//Where a function sits in code and how to call it, so a caller can be checked without looking at the body.
+//FUNC_CALL operand is the index of the callee in the function table
+struct CflxFunction
+{
+    std::uint64_t codeOffset;    //In instructions
+    std::uint64_t codeLength;    //In instructions, last one is FUNC_END (END_OF_FILE for main)
+    std::uint32_t nameOffset;    //Into string table
+    std::uint16_t frameSize;
+    std::uint16_t paramCount;
+    std::uint8_t  vargsType;     //EVAL_UNKNOWN if function doesn't take vargs
+    std::uint8_t  flags;         //CflxFunctionFlags
+    std::uint16_t maxStack;      //Deepest the operand stack gets inside of the function, params included (0 before 3.2)
+    std::uint32_t compactOffset; //In bytes into compact code section, only with CFLX_FLAG_COMPACT_CODE
+};
+
+//Int or Float literal, stored as raw 64 bits
+struct CflxConstant
+{
+    std::uint64_t bits;
+    std::uint8_t  type; //EVAL_INT or EVAL_FLOAT
+    std::uint8_t  reserved[7];
+};
+
+//Source line (in the file the statement came from, same as compiler errors) of the statement starting at codeOffset
+struct CflxLine
+{
+    std::uint32_t codeOffset;
+    std::uint32_t line;
+};
+
+struct CflxExport
+{
+    std::uint32_t nameOffset;
+    std::uint32_t functionIndex;
+};
+
+//'define key value' of a precompiled module
+struct CflxDefine
+{
+    std::uint32_t keyOffset;   //Into string table
+    std::uint32_t valueOffset; //Into string table
+};
+
+static_assert(sizeof(CflxHeader)   == 32, "CflxHeader is the on disk format");
+static_assert(sizeof(CflxSection)  == 24, "CflxSection is the on disk format");
+static_assert(sizeof(CflxFunction) == 32, "CflxFunction is the on disk format");
+static_assert(sizeof(CflxConstant) == 16, "CflxConstant is the on disk format");
+static_assert(sizeof(CflxLine)     == 8,  "CflxLine is the on disk format");
+static_assert(sizeof(CflxExport)   == 8,  "CflxExport is the on disk format");
+static_assert(sizeof(CflxDefine)   == 8,  "CflxDefine is the on disk format");
+
+#define CFLX_CHECKSUM_SEED 14695981039346656037ULL
+
+//FNV-1a, 64bit. Data can be given in pieces, 'hash' of the next piece is whatever the previous one returned
+inline std::uint64_t cflxChecksum(const void* data, std::size_t size, std::uint64_t hash = CFLX_CHECKSUM_SEED)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+
+    for (std::size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+#endif
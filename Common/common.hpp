@@ -4,7 +4,6 @@
 
 #include <cstdint>
 #include <cstring>
-#include <variant>
 #include <tuple>
 #include <unordered_map>
 #include <vector>
@@ -43,6 +42,8 @@ enum ILInstruction : std::uint8_t
     PUSH_INT64,
     PUSH_UINT64,
     PUSH_FLOAT,
+    //Literal from the constant pool (FileWriter turns every PUSH_INT64 / PUSH_FLOAT into this)
+    PUSH_CONST,
     //Arithmetic instructions
     ADD,
     SUB,
@@ -52,6 +53,14 @@ enum ILInstruction : std::uint8_t
     POW,
     //Unary instructions (NEGATION, etc)
     NEG,
+    //Strength reduced arithmetic instructions (emitted by StrengthReducer)
+    IPOW,
+    MUL_POW2,
+    DIV_POW2,
+    MOD_POW2,
+    DUP,
+    //Discard value of an expression statement
+    POP,
     //Variable instructions
     ASSIGN_VAR,
     ASSIGN_VAR_NO_POP,
@@ -83,11 +92,10 @@ enum ILInstruction : std::uint8_t
     ITER_NEXT,
     ITER_CURRENT,
     ITER_RECALC_STEP,
+    ITER_END,
     DATAINST_ITER_ID,
-    //Scope symbol table related operation
-    CREATE_SYMBOL_TABLE,
-    DESTROY_SYMBOL_TABLE,
-    DESTROY_MULTIPLE_SYMBOL_TABLES, //Multiple levels
+    //Frame related operation (size of the frame is known at compile time)
+    ALLOC_FRAME,
     //Functions, Return
     FUNC_START,
     FUNC_VARGS,
@@ -96,7 +104,7 @@ enum ILInstruction : std::uint8_t
     FUNC_END,
     RETURN,
     USE_RETURN_VAL,
-    //EOF
+    //EOF, also the last valid opcode (anything above is malformed bytecode)
     END_OF_FILE
 };
 
@@ -110,25 +118,45 @@ enum BuiltinType : std::uint8_t
     BUILTIN_SQRT,
     BUILTIN_GAMMA,
     //TIME
-    BUILTIN_GETTIME
+    BUILTIN_GETTIME,
+    //Number of builtins, not a builtin itself
+    BUILTIN_COUNT
 };
 
-//----------------------INSTRUCTION----------------------
-using InstructionValue = std::variant<std::int64_t, std::uint64_t, double, std::uint16_t, std::string>;
-struct Instruction
+//----------------------VARIABLE FRAMES----------------------
+//Block scopes are resolved at compile time, every variable ends up in a fixed slot of either the global frame
+//or the frame of the function it is declared in. Variable instructions carry the slot as value and this as scope index
+enum FrameType : std::uint8_t
 {
-    InstructionValue value;
-    ILInstruction    inst;
+    GLOBAL_FRAME,
+    LOCAL_FRAME
+};
 
-    //Additional data, for scope indexing (for instructions like ACCESS_VAR or ASSIGN_VAR)
-    //Idk why im having this as a literal 16bit value but ight
-    std::uint16_t scopeIndexIfNeeded;
+//----------------------ENCODED INSTRUCTION----------------------
+//Exactly how an instruction sits in a .cflx file and in memory, interpreter executes straight out of the mapped file.
+//Every record is 16 bytes and 8 byte aligned, all operands are relative (jumps to the start of their function,
+//FUNC_CALL to the start of the code) so the code runs wherever it gets mapped. Host byte order, same as before
+struct VMInstruction
+{
+    union {
+        std::int64_t  i64;
+        std::uint64_t u64; //Jump offsets, call targets, return params, vargs count
+        double        f64;
+        std::uint32_t u32; //Constant pool index
+        std::uint16_t u16; //Slots, builtin ids, shifts, frame sizes, iterator params
+    } operand;
+    ILInstruction inst;
+    std::uint8_t  reserved;   //Always 0
+    std::uint16_t scopeIndex; //FrameType for variable instructions
+    std::uint32_t reserved2;  //Always 0, pads the record to 16 bytes
 
-    Instruction(ILInstruction inst, InstructionValue&& value = {}, std::uint16_t scopeIndex = 0)
-        : inst(inst), value(std::move(value)), scopeIndexIfNeeded(scopeIndex)
+    VMInstruction() = default;
+    VMInstruction(ILInstruction inst)
+        : operand{0}, inst(inst), reserved(0), scopeIndex(0), reserved2(0)
     {}
 };
-using ListOfInstruction = std::vector<Instruction>;
+static_assert(sizeof(VMInstruction) == 16 && alignof(VMInstruction) == 8, "VMInstruction is the on disk format, keep it 16 bytes");
+using ListOfVMInstruction = std::vector<VMInstruction>;
 
 //----------------------File extension checker----------------------
 static bool checkFileExt(const char* const EXT, const char* filename)
@@ -140,59 +168,4 @@ static bool checkFileExt(const char* const EXT, const char* filename)
     
     return true;
 }
-
-//----------PURELY FOR DEBUGGING PURPOSES----------
-static const char* const ILInstructionToString(ILInstruction inst) {
-    static constexpr const char* const ILInstructionStrings[] = {
-        "PUSH_INT64",
-        "PUSH_UINT64",
-        "PUSH_FLOAT",
-        "ADD",
-        "SUB",
-        "MUL",
-        "DIV",
-        "MOD",
-        "POW",
-        "NEG",
-        "ASSIGN_VAR",
-        "ASSIGN_VAR_NO_POP",
-        "REASSIGN_VAR",
-        "REASSIGN_VAR_NO_POP",
-        "ACCESS_VAR",
-        "CAST_INT",
-        "CAST_FLOAT",
-        "CMP_EQ",
-        "CMP_NEQ",
-        "CMP_GT",
-        "CMP_LT",
-        "CMP_GTEQ",
-        "CMP_LTEQ",
-        "CMP_IS",
-        "AND",
-        "OR",
-        "NOT",
-        "JUMP_IF_FALSE",
-        "JUMP",
-        "ITER_INIT",
-        "ITER_HAS_NEXT",
-        "ITER_NEXT",
-        "ITER_CURRENT",
-        "ITER_RECALC_STEP",
-        "DATAINST_ITER_ID",
-        "CREATE_SYMBOL_TABLE",
-        "DESTROY_SYMBOL_TABLE",
-        "DESTROY_MULTIPLE_SYMBOL_TABLES",
-        "FUNC_START",
-        "FUNC_VARGS",
-        "FUNC_CALL",
-        "BUILTIN_CALL",
-        "FUNC_END",
-        "RETURN",
-        "USE_RETURN_VAL",
-        "END_OF_FILE"
-    };
-
-    // Convert enum value to string
-    return ILInstructionStrings[static_cast<std::size_t>(inst)];
-}
 #endif
\ No newline at end of file
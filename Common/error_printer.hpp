@@ -4,6 +4,9 @@
 #include <string>
 #include <cstdint>
 #include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
 
 #include "..\Compiler\lexer.hpp"
 #include "..\Common\common.hpp" //EvalType
@@ -22,7 +25,21 @@ struct ConsoleTextColors
                                * UNDERLINE = "\033[4m";
 };
 
-static void printError(const std::string& errorSection, const std::string& errorMsg)
+//Set by the compiler when traces are on (see Compiler/trace.hpp), whatever was traced up to the error isn't lost
+inline void (*flushTracesBeforeExit)() = nullptr;
+
+//Errors end the process right away. Static destructors are skipped, other units compiling at the same time (-j)
+//may still be using globals like the type checker tables, so output is flushed by hand instead
+[[noreturn]] static void exitAfterError()
+{
+    if(flushTracesBeforeExit != nullptr)
+        flushTracesBeforeExit();
+    std::cout.flush();
+    std::fflush(stdout);
+    std::_Exit(1);
+}
+
+[[noreturn]] static void printError(const std::string& errorSection, const std::string& errorMsg)
 {
     auto [cur_line, cur_col] = Lexer::getLineColCount();
     std::cout << ConsoleTextColors::FAIL
@@ -33,11 +50,11 @@ static void printError(const std::string& errorSection, const std::string& error
               << ConsoleTextColors::WARNING
                 << "[Error info]: Error came from -> Line: " << cur_line << ", Column: " << cur_col
               << ConsoleTextColors::ENDC << '\n';
-    std::exit(1);
+    exitAfterError();
 }
 
 template<typename... Args>
-static void printError(const std::string& errorSection, const std::string& errorMsg, Args&&... args)
+[[noreturn]] static void printError(const std::string& errorSection, const std::string& errorMsg, Args&&... args)
 {
     auto [cur_line, cur_col] = Lexer::getLineColCount();
     std::cout << ConsoleTextColors::FAIL
@@ -52,19 +69,19 @@ static void printError(const std::string& errorSection, const std::string& error
               << ConsoleTextColors::WARNING
                 << "[Error info]: Error came from -> Line: " << cur_line << ", Column: " << cur_col
               << ConsoleTextColors::ENDC << '\n';
-    std::exit(1);
+    exitAfterError();
 }
 
 //For ILGen errors specifically, normally there shouldnt be a single error in this
-static void printError(const std::string& errorMsg, EvalType type)
+[[noreturn]] static void printError(const std::string& errorMsg, EvalType type)
 {
     std::cout << ConsoleTextColors::FAIL << "[ILGeneratorError]: " << errorMsg << (int)type << ConsoleTextColors::ENDC << '\n';
-    std::exit(1);
+    exitAfterError();
 }
-static void printError(const std::string& errorMsg, TokenType type)
+[[noreturn]] static void printError(const std::string& errorMsg, TokenType type)
 {
     std::cout << ConsoleTextColors::FAIL << "[ILGeneratorError]: " << errorMsg << (int)type << ConsoleTextColors::ENDC << '\n';
-    std::exit(1);
+    exitAfterError();
 }
 
 //I might as well have this print warnings as well ig
@@ -78,15 +95,32 @@ static void printWarning(const std::string& warningSection, const std::string& w
               << ConsoleTextColors::ENDC << '\n';
 }
 
-//RuntimeErrors
-static void printRuntimeError(const std::string& errorSection, const std::string& errorMsg)
+//RuntimeErrors. Functions may be verified on several threads at once, first one to fail reports and ends the process,
+//any other one stays here till it does
+inline std::mutex runtimeErrorLock;
+
+[[noreturn]] static void printRuntimeError(const std::string& errorSection, const std::string& errorMsg)
 {
+    runtimeErrorLock.lock();
     std::cout << ConsoleTextColors::FAIL
                 << "[" << errorSection << "]: "
                 << errorMsg
               << ConsoleTextColors::ENDC << '\n';
-              
-    std::exit(1);
+    exitAfterError();
+}
+
+template<typename... Args>
+[[noreturn]] static void printRuntimeError(const std::string& errorSection, const std::string& errorMsg, Args&&... args)
+{
+    runtimeErrorLock.lock();
+    std::cout << ConsoleTextColors::FAIL
+                << "[" << errorSection << "]: "
+              << errorMsg;
+
+    ((std::cout << args), ...);
+
+    std::cout << ConsoleTextColors::ENDC << '\n';
+    exitAfterError();
 }
 
 
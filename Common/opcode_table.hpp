@@ -0,0 +1,172 @@
+/* Everything there is to know about an opcode, in one place: name, where its operand lives and how compact code
+ * encodes it, what it does to the operand stack and where execution goes after it.
+ * ILGenerator, FileWriter (encoder and stack depth analysis), compact decoder, verifier and the IL listing all read
+ * it from here, adding an opcode means adding its row and nothing falls out of sync.
+*/
+#ifndef UNNAMED_OPCODE_TABLE_HPP
+#define UNNAMED_OPCODE_TABLE_HPP
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+
+#include "common.hpp"
+
+//Which VMInstruction field holds the operand, and how compact code stores it (see cflx_format.hpp)
+enum OperandKind : std::uint8_t
+{
+    OPERAND_NONE,
+    OPERAND_INT64,  //operand.i64, SLEB128 (PUSH_SMALL_INT for int8)
+    OPERAND_FLOAT,  //operand.f64, raw 8 bytes
+    OPERAND_UINT64, //operand.u64, ULEB128
+    OPERAND_CONST,  //operand.u32 constant pool index, ULEB128
+    OPERAND_UINT16, //operand.u16, ULEB128
+    OPERAND_SLOT,   //operand.u16 slot and scopeIndex, ULEB128 each
+    OPERAND_TARGET, //operand.u64 index inside of the function, int32 relative to the instruction (JUMP has short forms)
+    OPERAND_RETURN  //operand.u64 FUNC_END index | RETURN_VALUE_BIT, ULEB128 of (index << 1 | returns value)
+};
+
+//Where execution goes after the instruction
+enum BranchKind : std::uint8_t
+{
+    BRANCH_NONE,        //Next instruction
+    BRANCH_CONDITIONAL, //Operand target or next instruction
+    BRANCH_ALWAYS,      //Operand target
+    BRANCH_RETURN,      //FUNC_END of the same function (operand without RETURN_VALUE_BIT)
+    BRANCH_END          //Nowhere, function (or program) is done
+};
+
+//Stack effect depends on the operand or the callee, whoever needs it works it out from there
+#define STACK_VARIABLE UINT8_MAX
+
+//Top bit of RETURN operand, set when a value is returned
+constexpr std::uint64_t RETURN_VALUE_BIT = (std::uint64_t)1 << (sizeof(std::uint64_t) * CHAR_BIT - 1);
+
+struct OpcodeInfo
+{
+    ILInstruction inst; //Same as its index, only there so the table can be checked against the enum
+    const char*   name;
+    OperandKind   operand;
+    std::uint8_t  pops;
+    std::uint8_t  pushes;
+    BranchKind    branch;
+};
+
+constexpr OpcodeInfo opcodeTable[] = {
+    //inst                 name                   operand          pops            pushes          branch
+    {PUSH_INT64,          "PUSH_INT64",          OPERAND_INT64,   0,              1,              BRANCH_NONE       },
+    {PUSH_UINT64,         "PUSH_UINT64",         OPERAND_UINT64,  0,              1,              BRANCH_NONE       },
+    {PUSH_FLOAT,          "PUSH_FLOAT",          OPERAND_FLOAT,   0,              1,              BRANCH_NONE       },
+    {PUSH_CONST,          "PUSH_CONST",          OPERAND_CONST,   0,              1,              BRANCH_NONE       },
+    {ADD,                 "ADD",                 OPERAND_NONE,    2,              1,              BRANCH_NONE       },
+    {SUB,                 "SUB",                 OPERAND_NONE,    2,              1,              BRANCH_NONE       },
+    {MUL,                 "MUL",                 OPERAND_NONE,    2,              1,              BRANCH_NONE       },
+    {DIV,                 "DIV",                 OPERAND_NONE,    2,              1,              BRANCH_NONE       },
+    {MOD,                 "MOD",                 OPERAND_NONE,    2,              1,              BRANCH_NONE       },
+    {POW,                 "POW",                 OPERAND_NONE,    2,              1,              BRANCH_NONE       },
+    {NEG,                 "NEG",                 OPERAND_NONE,    1,              1,              BRANCH_NONE       },
+    {IPOW,                "IPOW",                OPERAND_NONE,    2,              1,              BRANCH_NONE       },
+    {MUL_POW2,            "MUL_POW2",            OPERAND_UINT16,  1,              1,              BRANCH_NONE       },
+    {DIV_POW2,            "DIV_POW2",            OPERAND_UINT16,  1,              1,              BRANCH_NONE       },
+    {MOD_POW2,            "MOD_POW2",            OPERAND_UINT16,  1,              1,              BRANCH_NONE       },
+    {DUP,                 "DUP",                 OPERAND_NONE,    1,              2,              BRANCH_NONE       },
+    {POP,                 "POP",                 OPERAND_NONE,    1,              0,              BRANCH_NONE       },
+    {ASSIGN_VAR,          "ASSIGN_VAR",          OPERAND_SLOT,    1,              0,              BRANCH_NONE       },
+    {ASSIGN_VAR_NO_POP,   "ASSIGN_VAR_NO_POP",   OPERAND_SLOT,    1,              1,              BRANCH_NONE       },
+    {REASSIGN_VAR,        "REASSIGN_VAR",        OPERAND_SLOT,    1,              0,              BRANCH_NONE       },
+    {REASSIGN_VAR_NO_POP, "REASSIGN_VAR_NO_POP", OPERAND_SLOT,    1,              1,              BRANCH_NONE       },
+    {ACCESS_VAR,          "ACCESS_VAR",          OPERAND_SLOT,    0,              1,              BRANCH_NONE       },
+    {CAST_INT,            "CAST_INT",            OPERAND_NONE,    1,              1,              BRANCH_NONE       },
+    {CAST_FLOAT,          "CAST_FLOAT",          OPERAND_NONE,    1,              1,              BRANCH_NONE       },
+    {CMP_EQ,              "CMP_EQ",              OPERAND_NONE,    2,              1,              BRANCH_NONE       },
+    {CMP_NEQ,             "CMP_NEQ",             OPERAND_NONE,    2,              1,              BRANCH_NONE       },
+    {CMP_GT,              "CMP_GT",              OPERAND_NONE,    2,              1,              BRANCH_NONE       },
+    {CMP_LT,              "CMP_LT",              OPERAND_NONE,    2,              1,              BRANCH_NONE       },
+    {CMP_GTEQ,            "CMP_GTEQ",            OPERAND_NONE,    2,              1,              BRANCH_NONE       },
+    {CMP_LTEQ,            "CMP_LTEQ",            OPERAND_NONE,    2,              1,              BRANCH_NONE       },
+    {CMP_IS,              "CMP_IS",              OPERAND_NONE,    2,              1,              BRANCH_NONE       },
+    {AND,                 "AND",                 OPERAND_NONE,    2,              1,              BRANCH_NONE       },
+    {OR,                  "OR",                  OPERAND_NONE,    2,              1,              BRANCH_NONE       },
+    {NOT,                 "NOT",                 OPERAND_NONE,    1,              1,              BRANCH_NONE       },
+    {JUMP_IF_FALSE,       "JUMP_IF_FALSE",       OPERAND_TARGET,  1,              0,              BRANCH_CONDITIONAL},
+    {JUMP,                "JUMP",                OPERAND_TARGET,  0,              0,              BRANCH_ALWAYS     },
+    //Range iterator takes start, stop and step off the stack, ellipsis iterator nothing
+    {ITER_INIT,           "ITER_INIT",           OPERAND_UINT16,  STACK_VARIABLE, 0,              BRANCH_NONE       },
+    {ITER_HAS_NEXT,       "ITER_HAS_NEXT",       OPERAND_TARGET,  0,              0,              BRANCH_CONDITIONAL},
+    {ITER_NEXT,           "ITER_NEXT",           OPERAND_TARGET,  0,              0,              BRANCH_ALWAYS     },
+    {ITER_CURRENT,        "ITER_CURRENT",        OPERAND_NONE,    0,              0,              BRANCH_NONE       },
+    {ITER_RECALC_STEP,    "ITER_RECALC_STEP",    OPERAND_NONE,    0,              0,              BRANCH_NONE       },
+    {ITER_END,            "ITER_END",            OPERAND_NONE,    0,              0,              BRANCH_NONE       },
+    {DATAINST_ITER_ID,    "DATAINST_ITER_ID",    OPERAND_SLOT,    0,              0,              BRANCH_NONE       },
+    {ALLOC_FRAME,         "ALLOC_FRAME",         OPERAND_UINT16,  0,              0,              BRANCH_NONE       },
+    //Only in IL, never inside of a function body
+    {FUNC_START,          "FUNC_START",          OPERAND_NONE,    0,              0,              BRANCH_NONE       },
+    {FUNC_VARGS,          "FUNC_VARGS",          OPERAND_UINT64,  0,              1,              BRANCH_NONE       },
+    //Params, vargs, vargs count and return address of the callee
+    {FUNC_CALL,           "FUNC_CALL",           OPERAND_UINT64,  STACK_VARIABLE, 0,              BRANCH_NONE       },
+    //See builtinSignatures
+    {BUILTIN_CALL,        "BUILTIN_CALL",        OPERAND_UINT16,  STACK_VARIABLE, STACK_VARIABLE, BRANCH_NONE       },
+    {FUNC_END,            "FUNC_END",            OPERAND_UINT16,  0,              0,              BRANCH_END        },
+    //Returned value, if there is one
+    {RETURN,              "RETURN",              OPERAND_RETURN,  STACK_VARIABLE, 0,              BRANCH_RETURN     },
+    {USE_RETURN_VAL,      "USE_RETURN_VAL",      OPERAND_NONE,    0,              1,              BRANCH_NONE       },
+    {END_OF_FILE,         "END_OF_FILE",         OPERAND_NONE,    0,              0,              BRANCH_END        }
+};
+
+constexpr bool opcodeTableMatchesEnum()
+{
+    for (std::size_t i = 0; i < sizeof(opcodeTable) / sizeof(opcodeTable[0]); ++i)
+        if(opcodeTable[i].inst != i)
+            return false;
+    return true;
+}
+static_assert(sizeof(opcodeTable) / sizeof(opcodeTable[0]) == END_OF_FILE + 1 && opcodeTableMatchesEnum(),
+              "opcodeTable has to have a row for every ILInstruction, in the same order");
+
+//Verifier rejects anything above END_OF_FILE before looking it up
+constexpr const OpcodeInfo& opcodeInfo(ILInstruction inst) {
+    return opcodeTable[inst];
+}
+
+//Bytes of the VMInstruction operand the kind uses
+constexpr std::size_t operandSize(OperandKind kind)
+{
+    switch (kind)
+    {
+        case OPERAND_NONE:   return 0;
+        case OPERAND_UINT16:
+        case OPERAND_SLOT:   return sizeof(std::uint16_t);
+        case OPERAND_CONST:  return sizeof(std::uint32_t);
+        default:             return sizeof(std::uint64_t);
+    }
+}
+
+//----------PURELY FOR DEBUGGING PURPOSES----------
+inline const char* ILInstructionToString(ILInstruction inst) {
+    return opcodeInfo(inst).name;
+}
+
+//----------------------BUILTIN SIGNATURES----------------------
+//Argument count for builtins taking vargs (count is pushed on stack right before the call)
+#define BUILTIN_VARGS UINT8_MAX
+
+//What BUILTIN_CALL does to the stack, indexed by BuiltinType
+struct BuiltinSignature
+{
+    std::uint8_t argCount;
+    bool         returnsValue;
+};
+
+constexpr BuiltinSignature builtinSignatures[] = {
+    //IO
+    {BUILTIN_VARGS, false}, //BUILTIN_WRITE_CONSOLE
+    {0,             true }, //BUILTIN_IREAD_CONSOLE
+    //MATH
+    {1,             true }, //BUILTIN_SQRT
+    {1,             true }, //BUILTIN_GAMMA
+    //TIME
+    {0,             true }  //BUILTIN_GETTIME
+};
+static_assert(sizeof(builtinSignatures) / sizeof(builtinSignatures[0]) == BUILTIN_COUNT, "Every builtin needs a signature");
+
+#endif
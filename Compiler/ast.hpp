@@ -6,21 +6,24 @@
 #ifndef UNNAMED_AST_HPP
 #define UNNAMED_AST_HPP
 
+#include <array>
 #include <memory>
 #include <string>
 #include "..\Common\common.hpp"
 #include "..\Common\error_printer.hpp"
 #include "type_checker.hpp"
+#include "ast_arena.hpp"
+#include "symbol_interner.hpp"
 
-//Forward declare cuz the below std::unique_ptr is going to cry if not done
 struct ASTNode;
 
-using ASTPtr    = std::unique_ptr<ASTNode>;
+//Nodes live in the ASTArena of the Parser that created them, nobody else owns or frees them
+using ASTPtr    = ASTNode*;
 using ASTRawPtr = ASTNode*;
 
-using ListOfASTPtr = std::vector<ASTPtr>;
+using ListOfASTPtr = ASTSlice<ASTPtr>;
 
-using FuncParams = std::vector<std::pair<EvalType, std::string>>;
+using FuncParams = ASTSlice<std::pair<EvalType, SymbolId>>;
 using FuncArgs   = ListOfASTPtr;
 
 //This thing will at max work for enum values under 64, cuz std::size_t aint 128bit
@@ -38,6 +41,42 @@ constexpr std::size_t termExprTypeMask = (1ULL << static_cast<std::size_t>(TOKEN
 //Used for comparing token type in a type mask
 #define SAME_PRECEDENCE_MASK_CHECK(token, mask) (((1ULL << static_cast<std::size_t>(token)) & mask))
 
+//Binding power of binary operators, higher binds tighter
+enum OperatorPrecedence : std::uint8_t {
+    PRECEDENCE_NONE,       //Not a binary operator
+    PRECEDENCE_LOGICAL,    //&& ||
+    PRECEDENCE_COMPARISON, //comparisionTypeMask, 'is' and '!' work on this level as well
+    PRECEDENCE_ARITH,      //+ -
+    PRECEDENCE_TERM,       //termExprTypeMask
+    PRECEDENCE_POWER       //^, right side can have unary +/- (2 ^ -1)
+};
+
+struct BinaryOperatorInfo
+{
+    OperatorPrecedence precedence     = PRECEDENCE_NONE;
+    bool               is_right_assoc = false;
+};
+
+//Indexed by TokenType, used by Parser::parse_binary_expr
+constexpr std::array<BinaryOperatorInfo, TOKEN_ELLIPSIS + 1> binaryOperatorTable = [] {
+    std::array<BinaryOperatorInfo, TOKEN_ELLIPSIS + 1> table{};
+
+    for (std::size_t type = 0; type < table.size(); ++type)
+    {
+        if(SAME_PRECEDENCE_MASK_CHECK(type, comparisionTypeMask))
+            table[type].precedence = PRECEDENCE_COMPARISON;
+        else if(SAME_PRECEDENCE_MASK_CHECK(type, termExprTypeMask))
+            table[type].precedence = PRECEDENCE_TERM;
+    }
+
+    table[TOKEN_AND]   = {PRECEDENCE_LOGICAL, false};
+    table[TOKEN_OR]    = {PRECEDENCE_LOGICAL, false};
+    table[TOKEN_PLUS]  = {PRECEDENCE_ARITH,   false};
+    table[TOKEN_MINUS] = {PRECEDENCE_ARITH,   false};
+    table[TOKEN_POW]   = {PRECEDENCE_POWER,   true};
+    return table;
+}();
+
 //Some enums for Compile time evaluation / necessary tags used in Compiler
 enum class ASTTag {
     NA,
@@ -46,11 +85,35 @@ enum class ASTTag {
     Unary,
     VarAccess,
     Cast,
+    Ternary,
     Return,
     FunctionCall,
+    BuiltinFunctionCall,
     Dummy
 };
 
+//Set by StrengthReducer, tells ILGenerator to emit a cheaper instruction sequence for a binary operation
+enum class ASTReduction : std::uint8_t {
+    None,
+    Square,       //x ^ 2   -> DUP, MUL
+    MulChain,     //x ^ N   -> DUP/MUL chain (small constant N)
+    IntPow,       //x ^ y   -> IPOW (both Int)
+    MulPow2,      //x * 2^N -> MUL_POW2 N
+    DivPow2,      //x / 2^N -> DIV_POW2 N
+    ModPow2,      //x % 2^N -> MOD_POW2 N
+    InductionVar  //i * C   -> ACCESS_VAR of a derived induction variable (For loops only)
+};
+
+//Derived induction variable for 'i * C' inside of a For loop, replaces the multiplication by an addition per iteration
+struct InductionVariable
+{
+    SymbolId      identifier;  //Hidden name, '$' can never be lexed so it wont clash with user variables
+    std::uint16_t scope_index; //Same frame as the For loop identifier
+    std::uint16_t slot;        //Extra slot allocated in that frame by StrengthReducer
+    std::int64_t  initial;     //(start - step) * C, so the first increment gives start * C
+    std::int64_t  step;        //step * C
+};
+
 //For the visitor pattern, we need to forward declare all the ast nodes
 struct ASTValue;
 struct ASTBinaryOp;
@@ -104,7 +167,10 @@ class ASTVisitorInterface
 //AST nodes
 struct ASTNode
 {
-    virtual ~ASTNode() = default;
+    //Line where the statement starts (in the file it came from), only set for statements, used for debug line table
+    std::uint32_t line = 0;
+
+    //No virtual destructor on purpose, arena destroys nodes as their real type (and skips the ones with nothing to destroy)
 
     //Visitor
     virtual void accept(ASTVisitorInterface& visitor, bool is_sub_expr) = 0;
@@ -122,11 +188,11 @@ struct ASTNode
 //-----------------------------AST Types-----------------------------
 struct ASTValue : public ASTNode
 {
-    EvalType    type;
-    std::string value;
+    EvalType         type;
+    std::string_view value; //Into the arena, names are interned (SymbolId) but literals stay text
 
-    ASTValue(EvalType type, const std::string& value)
-        : type(type), value(std::move(value))
+    ASTValue(EvalType type, std::string_view value)
+        : type(type), value(value)
     {}
 
     void accept(ASTVisitorInterface& visitor, bool is_sub_expr) override {
@@ -149,8 +215,13 @@ struct ASTBinaryOp : public ASTNode
     ASTPtr left;
     ASTPtr right;
 
-    ASTBinaryOp(TokenType op_type, ASTPtr&& left, ASTPtr&& right)
-        : op_type(op_type), left(std::move(left)), right(std::move(right))
+    //Strength reduction info, operand is either the exponent or the shift amount
+    ASTReduction             reduction         = ASTReduction::None;
+    std::int64_t             reduction_operand = 0;
+    const InductionVariable* induction_var     = nullptr;
+
+    ASTBinaryOp(TokenType op_type, ASTPtr left, ASTPtr right)
+        : op_type(op_type), left(left), right(right)
     {}
 
     void accept(ASTVisitorInterface& visitor, bool is_sub_expr) override {
@@ -178,8 +249,8 @@ struct ASTUnaryOp : public ASTNode
     TokenType op_type;
     ASTPtr    expr;
 
-    ASTUnaryOp(TokenType op_type, ASTPtr&& expr)
-        : op_type(op_type), expr(std::move(expr))
+    ASTUnaryOp(TokenType op_type, ASTPtr expr)
+        : op_type(op_type), expr(expr)
     {}
 
     void accept(ASTVisitorInterface& visitor, bool is_sub_expr) override {
@@ -204,15 +275,16 @@ struct ASTUnaryOp : public ASTNode
 
 struct ASTVariableAssign : public ASTNode
 {
-    std::string  identifier;
+    SymbolId     identifier;
     ASTPtr       expr;
     EvalType     var_type;
     bool         is_reassignment;
     //Same here as VariableAccess
     std::uint16_t scope_index;
+    std::uint16_t slot;
 
-    ASTVariableAssign(const std::string& identifier, EvalType type, ASTPtr&& expr, bool is_reassignment, std::uint16_t scope_index)
-        : identifier(std::move(identifier)), var_type(type), expr(std::move(expr)), is_reassignment(is_reassignment), scope_index(scope_index)
+    ASTVariableAssign(SymbolId identifier, EvalType type, ASTPtr expr, bool is_reassignment, std::uint16_t scope_index, std::uint16_t slot)
+        : identifier(identifier), var_type(type), expr(expr), is_reassignment(is_reassignment), scope_index(scope_index), slot(slot)
     {}
 
     void accept(ASTVisitorInterface& visitor, bool is_sub_expr) override {
@@ -226,13 +298,14 @@ struct ASTVariableAssign : public ASTNode
 
 struct ASTVariableAccess : public ASTNode
 {
-    std::string identifier;
-    EvalType    var_type;
-    //Maintain the scope in which the variable is present
+    SymbolId         identifier;
+    EvalType         var_type;
+    //Maintain the frame (FrameType) in which the variable is present and its slot in that frame
     std::uint16_t scope_index;
+    std::uint16_t slot;
 
-    ASTVariableAccess(const std::string& identifier, EvalType type, std::uint16_t scope_index)
-        : identifier(std::move(identifier)), var_type(type), scope_index(scope_index)
+    ASTVariableAccess(SymbolId identifier, EvalType type, std::uint16_t scope_index, std::uint16_t slot)
+        : identifier(identifier), var_type(type), scope_index(scope_index), slot(slot)
     {}
 
     void accept(ASTVisitorInterface& visitor, bool is_sub_expr) override {
@@ -258,8 +331,8 @@ struct ASTCastNode : public ASTNode
     EvalType eval_type;
     ASTPtr   eval_expr;
 
-    ASTCastNode(EvalType eval_type, ASTPtr&& expr)
-        : eval_type(eval_type), eval_expr(std::move(expr))
+    ASTCastNode(EvalType eval_type, ASTPtr expr)
+        : eval_type(eval_type), eval_expr(expr)
     {}
 
     void accept(ASTVisitorInterface& visitor, bool is_sub_expr) override {
@@ -281,8 +354,8 @@ struct ASTBlock : public ASTNode
 {
     ListOfASTPtr statements;
 
-    ASTBlock(ListOfASTPtr&& statements)
-        : statements(std::move(statements))
+    ASTBlock(ListOfASTPtr statements)
+        : statements(statements)
     {}
 
     const ListOfASTPtr& getStatements() const {
@@ -300,8 +373,8 @@ struct ASTTernaryOp : public ASTNode
     ASTPtr true_expr;
     ASTPtr false_expr;
 
-    ASTTernaryOp(ASTPtr&& condition, ASTPtr&& true_expr, ASTPtr&& false_expr)
-        : condition(std::move(condition)), true_expr(std::move(true_expr)), false_expr(std::move(false_expr))
+    ASTTernaryOp(ASTPtr condition, ASTPtr true_expr, ASTPtr false_expr)
+        : condition(condition), true_expr(true_expr), false_expr(false_expr)
     {}
 
     void accept(ASTVisitorInterface& visitor, bool is_sub_expr) override {
@@ -315,12 +388,17 @@ struct ASTTernaryOp : public ASTNode
         }
         return false_expr->evaluateExprType();
     }
+
+    //Tag
+    ASTTag getTag() const override {
+        return ASTTag::Ternary;
+    }
 };
 
 //real
 struct ASTIfNode : ASTNode
 {
-    using ElifCondition = std::vector<std::pair<ASTPtr, ASTPtr>>;
+    using ElifCondition = ASTSlice<std::pair<ASTPtr, ASTPtr>>;
     //If
     ASTPtr if_condition;
     ASTPtr if_body;
@@ -329,8 +407,8 @@ struct ASTIfNode : ASTNode
     //Else
     ASTPtr else_body;
 
-    ASTIfNode(ASTPtr&& ifc, ASTPtr&& ifb, ElifCondition&& elfc, ASTPtr&& eb = nullptr)
-        : if_condition(std::move(ifc)), if_body(std::move(ifb)), elif_clauses(std::move(elfc)), else_body(std::move(eb))
+    ASTIfNode(ASTPtr ifc, ASTPtr ifb, ElifCondition elfc, ASTPtr eb = nullptr)
+        : if_condition(ifc), if_body(ifb), elif_clauses(elfc), else_body(eb)
     {}
 
     void accept(ASTVisitorInterface& visitor, bool is_sub_expr) override {
@@ -341,9 +419,10 @@ struct ASTIfNode : ASTNode
 //--------------ITERATORS--------------
 struct ASTBaseIterator : public ASTNode
 {
-    std::string iter_identifier;
-
-    virtual ~ASTBaseIterator() = default;
+    SymbolId      iter_identifier;
+    //Where the iterator writes its current value, set once the For identifier is declared
+    std::uint16_t iter_scope_index = GLOBAL_FRAME;
+    std::uint16_t iter_slot        = 0;
 };
 
 //Range can be used for stuff like lists, for loop etc
@@ -354,10 +433,10 @@ struct ASTRangeIterator : public ASTBaseIterator
     //0 is condition, 1 is construction (should range be used as condition or to contruct something)
     bool condition_or_construction = 0; //For future use
 
-    ASTRangeIterator(ASTPtr&& start, ASTPtr&& stop, ASTPtr&& step, const std::string& iter_id, bool coc) //coc lmfao
-        : start(std::move(start)), stop(std::move(stop)), step(std::move(step)), condition_or_construction(coc)
+    ASTRangeIterator(ASTPtr start, ASTPtr stop, ASTPtr step, SymbolId iter_id, bool coc) //coc lmfao
+        : start(start), stop(stop), step(step), condition_or_construction(coc)
     {
-        iter_identifier = std::move(iter_id);
+        iter_identifier = iter_id;
     }
 
     void accept(ASTVisitorInterface& visitor, bool is_sub_expr) override {
@@ -383,10 +462,10 @@ struct ASTEllipsisIterator : public ASTBaseIterator
 {
     EvalType ellipsis_type;
 
-    ASTEllipsisIterator(EvalType ellipsis_type, const std::string& iter_id)
+    ASTEllipsisIterator(EvalType ellipsis_type, SymbolId iter_id)
         : ellipsis_type(ellipsis_type)
     {
-        iter_identifier = std::move(iter_id);
+        iter_identifier = iter_id;
     }
 
     void accept(ASTVisitorInterface& visitor, bool is_sub_expr) override {
@@ -406,11 +485,10 @@ struct ASTEllipsisIterator : public ASTBaseIterator
 struct ASTContinue : public ASTNode
 {
     //For loop uses ITER_NEXT to go to next iteration, While loop doesn't
-    std::uint8_t  continue_params;
-    std::uint16_t scopes_to_destroy;
+    std::uint8_t continue_params;
 
-    ASTContinue(std::uint8_t continue_params, std::uint16_t scopes_to_destroy)
-        : continue_params(continue_params), scopes_to_destroy(scopes_to_destroy)
+    ASTContinue(std::uint8_t continue_params)
+        : continue_params(continue_params)
     {}
 
     void accept(ASTVisitorInterface& visitor, bool is_sub_expr) override {
@@ -420,12 +498,11 @@ struct ASTContinue : public ASTNode
 
 struct ASTBreak : public ASTNode
 {
-    //Only thing we check for in parameters is the IS_USING_SYMTBL
-    std::uint8_t  break_params;
-    std::uint16_t scopes_to_destroy;
+    //Not used by ilgen rn, kept same as Continue
+    std::uint8_t break_params;
 
-    ASTBreak(std::uint8_t break_params, std::uint16_t scopes_to_destroy)
-        : break_params(break_params), scopes_to_destroy(scopes_to_destroy)
+    ASTBreak(std::uint8_t break_params)
+        : break_params(break_params)
     {}
 
     void accept(ASTVisitorInterface& visitor, bool is_sub_expr) override {
@@ -437,8 +514,8 @@ struct ASTReturn : public ASTNode
 {
     ASTPtr return_expr;
 
-    ASTReturn(ASTPtr&& return_expr)
-        : return_expr(std::move(return_expr))
+    ASTReturn(ASTPtr return_expr)
+        : return_expr(return_expr)
     {}
 
     void accept(ASTVisitorInterface& visitor, bool is_sub_expr) override {
@@ -461,12 +538,17 @@ struct ASTReturn : public ASTNode
 //--------------LOOPS--------------
 struct ASTForNode : public ASTNode
 {
-    std::string id;
-    ASTPtr      range;
-    ASTPtr      for_body;
+    SymbolId      id;
+    ASTPtr        range;
+    ASTPtr        for_body;
+    //Frame and slot of 'id', used to tell the loop identifier apart from shadowing variables
+    std::uint16_t scope_index;
+    std::uint16_t slot;
+    //Filled by StrengthReducer
+    std::vector<std::unique_ptr<InductionVariable>> induction_vars;
 
-    ASTForNode(const std::string& id, ASTPtr&& range, ASTPtr&& for_body)
-        : id(std::move(id)), range(std::move(range)), for_body(std::move(for_body))
+    ASTForNode(SymbolId id, ASTPtr range, ASTPtr for_body, std::uint16_t scope_index, std::uint16_t slot)
+        : id(id), range(range), for_body(for_body), scope_index(scope_index), slot(slot)
     {}
 
     void accept(ASTVisitorInterface& visitor, bool is_sub_expr) override {
@@ -478,8 +560,8 @@ struct ASTWhileNode : public ASTNode
 {
     ASTPtr while_condition, while_body;
 
-    ASTWhileNode(ASTPtr&& while_condition, ASTPtr&& while_body)
-        : while_condition(std::move(while_condition)), while_body(std::move(while_body))
+    ASTWhileNode(ASTPtr while_condition, ASTPtr while_body)
+        : while_condition(while_condition), while_body(while_body)
     {}
 
     void accept(ASTVisitorInterface& visitor, bool is_sub_expr) override {
@@ -492,17 +574,19 @@ struct ASTFunctionDecl : public ASTNode
 {
     //'starting_addr' set in ilgen
     std::size_t starting_addr;
-    std::string function_name;
+    //Number of slots the function frame needs (params + every variable in every block), set by parser
+    std::uint16_t frame_size = 0;
+    SymbolId    function_name;
     //Function Parameter -> Datatype, identifier
     FuncParams  function_params;
     EvalType    function_return_type;
     ASTPtr      function_body;
     EvalType    vargs_type; //If vargs exist, this wouldn't be EVAL_UNKNOWN
 
-    ASTFunctionDecl(EvalType func_ret_type, const std::string& func_name,
-                    FuncParams&& func_params, ASTPtr&& func_body, EvalType vargs_type)
-        : function_name(std::move(func_name)), function_params(std::move(func_params)),
-          function_return_type(func_ret_type), function_body(std::move(func_body)), vargs_type(vargs_type)
+    ASTFunctionDecl(EvalType func_ret_type, SymbolId func_name,
+                    FuncParams func_params, ASTPtr func_body, EvalType vargs_type)
+        : function_name(func_name), function_params(func_params),
+          function_return_type(func_ret_type), function_body(func_body), vargs_type(vargs_type)
     {}
 
     void accept(ASTVisitorInterface& visitor, bool is_sub_expr) override {
@@ -517,8 +601,8 @@ struct ASTBuiltinFunctionCall : public ASTNode
     bool         has_vargs;
     std::uint8_t call_number;
 
-    ASTBuiltinFunctionCall(std::uint8_t call_number, EvalType func_ret_type, FuncArgs&& func_args, bool has_vargs)
-        : function_args(std::move(func_args)), function_return_type(func_ret_type), call_number(call_number), has_vargs(has_vargs)
+    ASTBuiltinFunctionCall(std::uint8_t call_number, EvalType func_ret_type, FuncArgs func_args, bool has_vargs)
+        : function_args(func_args), function_return_type(func_ret_type), call_number(call_number), has_vargs(has_vargs)
     {}
 
     void accept(ASTVisitorInterface& visitor, bool is_sub_expr) override {
@@ -528,6 +612,11 @@ struct ASTBuiltinFunctionCall : public ASTNode
     EvalType evaluateExprType() const override {
         return function_return_type;
     }
+
+    //Tag
+    ASTTag getTag() const override {
+        return ASTTag::BuiltinFunctionCall;
+    }
 };
 
 struct ASTFunctionCall : public ASTNode
@@ -536,8 +625,8 @@ struct ASTFunctionCall : public ASTNode
     ASTFunctionDecl* initial_func;
     bool             is_tail_call = false; //Set by parse_block
 
-    ASTFunctionCall(FuncArgs&& func_args, ASTFunctionDecl* initial_func)
-        : function_args(std::move(func_args)), initial_func(initial_func)
+    ASTFunctionCall(FuncArgs func_args, ASTFunctionDecl* initial_func)
+        : function_args(func_args), initial_func(initial_func)
     {}
 
     void accept(ASTVisitorInterface& visitor, bool is_sub_expr) override {
@@ -0,0 +1,40 @@
+#include "ast_arena.hpp"
+
+ASTArena::~ASTArena()
+{
+    //Reverse order of creation, nodes don't own each other anymore so its only the usual order and nothing more
+    for (auto it = destructors.rbegin(); it != destructors.rend(); ++it)
+        it->second(it->first);
+    //Blocks are freed by their unique_ptr's
+}
+
+void ASTArena::reset()
+{
+    for (auto it = destructors.rbegin(); it != destructors.rend(); ++it)
+        it->second(it->first);
+    destructors.clear();
+
+    //First allocation after this gets a fresh block, keeping one around isn't worth it (it may be an oversized one)
+    blocks.clear();
+    current   = nullptr;
+    limit     = nullptr;
+    usedBytes = 0;
+}
+
+void* ASTArena::allocateSlow(std::size_t size, std::size_t alignment)
+{
+    //Allocations that don't fit in a normal block get one of their own, current block keeps being used after that
+    if(size + alignment > AST_ARENA_BLOCK_SIZE) {
+        blocks.emplace_back(new std::byte[size + alignment]);
+        usedBytes += size + alignment;
+
+        std::uintptr_t address = (reinterpret_cast<std::uintptr_t>(blocks.back().get()) + alignment - 1) & ~(alignment - 1);
+        return reinterpret_cast<void*>(address);
+    }
+
+    blocks.emplace_back(new std::byte[AST_ARENA_BLOCK_SIZE]);
+    current = blocks.back().get();
+    limit   = current + AST_ARENA_BLOCK_SIZE;
+
+    return allocate(size, alignment);
+}
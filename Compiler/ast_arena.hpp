@@ -0,0 +1,128 @@
+/* Bump pointer arena the whole AST lives in, owned by Parser (so by the compilation unit).
+ * Nodes are handed out as raw pointers, child lists are slices copied into the arena once parsed.
+ * Nothing is freed one by one, the blocks go away together with the arena (or on reset). Only nodes that own
+ * heap memory themselves (strings, vectors) get their destructor called, in reverse order of creation.
+*/
+#ifndef UNNAMED_AST_ARENA_HPP
+#define UNNAMED_AST_ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <iterator>
+
+//Size of one arena block, bigger allocations get a block of their own
+#define AST_ARENA_BLOCK_SIZE (64 * 1024)
+
+//Contiguous list of T inside of the arena, read only view once created
+template<typename T>
+struct ASTSlice
+{
+    T*            items = nullptr;
+    std::uint32_t count = 0;
+
+    T*       begin()       { return items; }
+    T*       end()         { return items + count; }
+    const T* begin() const { return items; }
+    const T* end()   const { return items + count; }
+
+    std::reverse_iterator<const T*> rbegin() const { return std::reverse_iterator<const T*>(end()); }
+    std::reverse_iterator<const T*> rend()   const { return std::reverse_iterator<const T*>(begin()); }
+
+    std::size_t size()  const { return count; }
+    bool        empty() const { return count == 0; }
+
+    T&       operator[](std::size_t i)       { return items[i]; }
+    const T& operator[](std::size_t i) const { return items[i]; }
+    const T& back() const { return items[count - 1]; }
+};
+
+class ASTArena
+{
+public:
+    ASTArena() = default;
+    ~ASTArena();
+
+    ASTArena(const ASTArena&)            = delete;
+    ASTArena& operator=(const ASTArena&) = delete;
+
+    template<typename T, typename... Args>
+    T* make(Args&&... args)
+    {
+        T* node = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+
+        if constexpr(!std::is_trivially_destructible_v<T>)
+            destructors.emplace_back(node, [](void* ptr) { static_cast<T*>(ptr)->~T(); });
+
+        return node;
+    }
+
+    //Copies the list into the arena, source is left as is (its fine to clear and reuse it)
+    template<typename T>
+    ASTSlice<T> copyList(const T* items, std::size_t count)
+    {
+        static_assert(std::is_trivially_destructible_v<T>, "Arena lists hold pointers and other plain data only, nothing destroys them");
+
+        ASTSlice<T> slice;
+        if(count == 0)
+            return slice;
+
+        slice.items = static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+        slice.count = static_cast<std::uint32_t>(count);
+        std::uninitialized_copy(items, items + count, slice.items);
+        return slice;
+    }
+
+    template<typename T>
+    ASTSlice<T> copyList(const std::vector<T>& items)
+    {
+        return copyList(items.data(), items.size());
+    }
+
+    //Literals of nodes, so nodes don't own any memory themselves
+    std::string_view copyString(std::string_view text)
+    {
+        char* chars = static_cast<char*>(allocate(text.size(), alignof(char)));
+        std::memcpy(chars, text.data(), text.size());
+        return std::string_view(chars, text.size());
+    }
+
+    //Bytes handed out so far (padding included)
+    std::size_t bytesUsed() const { return usedBytes; }
+    //Destroys everything made so far and gives the blocks back, arena can be used again afterwards
+    void reset();
+
+private:
+    void* allocate(std::size_t size, std::size_t alignment);
+    void* allocateSlow(std::size_t size, std::size_t alignment);
+
+private:
+    std::vector<std::unique_ptr<std::byte[]>> blocks;
+    std::byte*                                current = nullptr;
+    std::byte*                                limit   = nullptr;
+    std::size_t                               usedBytes = 0;
+
+    std::vector<std::pair<void*, void(*)(void*)>> destructors;
+};
+
+inline void* ASTArena::allocate(std::size_t size, std::size_t alignment)
+{
+    //Fast path, bump the pointer within the current block
+    std::uintptr_t address = (reinterpret_cast<std::uintptr_t>(current) + alignment - 1) & ~(alignment - 1);
+    std::byte*     aligned = reinterpret_cast<std::byte*>(address);
+
+    if(current != nullptr && aligned + size <= limit) {
+        usedBytes += (aligned + size) - current;
+        current    = aligned + size;
+        return aligned;
+    }
+    return allocateSlow(size, alignment);
+}
+
+#endif
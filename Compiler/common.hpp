@@ -6,7 +6,6 @@
 //Constants to be bitwise'd
 #define IS_LOOP         1
 #define IS_FOR_LOOP     2
-#define IS_USING_SYMTBL 4
 #define IS_FUNCTION     8
 
 #define CBR_PARAMS_CHECK_CONDITION(var, cond) (var & cond)
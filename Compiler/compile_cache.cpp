@@ -0,0 +1,127 @@
+#include <vector>
+#include <algorithm>
+#include <system_error>
+#include <thread>
+#include <chrono>
+
+#include "compile_cache.hpp"
+#include "replace_file.hpp"
+#include "../Common/cflx_format.hpp"
+
+namespace fs = std::filesystem;
+
+//-----------------HELPER FUNCTIONS-----------------
+//FNV-1a with a different starting value, together with cflxChecksum its a 128bit key
+static std::uint64_t secondaryHash(const std::string& data)
+{
+    std::uint64_t hash = 0x6C62272E07BB0142ULL;
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static std::string toHex(std::uint64_t value)
+{
+    const char* digits = "0123456789abcdef";
+    std::string result(16, '0');
+    for (int i = 15; i >= 0; --i, value >>= 4)
+        result[i] = digits[value & 0xF];
+    return result;
+}
+
+//-----------------
+std::string CompileCache::makeKey(const std::string& source, const std::string& dependencies, bool compactCode, bool optimized)
+{
+    //Everything that changes the output has to be in here
+    std::string input = std::string(FLUX_COMPILER_VERSION) + '/' + std::to_string(CFLX_VERSION_MAJOR) + '.' +
+                        std::to_string(CFLX_VERSION_MINOR) + (compactCode ? "/compact" : "/default") + (optimized ? "" : "/O0") +
+                        '\0' + source + '\0' + dependencies;
+
+    return toHex(cflxChecksum(input.data(), input.size())) + toHex(secondaryHash(input));
+}
+
+bool CompileCache::lookup(const std::string& key, const char* outputPath)
+{
+    std::error_code ec;
+    fs::path entry = directory / (key + ".cflx");
+
+    //Output might be running in an interpreter right now, its replaced at once instead of overwritten in place
+    std::string temporary = temporaryPathFor(outputPath);
+    if(!fs::copy_file(entry, temporary, fs::copy_options::overwrite_existing, ec) || ec) {
+        fs::remove(temporary, ec);
+        return false;
+    }
+    if(!replaceFile(temporary, outputPath))
+        return false;
+
+    //Recently used, last to be evicted
+    fs::last_write_time(entry, fs::file_time_type::clock::now(), ec);
+    return true;
+}
+
+void CompileCache::store(const std::string& key, const char* outputPath)
+{
+    std::error_code ec;
+    fs::create_directories(directory, ec);
+
+    //Written under a temporary name first, other compilers sharing the cache never see half of a file.
+    //Name is unique per thread and moment, two units with the same key can be stored at once (-j or another compiler)
+    std::size_t writer = std::hash<std::thread::id>{}(std::this_thread::get_id()) ^
+                         static_cast<std::size_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+
+    fs::path entry     = directory / (key + ".cflx");
+    fs::path temporary = directory / (key + '.' + toHex(writer) + ".tmp");
+
+    if(!fs::copy_file(outputPath, temporary, fs::copy_options::overwrite_existing, ec) || ec)
+        return;
+
+    fs::rename(temporary, entry, ec);
+    if(ec) {
+        fs::remove(temporary, ec);
+        return;
+    }
+
+    evict();
+}
+
+void CompileCache::evict()
+{
+    struct CacheEntry
+    {
+        fs::path            path;
+        fs::file_time_type  lastUsed;
+        std::uintmax_t      size;
+    };
+
+    std::error_code         ec;
+    std::vector<CacheEntry> entries;
+    std::uintmax_t          totalSize = 0;
+
+    for (auto &&file : fs::directory_iterator(directory, ec))
+    {
+        if(file.path().extension() != ".cflx")
+            continue;
+
+        CacheEntry entry{file.path(), file.last_write_time(ec), file.file_size(ec)};
+        if(ec)
+            continue;
+
+        totalSize += entry.size;
+        entries.push_back(std::move(entry));
+    }
+
+    if(totalSize <= maxSize)
+        return;
+
+    std::sort(entries.begin(), entries.end(), [](const CacheEntry& a, const CacheEntry& b) { return a.lastUsed < b.lastUsed; });
+
+    for (auto &&entry : entries)
+    {
+        if(totalSize <= maxSize)
+            break;
+        if(fs::remove(entry.path, ec))
+            totalSize -= entry.size;
+    }
+}
@@ -0,0 +1,38 @@
+/* Persistent compilation cache. Entries are plain .cflx files named after a key made from the source, contents of
+ * every file it includes, compiler version and flags. Least recently used entries are evicted once
+ * the cache grows over its size limit, file modification time is bumped on every hit to keep track of that.
+*/
+#ifndef UNNAMED_COMPILE_CACHE_HPP
+#define UNNAMED_COMPILE_CACHE_HPP
+
+#include <filesystem>
+#include <string>
+#include <cstdint>
+
+//Bump whenever the compiler generates different code for the same source, old entries are never looked at again
+#define FLUX_COMPILER_VERSION "0.9"
+#define DEFAULT_CACHE_SIZE_MB 256
+
+class CompileCache
+{
+    public:
+        CompileCache(const std::string& directory, std::uintmax_t maxSize)
+            : directory(directory), maxSize(maxSize)
+        {}
+
+        static std::string makeKey(const std::string& source, const std::string& dependencies, bool compactCode, bool optimized = true);
+
+        //Copies cached output to 'outputPath', false if there is nothing cached for 'key'
+        bool lookup(const std::string& key, const char* outputPath);
+        //Adds freshly compiled 'outputPath' to the cache, failing to do so is not an error, next build just compiles again
+        void store(const std::string& key, const char* outputPath);
+
+    private:
+        void evict();
+
+    private:
+        std::filesystem::path directory;
+        std::uintmax_t        maxSize;
+};
+
+#endif
@@ -0,0 +1,99 @@
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include "compile_scheduler.hpp"
+#include "preprocessor.hpp"
+
+void CompileScheduler::addUnit(const std::string& sourcePath)
+{
+    nodes[addNode(sourcePath)].isUnit = true;
+}
+
+std::size_t CompileScheduler::addNode(const std::string& path)
+{
+    auto found = nodeIndex.find(path);
+    if(found != nodeIndex.end())
+        return found->second;
+
+    std::size_t index = nodes.size();
+    nodes.emplace_back().path = path;
+    nodeIndex.emplace(path, index);
+
+    //Missing file has no dependencies, whoever includes it reports the error when it gets compiled
+    std::string source;
+    if(std::ifstream file{path, std::ios_base::binary}; file) {
+        std::ostringstream buffer;
+        buffer << file.rdbuf();
+        source = buffer.str();
+    }
+
+    //Careful, 'nodes' grows while adding dependencies, only indices stay valid
+    nodes[index].visiting = true;
+    for (auto &&includePath : Preprocessor::findIncludes(source))
+    {
+        std::size_t dependency = addNode(includePath);
+        nodes[dependency].isModule = true;
+
+        //Include cycle, modules in it get lexed together as part of whatever unit includes them first anyway
+        if(nodes[dependency].visiting)
+            continue;
+
+        nodes[dependency].dependents.push_back(index);
+        ++nodes[index].pendingDependencies;
+    }
+    nodes[index].visiting = false;
+
+    return index;
+}
+
+void CompileScheduler::run(unsigned int jobs, const UnitCompiler& compileUnit)
+{
+    unfinished = nodes.size();
+    for (std::size_t i = 0; i < nodes.size(); ++i)
+        if(nodes[i].pendingDependencies == 0)
+            ready.push_back(i);
+
+    std::vector<std::thread> workers;
+    for (unsigned int i = 1; i < jobs; ++i)
+        workers.emplace_back(&CompileScheduler::work, this, std::cref(compileUnit));
+
+    work(compileUnit);
+
+    for (auto &&worker : workers)
+        worker.join();
+}
+
+void CompileScheduler::work(const UnitCompiler& compileUnit)
+{
+    while(true)
+    {
+        std::size_t index;
+        {
+            std::unique_lock<std::mutex> lock{mutex};
+            readyChanged.wait(lock, [this] { return !ready.empty() || unfinished == 0; });
+
+            if(ready.empty())
+                return;
+
+            index = ready.back();
+            ready.pop_back();
+        }
+
+        //Nodes don't change anymore, only the pending counts do (under the lock)
+        const Node& node = nodes[index];
+        if(node.isModule)
+            Preprocessor::precompileModule(node.path);
+        if(node.isUnit)
+            compileUnit(node.path);
+
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            for (auto &&dependent : node.dependents)
+                if(--nodes[dependent].pendingDependencies == 0)
+                    ready.push_back(dependent);
+            --unfinished;
+        }
+        readyChanged.notify_all();
+    }
+}
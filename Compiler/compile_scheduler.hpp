@@ -0,0 +1,53 @@
+/* Schedules a build of several translation units (files given to the compiler) on a pool of threads.
+ * Every unit and every module it includes (transitively) is a node of a dependency graph, a node is only
+ * started once everything it includes is done:
+ *  - included modules made of defines only get their .fluxm precompiled, so units never race to write it
+ *  - units are compiled as a whole (lexing, parsing, IL, writing) on the thread that picked them up
+ * Included code is still lexed as part of the unit including it, so linking a unit is done by the unit itself.
+*/
+#ifndef UNNAMED_COMPILE_SCHEDULER_HPP
+#define UNNAMED_COMPILE_SCHEDULER_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class CompileScheduler
+{
+    public:
+        using UnitCompiler = std::function<void(const std::string& sourcePath)>;
+
+        void addUnit(const std::string& sourcePath);
+        //Returns once every node is done, 'compileUnit' is called from 'jobs' threads at once (main thread included)
+        void run(unsigned int jobs, const UnitCompiler& compileUnit);
+
+    private:
+        struct Node
+        {
+            std::string              path;
+            bool                     isUnit   = false;
+            bool                     isModule = false; //Included by some other node
+            bool                     visiting = false; //On the include chain being added right now, used to break cycles
+            std::size_t              pendingDependencies = 0;
+            std::vector<std::size_t> dependents;
+        };
+
+        std::size_t addNode(const std::string& path);
+        void        work(const UnitCompiler& compileUnit);
+
+    private:
+        std::vector<Node>                            nodes;
+        std::unordered_map<std::string, std::size_t> nodeIndex;
+
+        //Nodes with nothing pending, taken by whichever worker is free
+        std::mutex              mutex;
+        std::condition_variable readyChanged;
+        std::vector<std::size_t> ready;
+        std::size_t              unfinished = 0;
+};
+
+#endif
@@ -0,0 +1,531 @@
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <unordered_map>
+
+#ifndef _WIN32
+    #include <poll.h>
+    #include <sys/socket.h>
+    #include <sys/stat.h>
+    #include <sys/time.h>
+    #include <sys/un.h>
+    #include <sys/wait.h>
+    #include <unistd.h>
+#endif
+
+#include "compile_server.hpp"
+#include "compile_cache.hpp" //FLUX_COMPILER_VERSION
+#include "preprocessor.hpp"
+#include "replace_file.hpp"
+
+#ifndef _WIN32
+
+#define SERVER_REQUEST_MAGIC  0x51584C46u //'FLXQ'
+#define SERVER_RESPONSE_MAGIC 0x53584C46u //'FLXS'
+//Nothing a real client sends comes close to these
+#define SERVER_MAX_STRING     (1u << 20)
+#define SERVER_MAX_ARGUMENTS  4096u
+
+#ifndef MSG_NOSIGNAL
+    #define MSG_NOSIGNAL 0
+#endif
+
+namespace fs = std::filesystem;
+
+//Results kept by the server, oldest go first once they take up more than 'maxResultBytes'.
+//Children only ever read these, their own copy from the moment they were forked
+static std::unordered_map<std::string, std::string> results;
+static std::deque<std::string>                      resultOrder;
+static std::uintmax_t                               resultBytes    = 0;
+static std::uintmax_t                               maxResultBytes = 0;
+
+//Inside of a child, results compiled by its request (key, absolute output path) to be reported to the server
+static bool                                             serving = false;
+static std::mutex                                       compiledMutex;
+static std::vector<std::pair<std::string, std::string>> compiled;
+
+//Removed when the server is stopped, signal handler can't do much more than that
+static char socketPathToRemove[sizeof(sockaddr_un::sun_path)];
+
+//Child compiling a request, 'reports' is the read end of the pipe it reports through
+struct ServerJob
+{
+    pid_t       pid;
+    int         connection;
+    int         reports;
+    std::string received;
+};
+
+//-----------------HELPER FUNCTIONS-----------------
+static bool writeAll(int fd, const char* data, std::size_t size)
+{
+    while(size > 0)
+    {
+        ssize_t written = ::write(fd, data, size);
+        if(written < 0 && errno == EINTR)
+            continue;
+        if(written <= 0)
+            return false;
+        data += written;
+        size -= static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+//Client side, a server going away mid request must not kill the client with SIGPIPE
+static bool sendAll(int fd, const char* data, std::size_t size)
+{
+    while(size > 0)
+    {
+        ssize_t sent = ::send(fd, data, size, MSG_NOSIGNAL);
+        if(sent < 0 && errno == EINTR)
+            continue;
+        if(sent <= 0)
+            return false;
+        data += sent;
+        size -= static_cast<std::size_t>(sent);
+    }
+    return true;
+}
+
+static bool readAll(int fd, char* data, std::size_t size)
+{
+    while(size > 0)
+    {
+        ssize_t count = ::read(fd, data, size);
+        if(count < 0 && errno == EINTR)
+            continue;
+        if(count <= 0)
+            return false;
+        data += count;
+        size -= static_cast<std::size_t>(count);
+    }
+    return true;
+}
+
+static void appendU32(std::string& out, std::uint32_t value)
+{
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+static void appendString(std::string& out, const std::string& value)
+{
+    appendU32(out, static_cast<std::uint32_t>(value.size()));
+    out.append(value);
+}
+
+static bool readU32(int fd, std::uint32_t& value)
+{
+    return readAll(fd, reinterpret_cast<char*>(&value), sizeof(value));
+}
+
+static bool readString(int fd, std::string& value)
+{
+    std::uint32_t size;
+    if(!readU32(fd, size) || size > SERVER_MAX_STRING)
+        return false;
+    value.resize(size);
+    return readAll(fd, value.data(), size);
+}
+
+static bool makeAddress(const std::string& path, sockaddr_un& address)
+{
+    if(path.empty() || path.size() >= sizeof(address.sun_path))
+        return false;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+//-1 if nobody listens on 'path'
+static int connectTo(const std::string& path)
+{
+    sockaddr_un address;
+    if(!makeAddress(path, address))
+        return -1;
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0)
+        return -1;
+    if(::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+//Whoever is on the other end runs as the same user. Anyone can make a socket at a path others might connect to,
+//and the server compiles (and writes files) as whoever started it
+static bool peerIsSameUser(int fd)
+{
+#ifdef SO_PEERCRED
+    ucred     credentials;
+    socklen_t length = sizeof(credentials);
+    return ::getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) == 0 && credentials.uid == ::getuid();
+#else
+    uid_t uid;
+    gid_t gid;
+    return ::getpeereid(fd, &uid, &gid) == 0 && uid == ::getuid();
+#endif
+}
+
+static void sendResponseEnd(int connection, std::int32_t exitCode)
+{
+    std::string end;
+    appendU32(end, SERVER_RESPONSE_MAGIC);
+    end.append(reinterpret_cast<const char*>(&exitCode), sizeof(exitCode));
+    writeAll(connection, end.data(), end.size());
+}
+
+static void removeSocketAndExit(int)
+{
+    ::unlink(socketPathToRemove);
+    ::_exit(0);
+}
+
+static void keepResult(const std::string& key, const std::string& outputPath)
+{
+    if(results.count(key) != 0)
+        return;
+
+    std::ifstream file{outputPath, std::ios_base::binary};
+    if(!file)
+        return;
+    std::string contents{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+    if(contents.size() > maxResultBytes)
+        return;
+
+    resultBytes += contents.size();
+    results.emplace(key, std::move(contents));
+    resultOrder.push_back(key);
+
+    while(resultBytes > maxResultBytes)
+    {
+        auto oldest = results.find(resultOrder.front());
+        resultBytes -= oldest->second.size();
+        results.erase(oldest);
+        resultOrder.pop_front();
+    }
+}
+
+//Records are 'R' key '\0' output path '\0' for results and 'M' path '\0' for modules read from disk
+static void applyReports(const std::string& received)
+{
+    std::size_t at = 0;
+    while(at < received.size())
+    {
+        char        kind = received[at++];
+        std::size_t end  = received.find('\0', at);
+        if(end == std::string::npos)
+            break;
+        std::string first = received.substr(at, end - at);
+        at = end + 1;
+
+        //Read in the server too, every child forked from now on has it in memory
+        if(kind == 'M') {
+            Preprocessor::precompileModule(first);
+            continue;
+        }
+
+        end = received.find('\0', at);
+        if(end == std::string::npos)
+            break;
+        keepResult(first, received.substr(at, end - at));
+        at = end + 1;
+    }
+
+    //Server has nobody to report to
+    Preprocessor::takeNewlyLoadedModules();
+}
+
+[[noreturn]] static void runRequest(int connection, int reports, const std::string& workingDirectory,
+                                    std::vector<std::string>& arguments, CompileServer::RequestHandler handler)
+{
+    std::signal(SIGINT, SIG_DFL);
+    std::signal(SIGTERM, SIG_DFL);
+
+    //Everything the compiler prints goes to the client
+    ::dup2(connection, STDOUT_FILENO);
+    ::dup2(connection, STDERR_FILENO);
+    ::close(connection);
+
+    if(::chdir(workingDirectory.c_str()) != 0) {
+        std::cout << "[CompilerError]: Compile server can't enter the working directory: " << workingDirectory << std::endl;
+        std::_Exit(1);
+    }
+
+    std::vector<char*> argv = {const_cast<char*>("FluxCompiler")};
+    for (auto &&argument : arguments)
+        argv.push_back(argument.data());
+    argv.push_back(nullptr);
+
+    serving      = true;
+    int exitCode = handler(static_cast<int>(argv.size() - 1), argv.data());
+
+    std::string report;
+    for (auto &&[key, outputPath] : compiled) {
+        report.push_back('R');
+        report.append(key).push_back('\0');
+        report.append(outputPath).push_back('\0');
+    }
+    for (auto &&modulePath : Preprocessor::takeNewlyLoadedModules()) {
+        report.push_back('M');
+        report.append(modulePath).push_back('\0');
+    }
+    writeAll(reports, report.data(), report.size());
+
+    std::exit(exitCode);
+}
+
+static void acceptRequest(int listener, std::vector<ServerJob>& jobs, CompileServer::RequestHandler handler)
+{
+    int connection = ::accept(listener, nullptr, nullptr);
+    if(connection < 0)
+        return;
+    if(!peerIsSameUser(connection)) {
+        ::close(connection);
+        return;
+    }
+
+    //Client writes its whole request right away, one that doesn't can't hold the server up for long
+    timeval timeout{2, 0};
+    ::setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    std::uint32_t            magic = 0, count = 0;
+    std::string              version, workingDirectory;
+    std::vector<std::string> arguments;
+
+    bool valid = readU32(connection, magic) && magic == SERVER_REQUEST_MAGIC && readString(connection, version)
+                 && readString(connection, workingDirectory) && readU32(connection, count) && count <= SERVER_MAX_ARGUMENTS;
+    for (std::uint32_t i = 0; valid && i < count; ++i)
+        valid = readString(connection, arguments.emplace_back());
+
+    //Client of another compiler version compiles by itself, its output has to be exactly what its own compiler makes
+    int reports[2];
+    if(!valid || version != FLUX_COMPILER_VERSION || ::pipe(reports) != 0) {
+        sendResponseEnd(connection, -1);
+        ::close(connection);
+        return;
+    }
+
+    std::cout.flush();
+    pid_t pid = ::fork();
+    if(pid == 0)
+    {
+        ::close(listener);
+        ::close(reports[0]);
+        for (auto &&job : jobs) {
+            ::close(job.connection);
+            ::close(job.reports);
+        }
+        runRequest(connection, reports[1], workingDirectory, arguments, handler);
+    }
+
+    ::close(reports[1]);
+    if(pid < 0) {
+        ::close(reports[0]);
+        sendResponseEnd(connection, -1);
+        ::close(connection);
+        return;
+    }
+    jobs.push_back(ServerJob{pid, connection, reports[0], {}});
+}
+
+//Child closed its end of the pipe, so its done
+static void finishJob(ServerJob& job)
+{
+    int status = 0;
+    while(::waitpid(job.pid, &status, 0) < 0 && errno == EINTR)
+        ;
+
+    std::int32_t exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+    if(!WIFEXITED(status)) {
+        std::string message = "[CompilerError]: Compile server worker was killed by signal " + std::to_string(WTERMSIG(status)) + '\n';
+        writeAll(job.connection, message.data(), message.size());
+    }
+    if(exitCode == 0)
+        applyReports(job.received);
+
+    sendResponseEnd(job.connection, exitCode);
+    ::close(job.connection);
+    ::close(job.reports);
+}
+
+//-----------------
+std::string CompileServer::defaultSocketPath()
+{
+    if(const char* path = std::getenv("FLUX_SERVER_SOCKET"))
+        return path;
+    //Only the user can create anything in there, in /tmp anyone can be there first
+    if(const char* runtimeDirectory = std::getenv("XDG_RUNTIME_DIR"); runtimeDirectory != nullptr && *runtimeDirectory != '\0')
+        return std::string{runtimeDirectory} + "/flux-compiler.sock";
+    return "/tmp/flux-compiler-" + std::to_string(::getuid()) + ".sock";
+}
+
+bool CompileServer::serve(const std::string& socketPath, RequestHandler handler, std::uintmax_t cacheSize)
+{
+    sockaddr_un address;
+    if(!makeAddress(socketPath, address))
+        return false;
+
+    //Socket left behind by a server that didn't get to remove it. One that still answers is a running server
+    if(int running = connectTo(socketPath); running >= 0) {
+        ::close(running);
+        return false;
+    }
+    ::unlink(socketPath.c_str());
+
+    //Only the user who started the server gets to talk to it
+    int    listener     = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    mode_t previousMask = ::umask(0077);
+    bool   listening    = listener >= 0 && ::bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0
+                          && ::listen(listener, SOMAXCONN) == 0;
+    ::umask(previousMask);
+    if(!listening) {
+        if(listener >= 0)
+            ::close(listener);
+        return false;
+    }
+
+    maxResultBytes = cacheSize;
+    std::strcpy(socketPathToRemove, socketPath.c_str());
+    std::signal(SIGINT, removeSocketAndExit);
+    std::signal(SIGTERM, removeSocketAndExit);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    std::cout << "Compile server listening on " << socketPath << std::endl;
+
+    //Requests are compiled side by side, each one in its own child
+    std::vector<ServerJob> jobs;
+    std::vector<pollfd>    waiting;
+    for(;;)
+    {
+        waiting.assign(1, pollfd{listener, POLLIN, 0});
+        for (auto &&job : jobs)
+            waiting.push_back(pollfd{job.reports, POLLIN, 0});
+
+        if(::poll(waiting.data(), waiting.size(), -1) < 0) {
+            if(errno == EINTR)
+                continue;
+            return false;
+        }
+
+        //From the back, jobs[i] is waiting[i + 1] and erasing never moves the ones before it
+        for (std::size_t i = jobs.size(); i-- > 0;)
+        {
+            if(waiting[i + 1].revents == 0)
+                continue;
+
+            char    buffer[4096];
+            ssize_t count = ::read(jobs[i].reports, buffer, sizeof(buffer));
+            if(count > 0)
+                jobs[i].received.append(buffer, static_cast<std::size_t>(count));
+            else if(count == 0 || errno != EINTR) {
+                finishJob(jobs[i]);
+                jobs.erase(jobs.begin() + i);
+            }
+        }
+
+        if(waiting[0].revents & POLLIN)
+            acceptRequest(listener, jobs, handler);
+    }
+}
+
+bool CompileServer::inRequest()
+{
+    return serving;
+}
+
+bool CompileServer::lookupResult(const std::string& key, const char* outputPath)
+{
+    auto result = results.find(key);
+    if(result == results.end())
+        return false;
+
+    //Replaced at once, same as anything else writing compiled output
+    return replaceFileContents(outputPath, result->second.data(), result->second.size());
+}
+
+void CompileServer::storeResult(const std::string& key, const char* outputPath)
+{
+    if(!serving)
+        return;
+
+    std::error_code ec;
+    std::string     absolutePath = fs::absolute(outputPath, ec).string();
+
+    std::lock_guard<std::mutex> lock{compiledMutex};
+    compiled.emplace_back(key, std::move(absolutePath));
+}
+
+bool CompileServer::request(const std::string& socketPath, const std::vector<std::string>& arguments, int& exitCode)
+{
+    int connection = connectTo(socketPath);
+    if(connection < 0)
+        return false;
+    if(!peerIsSameUser(connection)) {
+        ::close(connection);
+        std::cerr << "[Warning] From [CompileServer]: " << socketPath << " is served by another user, compiling without it\n";
+        return false;
+    }
+
+    std::error_code ec;
+    std::string     message;
+    appendU32(message, SERVER_REQUEST_MAGIC);
+    appendString(message, FLUX_COMPILER_VERSION);
+    appendString(message, fs::current_path(ec).string());
+    appendU32(message, static_cast<std::uint32_t>(arguments.size()));
+    for (auto &&argument : arguments)
+        appendString(message, argument);
+
+    std::string response;
+    if(sendAll(connection, message.data(), message.size()))
+    {
+        char buffer[8192];
+        for(;;)
+        {
+            ssize_t count = ::read(connection, buffer, sizeof(buffer));
+            if(count < 0 && errno == EINTR)
+                continue;
+            if(count <= 0)
+                break;
+            response.append(buffer, static_cast<std::size_t>(count));
+        }
+    }
+    ::close(connection);
+
+    //No end means the server went away on the way, caller compiles it again
+    std::uint32_t magic;
+    std::int32_t  code;
+    if(response.size() < sizeof(magic) + sizeof(code))
+        return false;
+    std::memcpy(&magic, response.data() + response.size() - 8, sizeof(magic));
+    std::memcpy(&code, response.data() + response.size() - 4, sizeof(code));
+    if(magic != SERVER_RESPONSE_MAGIC || code < 0)
+        return false;
+
+    std::fwrite(response.data(), 1, response.size() - 8, stdout);
+    std::fflush(stdout);
+    exitCode = code;
+    return true;
+}
+
+#else
+
+//No Unix domain sockets to speak of, clients always compile in-process
+std::string CompileServer::defaultSocketPath()                                                  { return {}; }
+bool        CompileServer::serve(const std::string&, RequestHandler, std::uintmax_t)           { return false; }
+bool        CompileServer::inRequest()                                                          { return false; }
+bool        CompileServer::lookupResult(const std::string&, const char*)                        { return false; }
+void        CompileServer::storeResult(const std::string&, const char*)                         {}
+bool        CompileServer::request(const std::string&, const std::vector<std::string>&, int&)   { return false; }
+
+#endif
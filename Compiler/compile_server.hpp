@@ -0,0 +1,39 @@
+/* Compile server (--server), a long lived compiler listening on a Unix domain socket for a thin client (--client).
+ * Every request is compiled by a child forked off the server, so it starts out with whatever the server keeps warm:
+ * defines only modules already read (see Preprocessor), keyword / type tables and recently compiled results
+ * (in memory, same keys as CompileCache). Children report what they read and compiled, server keeps it for the next ones.
+ * Errors end the child like they end a normal compiler run, never the server. Its output goes straight to the client.
+ *
+ * Request:  'FLXQ', compiler version, working directory, arguments (strings are u32 length + bytes, counts are u32)
+ * Response: everything the compiler printed, then 'FLXS' and the exit code (i32, -1 if the server refused the request)
+ * POSIX only, elsewhere there is never a server and clients always compile in-process.
+*/
+#ifndef UNNAMED_COMPILE_SERVER_HPP
+#define UNNAMED_COMPILE_SERVER_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class CompileServer
+{
+    public:
+        //Compiles one request inside of the forked child, same as main would with these arguments. Returns exit code
+        using RequestHandler = int (*)(int argc, char** argv);
+
+        //$FLUX_SERVER_SOCKET, or one socket per user in /tmp
+        static std::string defaultSocketPath();
+
+        //Serves requests until killed. False if it can't listen on 'socketPath' (another server is already there, ...)
+        static bool serve(const std::string& socketPath, RequestHandler handler, std::uintmax_t cacheSize);
+
+        //Inside of a request, results compiled by earlier requests. Both do nothing outside of a server
+        static bool inRequest();
+        static bool lookupResult(const std::string& key, const char* outputPath);
+        static void storeResult(const std::string& key, const char* outputPath);
+
+        //Client. Output of the request is printed as is, false if no server took it (caller compiles in-process then)
+        static bool request(const std::string& socketPath, const std::vector<std::string>& arguments, int& exitCode);
+};
+
+#endif
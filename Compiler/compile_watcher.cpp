@@ -0,0 +1,196 @@
+#include <cerrno>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#ifdef __linux__
+    #include <poll.h>
+    #include <sys/inotify.h>
+    #include <sys/wait.h>
+    #include <unistd.h>
+#endif
+
+#include "compile_watcher.hpp"
+#include "preprocessor.hpp"
+
+namespace fs = std::filesystem;
+
+//Events closer together than this are one change, editors save in several steps
+#define WATCH_SETTLE_MS 30
+
+#ifdef __linux__
+
+static std::string absolutePath(const std::string& path)
+{
+    std::error_code ec;
+    return fs::absolute(path, ec).lexically_normal().string();
+}
+
+//Missing file reads as empty, whoever includes it reports the error when it gets built
+static std::string readSource(const std::string& path)
+{
+    std::ifstream file{path, std::ios_base::binary};
+    if(!file)
+        return {};
+
+    std::ostringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+bool CompileWatcher::run(const BuildHandler& handler)
+{
+    inotifyFd = ::inotify_init1(IN_CLOEXEC);
+    if(inotifyFd < 0)
+        return false;
+
+    scanUnits();
+    build(handler, units);
+
+    std::unordered_set<std::string> changedFiles;
+    while(waitForChanges(changedFiles))
+    {
+        //Same order they were given in, with the graph from before the change (that's what they were built with)
+        std::unordered_set<std::string> picked;
+        for (auto &&filePath : changedFiles)
+            for (auto &&unit : dependents[filePath])
+                picked.insert(unit);
+
+        std::vector<std::string> changedUnits;
+        for (auto &&unit : units)
+            if(picked.count(unit) != 0)
+                changedUnits.push_back(unit);
+        changedFiles.clear();
+
+        //Includes may have changed along with the files
+        scanUnits();
+        if(!changedUnits.empty())
+            build(handler, changedUnits);
+    }
+    return false;
+}
+
+void CompileWatcher::scanUnits()
+{
+    dependents.clear();
+    std::unordered_set<std::string> modules;
+
+    for (auto &&unit : units)
+    {
+        std::unordered_set<std::string> visited;
+        std::vector<std::string>        pending = {unit};
+
+        while(!pending.empty())
+        {
+            std::string filePath = std::move(pending.back());
+            pending.pop_back();
+
+            std::string absoluteFilePath = absolutePath(filePath);
+            if(!visited.insert(absoluteFilePath).second)
+                continue;
+
+            dependents[absoluteFilePath].push_back(unit);
+            if(filePath != unit)
+                modules.insert(filePath);
+
+            for (auto &&includePath : Preprocessor::findIncludes(readSource(filePath)))
+                pending.push_back(std::move(includePath));
+        }
+    }
+
+    //Directory of a missing include may not be there either, it gets watched once something includes it again
+    for (auto &&[filePath, fileUnits] : dependents)
+    {
+        std::string directory = fs::path{filePath}.parent_path().string();
+        if(directoryWatched.count(directory) != 0)
+            continue;
+
+        int watch = ::inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE);
+        if(watch < 0)
+            continue;
+        watchedDirectories.emplace(watch, directory);
+        directoryWatched.insert(directory);
+    }
+
+    //Read here once, every build forked from now on starts out with them in memory
+    for (auto &&modulePath : modules)
+        Preprocessor::precompileModule(modulePath);
+    Preprocessor::takeNewlyLoadedModules();
+}
+
+void CompileWatcher::build(const BuildHandler& handler, const std::vector<std::string>& changedUnits)
+{
+    std::cout.flush();
+    pid_t pid = ::fork();
+    if(pid == 0)
+        std::exit(handler(changedUnits));
+
+    int status = 0;
+    if(pid < 0)
+        std::cout << "[CompilerError]: Watch mode failed to start a build\n";
+    else
+    {
+        while(::waitpid(pid, &status, 0) < 0 && errno == EINTR)
+            ;
+        if(!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            std::cout << "[Watch]: Build failed, output of the failed units is left as it was\n";
+    }
+    std::cout << "[Watch]: Watching " << dependents.size() << " files for changes..." << std::endl;
+}
+
+bool CompileWatcher::waitForChanges(std::unordered_set<std::string>& changedFiles)
+{
+    alignas(inotify_event) char buffer[16 * 1024];
+
+    //Waits as long as it takes for the first change, then only till changes stop coming
+    int timeout = -1;
+    while(true)
+    {
+        pollfd waiting{inotifyFd, POLLIN, 0};
+        int    ready = ::poll(&waiting, 1, timeout);
+        if(ready == 0)
+            return true;
+
+        ssize_t count = ready < 0 ? -1 : ::read(inotifyFd, buffer, sizeof(buffer));
+        if(count < 0) {
+            if(errno == EINTR)
+                continue;
+            return false;
+        }
+
+        for (char* at = buffer; at < buffer + count;)
+        {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(at);
+            at += sizeof(inotify_event) + event->len;
+
+            //Events got lost, anything could have changed
+            if(event->mask & IN_Q_OVERFLOW) {
+                for (auto &&[filePath, fileUnits] : dependents)
+                    changedFiles.insert(filePath);
+                timeout = WATCH_SETTLE_MS;
+                continue;
+            }
+
+            auto directory = watchedDirectories.find(event->wd);
+            if(directory == watchedDirectories.end() || event->len == 0)
+                continue;
+
+            std::string filePath = (fs::path{directory->second} / event->name).string();
+            if(dependents.count(filePath) != 0) {
+                changedFiles.insert(std::move(filePath));
+                timeout = WATCH_SETTLE_MS;
+            }
+        }
+    }
+}
+
+#else
+
+//No inotify to speak of
+bool CompileWatcher::run(const BuildHandler&)                                          { return false; }
+void CompileWatcher::scanUnits()                                                       {}
+void CompileWatcher::build(const BuildHandler&, const std::vector<std::string>&)       {}
+bool CompileWatcher::waitForChanges(std::unordered_set<std::string>&)                  { return false; }
+
+#endif
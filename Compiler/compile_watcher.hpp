@@ -0,0 +1,53 @@
+/* Watch mode (--watch), builds every unit once and then again whenever its source or any file it includes changes.
+ * Directories of every watched file are watched with inotify (editors usually save by renaming a new file over the
+ * old one), changes arriving close together are built together. Only units depending on a changed file get built,
+ * every build happens in a child forked off the watcher so an error ends that build and never the watcher.
+ * Defines only modules stay read in the watcher, every build starts out with them in memory (see Preprocessor),
+ * and only the ones that changed are read again.
+ * Units themselves are always lexed, parsed and generated again as a whole, there is no AST or bytecode kept per module:
+ *  - included code is lexed as part of the unit including it (macros and includes work on tokens), so the same
+ *    module can give different code in every unit and there is nothing of it to reuse on its own
+ *  - function indices and the string table belong to the whole .cflx, reusing part of a unit would need a linker
+ *  - any error ends the process (printError), a build in a forked child is the only thing that keeps the watcher alive
+ * Linux only.
+*/
+#ifndef UNNAMED_COMPILE_WATCHER_HPP
+#define UNNAMED_COMPILE_WATCHER_HPP
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class CompileWatcher
+{
+    public:
+        //Builds 'units' inside of the forked child, returns exit code
+        using BuildHandler = std::function<int(const std::vector<std::string>& units)>;
+
+        explicit CompileWatcher(const std::vector<std::string>& units)
+            : units(units)
+        {}
+
+        //Builds until killed, false if files can't be watched at all
+        bool run(const BuildHandler& build);
+
+    private:
+        void scanUnits();
+        void build(const BuildHandler& handler, const std::vector<std::string>& changedUnits);
+        bool waitForChanges(std::unordered_set<std::string>& changedFiles);
+
+    private:
+        std::vector<std::string> units;
+
+        //Absolute path of every file units depend on (themselves included) -> units depending on it
+        std::unordered_map<std::string, std::vector<std::string>> dependents;
+        //Watched directories by inotify watch descriptor, and the other way around
+        std::unordered_map<int, std::string> watchedDirectories;
+        std::unordered_set<std::string>      directoryWatched;
+
+        int inotifyFd = -1;
+};
+
+#endif
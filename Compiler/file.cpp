@@ -1,102 +1,446 @@
+#include <climits>
+#include <cstdio>
+#include <cstring>
+
 #include "file.hpp"
-/*
-    WILL OPTIMIZE THIS IN FUTURE, RN ITS HORRENDOUS
-*/
+#include "replace_file.hpp"
 
-//-----------------
-void FileWriter::writeToFile(const ListOfInstruction &commands)
+//-----------------COMPACT ENCODING-----------------
+static void writeULEB128(std::vector<Byte>& out, std::uint64_t value)
+{
+    do {
+        std::uint8_t byte = value & 0x7F;
+        value >>= 7;
+        out.push_back(static_cast<Byte>(value ? (byte | 0x80) : byte));
+    } while(value);
+}
+
+static void writeSLEB128(std::vector<Byte>& out, std::int64_t value)
+{
+    while(true)
+    {
+        std::uint8_t byte = value & 0x7F;
+        value >>= 7; //Arithmetic shift
+        bool done = (value == 0 && !(byte & 0x40)) || (value == -1 && (byte & 0x40));
+        out.push_back(static_cast<Byte>(done ? byte : (byte | 0x80)));
+        if(done)
+            return;
+    }
+}
+
+template<typename T>
+static void writeRaw(std::vector<Byte>& out, T value)
+{
+    const Byte* bytes = reinterpret_cast<const Byte*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+//'index' is inside of the function owning the instruction
+static void encodeCompactInstruction(std::vector<Byte>& out, const VMInstruction& inst, std::size_t index)
+{
+    const OpcodeInfo& info = opcodeInfo(inst.inst);
+
+    //Short forms first, they only exist in compact code
+    if(inst.inst == PUSH_INT64 && inst.operand.i64 >= INT8_MIN && inst.operand.i64 <= INT8_MAX) {
+        out.push_back(static_cast<Byte>(PUSH_SMALL_INT));
+        out.push_back(static_cast<Byte>(static_cast<std::int8_t>(inst.operand.i64)));
+        return;
+    }
+
+    std::int64_t relative = static_cast<std::int64_t>(inst.operand.u64) - static_cast<std::int64_t>(index);
+    if(inst.inst == JUMP)
+    {
+        //Most jumps (Continue, Else, loop back edges) are short
+        if(relative >= INT8_MIN && relative <= INT8_MAX) {
+            out.push_back(static_cast<Byte>(JUMP_SHORT));
+            writeRaw(out, static_cast<std::int8_t>(relative));
+            return;
+        }
+        if(relative >= INT16_MIN && relative <= INT16_MAX) {
+            out.push_back(static_cast<Byte>(JUMP_SHORT16));
+            writeRaw(out, static_cast<std::int16_t>(relative));
+            return;
+        }
+    }
+
+    out.push_back(static_cast<Byte>(inst.inst));
+
+    switch (info.operand)
+    {
+        case OPERAND_NONE:
+            break;
+        case OPERAND_INT64:
+            writeSLEB128(out, inst.operand.i64);
+            break;
+        case OPERAND_FLOAT:
+            writeRaw(out, inst.operand.f64);
+            break;
+        case OPERAND_UINT64:
+            writeULEB128(out, inst.operand.u64);
+            break;
+        case OPERAND_CONST:
+            writeULEB128(out, inst.operand.u32);
+            break;
+        case OPERAND_UINT16:
+            writeULEB128(out, inst.operand.u16);
+            break;
+        case OPERAND_SLOT:
+            writeULEB128(out, inst.operand.u16);
+            writeULEB128(out, inst.scopeIndex);
+            break;
+        case OPERAND_TARGET:
+            writeRaw(out, static_cast<std::int32_t>(relative));
+            break;
+        case OPERAND_RETURN:
+            writeULEB128(out, ((inst.operand.u64 & ~RETURN_VALUE_BIT) << 1) | ((inst.operand.u64 & RETURN_VALUE_BIT) ? 1 : 0));
+            break;
+    }
+}
+
+//-----------------STACK DEPTH-----------------
+void StackDepthTracker::feed(const VMInstruction& inst, std::uint64_t index, const std::vector<CflxFunction>& descriptors)
 {
-    //1st pass
-    try {
-        for (auto &&cmd : commands)
+    if(!depth)
+    {
+        //Dead code (after Return, Break, ...), nothing there ever runs
+        auto target = targetDepths.find(index);
+        if(target == targetDepths.end())
+            return;
+        depth = target->second;
+    }
+
+    const OpcodeInfo& info   = opcodeInfo(inst.inst);
+    std::uint64_t     pops   = info.pops;
+    std::uint64_t     pushes = info.pushes;
+
+    switch (inst.inst)
+    {
+        case ITER_INIT:
+            pops = ((inst.operand.u16 & 0xFF00) >> 8) == RANGE_ITERATOR ? 3 : 0;
+            break;
+        case FUNC_VARGS:
+            pendingVargs.push_back(inst.operand.u64);
+            break;
+        case FUNC_CALL:
         {
-            //Write Instruction to file first
-            outFile.put(static_cast<Byte>(cmd.inst));
-
-            //Write operand to file second, depending on what instruction, cast string operand to specific type
-            switch (cmd.inst)
-            {
-                case PUSH_INT64:
-                    outFile.write(reinterpret_cast<const Byte*>(&std::get<std::int64_t>(cmd.value)), sizeof(std::int64_t));
-                    break;
-                case PUSH_UINT64:
-                    outFile.write(reinterpret_cast<const Byte*>(&std::get<std::uint64_t>(cmd.value)), sizeof(std::uint64_t));
-                    break;
-                case PUSH_FLOAT:
-                    outFile.write(reinterpret_cast<const Byte*>(&std::get<std::double_t>(cmd.value)), sizeof(std::double_t));
-                    break;
-
-                case REASSIGN_VAR:
-                case REASSIGN_VAR_NO_POP:
-                case ACCESS_VAR:
-                {
-                //Write value and scope index to file
-                    writeStringToFile(std::get<std::string>(cmd.value));
-                    //16bit uint value
-                    std::uint16_t params16Bit = cmd.scopeIndexIfNeeded;
-                    outFile.write(reinterpret_cast<Byte*>(&params16Bit), sizeof(std::uint16_t));
-                }
-                break;
-
-                case ASSIGN_VAR:
-                case ASSIGN_VAR_NO_POP:
-                //Same for these
-                case DATAINST_ITER_ID:
-                    writeStringToFile(std::get<std::string>(cmd.value));
-                    break;
-                
-                //Same logic for these instructions as well
-                case DESTROY_MULTIPLE_SYMBOL_TABLES:
-                {
-                    //16bit uint value
-                    std::uint16_t params16Bit = cmd.scopeIndexIfNeeded;
-                    outFile.write(reinterpret_cast<Byte*>(&params16Bit), sizeof(std::uint16_t));
-                }
-                break;
-                case ITER_INIT:
-                case FUNC_END:
-                case BUILTIN_CALL:
-                {
-                    //Difference being, this uses .value instead of .scopeIndexIfNeeded
-                    std::uint16_t params16Bit = std::get<std::uint16_t>(cmd.value);
-                    outFile.write(reinterpret_cast<Byte*>(&params16Bit), sizeof(std::uint16_t));
-                }
-                break;
-                
-                case JUMP_IF_FALSE:
-                case JUMP:
-                //Iter has next and next / Function call and destroy / Return pretty much have same operands as jump instructions
-                case ITER_HAS_NEXT:
-                case ITER_NEXT:
-                case FUNC_START:
-                case FUNC_CALL:
-                case FUNC_VARGS:
-                case RETURN:
-                {
-                    auto offset = std::get<std::size_t>(cmd.value);
-                    outFile.write(reinterpret_cast<Byte*>(&offset), sizeof(std::size_t));
-                }
-                break;
+            //Params, then vargs and their count, then return address
+            const CflxFunction& callee = descriptors[inst.operand.u64];
+            pops = callee.paramCount + 1;
+            if(callee.vargsType != EVAL_UNKNOWN) {
+                pops += 1 + pendingVargs.back();
+                pendingVargs.pop_back();
             }
         }
+        break;
+        case BUILTIN_CALL:
+        {
+            const BuiltinSignature& builtin = builtinSignatures[inst.operand.u16];
+            pops   = builtin.argCount == BUILTIN_VARGS ? 1 + lastConstant : builtin.argCount;
+            pushes = builtin.returnsValue;
+        }
+        break;
+        case RETURN:
+            pops = (inst.operand.u64 & RETURN_VALUE_BIT) ? 1 : 0;
+            break;
+        default:
+            break;
+    }
+    if(inst.inst == PUSH_UINT64)
+        lastConstant = inst.operand.u64;
+
+    *depth   = static_cast<std::uint32_t>(*depth - pops + pushes);
+    maxDepth = std::max(maxDepth, *depth);
+
+    switch (info.branch)
+    {
+        case BRANCH_CONDITIONAL:
+            targetDepths.emplace(inst.operand.u64, *depth);
+            break;
+        case BRANCH_ALWAYS:
+            targetDepths.emplace(inst.operand.u64, *depth);
+            depth.reset();
+            break;
+        //FUNC_END is always reached with an empty stack
+        case BRANCH_RETURN:
+        case BRANCH_END:
+            depth.reset();
+            break;
+        default:
+            break;
     }
-    catch(std::bad_variant_access bva)
+}
+
+static std::uint16_t checkedMaxStack(const StackDepthTracker& depth)
+{
+    if(depth.getMaxDepth() > UINT16_MAX) {
+        std::cerr << "[FileWritingError] Expression nesting is too deep, operand stack would need " << depth.getMaxDepth() << " entries" << std::endl;
+        std::exit(1);
+    }
+    return static_cast<std::uint16_t>(depth.getMaxDepth());
+}
+
+//-----------------
+FileWriter::FileWriter(const char* fileName, bool compactCode)
+    : fileName(fileName), compactCode(compactCode)
+{
+    //File is only put in place by finish() (see replace_file.hpp), an interpreter running the old one keeps running it.
+    //Bad path still fails before anything is compiled, nothing is left behind if compilation fails instead
+    std::string probePath = temporaryPathFor(this->fileName);
+    std::FILE*  probe     = std::fopen(probePath.c_str(), "wb");
+    if (probe == nullptr) {
+        std::cerr << "[FileWritingError] Error opening file: " << fileName << std::endl;
+        std::exit(1);
+    }
+    std::fclose(probe);
+    std::remove(probePath.c_str());
+
+    //Header and section table are filled in by finish(), code section comes right after them
+    out.resize(sizeof(CflxHeader) + CFLX_WRITER_SECTION_COUNT * sizeof(CflxSection), 0);
+    beginSection(compactCode ? CFLX_SECTION_COMPACT_CODE : CFLX_SECTION_CODE);
+
+    openFunctions.emplace_back(0, ListOfVMInstruction{});
+}
+
+void FileWriter::writeToFile(const ListOfVMInstruction &commands, const std::vector<ILFunctionInfo>& functionInfo, const std::vector<ILLineInfo>& lineInfo, const SymbolInterner& symbols)
+{
+    writeChunk(commands, functionInfo, lineInfo, symbols);
+    finish(commands.front().operand.u16);
+}
+
+void FileWriter::writeChunk(const ListOfVMInstruction &commands, const std::vector<ILFunctionInfo>& functionInfo, const std::vector<ILLineInfo>& lineInfo, const SymbolInterner& symbols)
+{
+    if(commands.empty())
+        return;
+
+    //IL addresses (FUNC_CALL operands, line table, starting addresses) keep counting across chunks
+    std::size_t base = ilAddress;
+    ilAddress += commands.size();
+
+    std::unordered_map<std::size_t, const ILFunctionInfo*> infoByAddress;
+    for (auto &&info : functionInfo)
+        infoByAddress.emplace(info.starting_addr, &info);
+
+    symbolOffsets.resize(symbols.size(), 0);
+    auto addString = [&](SymbolId symbol) {
+        if(symbolOffsets[symbol] == 0) {
+            std::string_view name = symbols.nameOf(symbol);
+            symbolOffsets[symbol] = static_cast<std::uint32_t>(strings.size());
+            strings.insert(strings.end(), name.begin(), name.end());
+            strings.push_back('\0');
+        }
+        return symbolOffsets[symbol];
+    };
+
+    auto internConstant = [&](VMInstruction& inst) {
+        std::uint8_t type = inst.inst == PUSH_INT64 ? EVAL_INT : EVAL_FLOAT;
+        auto [it, inserted] = constantIndex.emplace(std::make_pair(type, inst.operand.u64), static_cast<std::uint32_t>(constants.size()));
+        if(inserted) {
+            CflxConstant constant{};
+            constant.bits = inst.operand.u64;
+            constant.type = type;
+            constants.push_back(constant);
+        }
+
+        inst = VMInstruction{PUSH_CONST};
+        inst.operand.u32 = it->second;
+    };
+
+    auto nextLine = lineInfo.begin();
+
+    for (std::size_t i = 0; i < commands.size(); ++i)
     {
-        std::cout << "1st PASS EXCEPTIOM: " << bva.what() << '\n';
+        const VMInstruction& cmd     = commands[i];
+        std::size_t          address = base + i;
+
+        if(cmd.inst == FUNC_START)
+        {
+            //FUNC_CALL operands refer to the instruction right after FUNC_START
+            const ILFunctionInfo& info = *infoByAddress.at(address + 1);
+            std::uint32_t         index = static_cast<std::uint32_t>(descriptors.size());
+
+            CflxFunction& descriptor = descriptors.emplace_back(CflxFunction{});
+            descriptor.nameOffset = addString(info.name);
+            descriptor.frameSize  = info.frame_size;
+            descriptor.paramCount = info.param_count;
+            descriptor.vargsType  = info.vargs_type;
+
+            if(info.is_top_level)
+                exports.push_back(CflxExport{descriptor.nameOffset, index});
+
+            functionIndices.emplace(address + 1, index);
+            openFunctions.emplace_back(index, ListOfVMInstruction{});
+        }
+
+        //Line of the statement starting here, FUNC_START belongs to the function it starts
+        //Main's code of earlier chunks is already out of 'openFunctions'
+        for (; nextLine != lineInfo.end() && nextLine->il_index == address; ++nextLine)
+            pendingLines.emplace_back(openFunctions.back().first,
+                                      openFunctions.back().second.size() + (openFunctions.size() == 1 ? mainLength : 0), nextLine->line);
+
+        if(cmd.inst == FUNC_START)
+            continue;
+
+        //ILGenerator already encoded it, only the parts depending on the whole program are left
+        VMInstruction& encoded = openFunctions.back().second.emplace_back(cmd);
+
+        //FUNC_CALL now refers to the callee descriptor, interpreter finds (or prepares) the body through it
+        if(encoded.inst == FUNC_CALL)
+            encoded.operand.u64 = functionIndices.at(encoded.operand.u64);
+
+        //Compact code has its own short form for small Ints, pool index wouldn't be any smaller
+        bool isSmallInt = encoded.inst == PUSH_INT64 && encoded.operand.i64 >= INT8_MIN && encoded.operand.i64 <= INT8_MAX;
+        if((encoded.inst == PUSH_INT64 && !(compactCode && isSmallInt)) || encoded.inst == PUSH_FLOAT)
+            internConstant(encoded);
+
+        if(cmd.inst == FUNC_END) {
+            writeFunctionCode(openFunctions.back().first, openFunctions.back().second);
+            openFunctions.pop_back();
+        }
     }
-    catch(std::exception e)
+
+    //Whatever main got out of this chunk, functions are never left open between chunks
+    writeMainCode(openFunctions.front().second);
+    openFunctions.front().second.clear();
+}
+
+void FileWriter::writeFunctionCode(std::size_t index, const ListOfVMInstruction& body)
+{
+    CflxFunction& descriptor = descriptors[index];
+    descriptor.codeOffset = codeLength;
+    descriptor.codeLength = body.size();
+
+    //Callers are checked against the descriptor alone, callee body may not even be loaded yet
+    for (auto &&inst : body)
+        if(inst.inst == RETURN && (inst.operand.u64 & RETURN_VALUE_BIT))
+            descriptor.flags = CFLX_FUNCTION_RETURNS_VALUE;
+
+    StackDepthTracker depth{descriptor.paramCount};
+    for (std::size_t i = 0; i < body.size(); ++i)
+        depth.feed(body[i], i, descriptors);
+    descriptor.maxStack = checkedMaxStack(depth);
+
+    if(compactCode)
     {
-        std::cout << "1st PASS EXCEPTIOM: " << e.what() << '\n';
+        if(compactLength > UINT32_MAX) {
+            std::cerr << "[FileWritingError] Compact code is too big, compile without --compact" << std::endl;
+            std::exit(1);
+        }
+        descriptor.compactOffset = static_cast<std::uint32_t>(compactLength);
+
+        std::size_t start = out.size();
+        for (std::size_t i = 0; i < body.size(); ++i)
+            encodeCompactInstruction(out, body[i], i);
+        compactLength += out.size() - start;
     }
+    else
+        writeBytes(body.data(), body.size() * sizeof(VMInstruction));
+
+    codeLength += body.size();
 }
 
-//-----------------Helper functions-----------------
-void FileWriter::writeStringToFile(const std::string& str)
+void FileWriter::writeMainCode(const ListOfVMInstruction& code)
 {
-    //Write length of the string first
-    std::size_t length = str.size();
-    outFile.write(reinterpret_cast<const Byte*>(&length), sizeof(length));
+    //ALLOC_FRAME main starts with is written by finish(), frame size isn't known yet
+    std::size_t first = mainLength == 0 && !code.empty() ? 1 : 0;
+
+    for (std::size_t i = 0; i < code.size(); ++i)
+        mainDepth.feed(code[i], mainLength + i, descriptors);
 
-    //Write the actual data now
-    outFile.write(str.data(), length);
+    if(compactCode)
+        for (std::size_t i = first; i < code.size(); ++i)
+            encodeCompactInstruction(mainCode, code[i], mainLength + i);
+    else if(first < code.size()) {
+        const Byte* bytes = reinterpret_cast<const Byte*>(code.data() + first);
+        mainCode.insert(mainCode.end(), bytes, bytes + (code.size() - first) * sizeof(VMInstruction));
+    }
+
+    mainLength += code.size();
+}
+
+void FileWriter::finish(std::uint16_t globalFrameSize)
+{
+    //Main goes after every function
+    VMInstruction allocFrame{ALLOC_FRAME};
+    allocFrame.operand.u16 = globalFrameSize;
+
+    if(compactCode && compactLength > UINT32_MAX) {
+        std::cerr << "[FileWritingError] Compact code is too big, compile without --compact" << std::endl;
+        std::exit(1);
+    }
+
+    CflxFunction& main = descriptors.front();
+    main.codeOffset    = codeLength;
+    main.codeLength    = mainLength;
+    main.frameSize     = globalFrameSize;
+    main.vargsType     = EVAL_UNKNOWN;
+    main.compactOffset = static_cast<std::uint32_t>(compactLength);
+    main.maxStack      = checkedMaxStack(mainDepth);
+
+    if(compactCode)
+        encodeCompactInstruction(out, allocFrame, 0);
+    else
+        writeRaw(out, allocFrame);
+    out.insert(out.end(), mainCode.begin(), mainCode.end());
+    std::vector<Byte>{}.swap(mainCode);
+
+    endSection();
+
+    std::vector<CflxLine> lines;
+    lines.reserve(pendingLines.size());
+    for (auto &&[function, index, line] : pendingLines)
+        lines.push_back(CflxLine{static_cast<std::uint32_t>(descriptors[function].codeOffset + index), line});
+    std::stable_sort(lines.begin(), lines.end(), [](const CflxLine& a, const CflxLine& b) { return a.codeOffset < b.codeOffset; });
+
+    writeSection(CFLX_SECTION_CONSTANT_POOL, constants.data(),   constants.size()   * sizeof(CflxConstant));
+    writeSection(CFLX_SECTION_STRING_TABLE,  strings.data(),     strings.size());
+    writeSection(CFLX_SECTION_FUNCTIONS,     descriptors.data(), descriptors.size() * sizeof(CflxFunction));
+    writeSection(CFLX_SECTION_DEBUG_LINES,   lines.data(),       lines.size()       * sizeof(CflxLine));
+    writeSection(CFLX_SECTION_EXPORTS,       exports.data(),     exports.size()     * sizeof(CflxExport));
+
+    out.resize(out.size() + (CFLX_SECTION_ALIGNMENT - out.size() % CFLX_SECTION_ALIGNMENT) % CFLX_SECTION_ALIGNMENT, 0);
+
+    //Section table, then everything after the header goes into the checksum
+    std::memcpy(out.data() + sizeof(CflxHeader), sections.data(), sections.size() * sizeof(CflxSection));
+
+    CflxHeader header{};
+    std::memcpy(header.magic, CFLX_MAGIC, sizeof(header.magic));
+    header.versionMajor = CFLX_VERSION_MAJOR;
+    header.versionMinor = CFLX_VERSION_MINOR;
+    header.flags        = static_cast<std::uint32_t>(CFLX_FLAG_HAS_DEBUG_LINES | (compactCode ? CFLX_FLAG_COMPACT_CODE : CFLX_FLAG_NONE));
+    header.sectionCount = static_cast<std::uint32_t>(sections.size());
+    header.checksum     = cflxChecksum(out.data() + sizeof(CflxHeader), out.size() - sizeof(CflxHeader));
+    std::memcpy(out.data(), &header, sizeof(CflxHeader));
+
+    if(!replaceFileContents(fileName, out.data(), out.size())) {
+        std::cerr << "[FileWritingError] Error writing the compiled file: " << fileName << std::endl;
+        std::exit(1);
+    }
+}
+
+void FileWriter::beginSection(CflxSectionType type)
+{
+    out.resize(out.size() + (CFLX_SECTION_ALIGNMENT - out.size() % CFLX_SECTION_ALIGNMENT) % CFLX_SECTION_ALIGNMENT, 0);
+
+    CflxSection section{};
+    section.type   = type;
+    section.offset = out.size();
+    sections.push_back(section);
+}
+
+void FileWriter::endSection()
+{
+    sections.back().size = out.size() - sections.back().offset;
+}
+
+void FileWriter::writeSection(CflxSectionType type, const void* data, std::size_t size)
+{
+    beginSection(type);
+    writeBytes(data, size);
+    endSection();
+}
+
+void FileWriter::writeBytes(const void* data, std::size_t size)
+{
+    const Byte* bytes = static_cast<const Byte*>(data);
+    out.insert(out.end(), bytes, bytes + size);
 }
@@ -1,30 +1,116 @@
 #ifndef UNNAMED_FILE_WRITER_HPP
 #define UNNAMED_FILE_WRITER_HPP
 
-#include <fstream>
+#include <cstdio>
+#include <unordered_map>
+#include <algorithm>
+#include <map>
+#include <optional>
 
 #include "ilgen.hpp"
 #include "../Common/common.hpp"
+#include "../Common/cflx_format.hpp"
+#include "../Common/opcode_table.hpp"
 
 using Byte = char;
 
+//Deepest the operand stack gets inside of a function, counted the same way verifier does (params are on stack
+//at entry). Code is fed in order, main comes a few statements at a time, jumps are indices inside of the function.
+//Every reachable instruction is either reached by falling through or by a jump from above it
+//(loops jump back to code already seen), so one pass is enough
+class StackDepthTracker
+{
+    public:
+        explicit StackDepthTracker(std::uint32_t entryDepth)
+            : depth(entryDepth), maxDepth(entryDepth)
+        {}
+
+        //FUNC_CALL operand has to be the callee descriptor index already
+        void          feed(const VMInstruction&, std::uint64_t index, const std::vector<CflxFunction>& descriptors);
+        std::uint32_t getMaxDepth() const { return maxDepth; }
+
+    private:
+        //Before the next instruction, nothing if falling through can't get there
+        std::optional<std::uint32_t>                     depth;
+        std::uint32_t                                    maxDepth;
+        //Depth at targets of jumps seen so far
+        std::unordered_map<std::uint64_t, std::uint32_t> targetDepths;
+        //FUNC_VARGS of calls whose arguments are being pushed, innermost last
+        std::vector<std::uint64_t>                       pendingVargs;
+        //Operand of the last PUSH_UINT64, argument count of a builtin taking vargs comes right before the call
+        std::uint64_t                                    lastConstant = 0;
+};
+
+//Number of sections every .cflx gets, the section table has a fixed size so code can be written right after it
+#define CFLX_WRITER_SECTION_COUNT 6
+
+/* Code is encoded as soon as its IL is handed over, IL can come all at once or a few top level statements at a time
+ * (streaming, see main.cpp). Whole file is built in memory, functions go into it the moment they end, main only ends
+ * with the program so it is kept aside and goes after every function.
+ * Anything that is only known at the end (global frame size, section table, checksum) is patched in by finish(),
+ * which writes the file out with a single write and puts it in place with a single rename.
+*/
 class FileWriter {
     public:
-        FileWriter(const char* fileName) {
-            outFile.open(fileName, std::ios_base::binary);
+        //'compactCode' writes variable length encoded code, smaller file but interpreter has to expand it on load
+        FileWriter(const char* fileName, bool compactCode = false);
+
+        //Whole program at once
+        void writeToFile(const ListOfVMInstruction&, const std::vector<ILFunctionInfo>&, const std::vector<ILLineInfo>&, const SymbolInterner&);
 
-            if (!outFile.is_open()) {
-                std::cerr << "[FileWritingError] Error opening file: " << fileName << std::endl;
-                std::exit(1);
-            }
-        }
+        //Streaming, IL of whole top level statements (a function is never cut in half), none of it is needed afterwards.
+        //Function names are SymbolId's, 'symbols' gives them back for the string table
+        void writeChunk(const ListOfVMInstruction&, const std::vector<ILFunctionInfo>&, const std::vector<ILLineInfo>&, const SymbolInterner&);
+        //'globalFrameSize' replaces whatever the ALLOC_FRAME main starts with said, its only known once everything is parsed
+        void finish(std::uint16_t globalFrameSize);
 
-        void writeToFile(const ListOfInstruction& commands);
-    
     private:
-        void writeStringToFile(const std::string& str);
+        void writeFunctionCode(std::size_t, const ListOfVMInstruction&);
+        void writeMainCode(const ListOfVMInstruction&);
+        void beginSection(CflxSectionType);
+        void endSection();
+        void writeSection(CflxSectionType, const void*, std::size_t);
+        void writeBytes(const void*, std::size_t);
+
     private:
-        std::ofstream outFile;
+        //Replaced once by finish()
+        std::string       fileName;
+        bool              compactCode;
+        //Every byte of the file, in order
+        std::vector<Byte> out;
+        //IL handed over so far, IL addresses of the next chunk start here
+        std::size_t       ilAddress = 0;
+
+        //Main's code but for the ALLOC_FRAME it starts with, 'mainLength' counts that one too
+        std::vector<Byte> mainCode;
+        std::uint64_t     mainLength = 0;
+        StackDepthTracker mainDepth{0};
+
+        //Code written so far, in instructions (compact code counts them too, line table and descriptors use them) and in bytes
+        std::uint64_t codeLength    = 0;
+        std::uint64_t compactLength = 0;
+
+        //Functions in the order they start (0 is main), FUNC_CALL refers to this index. Callee is always declared
+        //before the call so its index is known by the time the call is written, even for recursive calls
+        std::vector<CflxFunction>                       descriptors = {CflxFunction{}};
+        std::unordered_map<std::size_t, std::uint32_t>  functionIndices;
+        //Bodies of the functions being written right now (nested ones on top), main at the bottom
+        std::vector<std::pair<std::uint32_t, ListOfVMInstruction>> openFunctions;
+
+        //Every literal is stored once, no matter how many times it shows up
+        std::vector<CflxConstant>                                        constants;
+        std::map<std::pair<std::uint8_t, std::uint64_t>, std::uint32_t> constantIndex;
+
+        //String table, offset 0 is the empty string (name of main), every name is stored once
+        //Indexed by SymbolId, 0 means the name isn't in the table yet (no function is named "")
+        std::vector<Byte>          strings = {'\0'};
+        std::vector<std::uint32_t> symbolOffsets;
+
+        std::vector<CflxExport> exports;
+        //Function, index inside of it and line. Main's code offset is only known at the end
+        std::vector<std::tuple<std::uint32_t, std::uint64_t, std::uint32_t>> pendingLines;
+
+        std::vector<CflxSection> sections;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -1,48 +1,493 @@
 #include "ilgen.hpp"
 
 //---------------HELPER FUNCTIONS---------------
+//Instructions go straight into the form FileWriter writes them in, operand in the member interpreter reads it from
+std::size_t ILGenerator::emit(ILInstruction inst, std::uint64_t operand, std::uint16_t scope_index)
+{
+    il_code.emplace_back(inst).scopeIndex = scope_index;
+    patch(il_code.size() - 1, operand);
+    return il_code.size() - 1;
+}
+
+void ILGenerator::emit_float(double value)
+{
+    il_code.emplace_back(ILInstruction::PUSH_FLOAT).operand.f64 = value;
+}
+
+void ILGenerator::patch(std::size_t index, std::uint64_t operand)
+{
+    //Int operands are patched as their two's complement bits, same thing as writing i64
+    VMInstruction& instruction = il_code[index];
+    switch (operandSize(opcodeInfo(instruction.inst).operand))
+    {
+        case sizeof(std::uint16_t):
+            instruction.operand.u16 = static_cast<std::uint16_t>(operand);
+            break;
+        case sizeof(std::uint32_t):
+            instruction.operand.u32 = static_cast<std::uint32_t>(operand);
+            break;
+        default:
+            instruction.operand.u64 = operand;
+    }
+}
+
 void ILGenerator::handleBreakIfExists(std::size_t jump_offset)
 {
     //Not empty = break exists
     if(!cb_info.back().second.empty())
         //Update operands for Break instruction
         for (auto &&i : cb_info.back().second)
-            il_code[i].value = jump_offset;
+            patch(i, jump_offset);
     //Empty = no break exists, dont do anything
 }
 
 void ILGenerator::handleReturnIfExists(std::size_t func_end_offset)
 {
-    constexpr std::size_t num_bits = sizeof(std::size_t) * CHAR_BIT;
-    constexpr std::size_t top_bit  = (std::size_t)1 << (num_bits - 1);
-
     for (auto&& i : return_addr.back())
     {
-        std::int64_t val = std::get<std::int64_t>(il_code[i].value);
+        std::int64_t val = il_code[i].operand.i64;
 
         //If we can return, set the top most bit 
         //Assumption that the offset will never give a number so big it spans all the bits of 64bit number
-        il_code[i].value = (val == -1) ? func_end_offset : (func_end_offset | top_bit);
+        patch(i, (val == -1) ? func_end_offset : (func_end_offset | RETURN_VALUE_BIT));
+    }
+}
+
+//Listing format, IL as its handed over (every jump patched) one record per instruction. Called once for whatever
+//is generated right before it goes out, so each instruction is listed exactly once even while streaming
+void ILGenerator::traceGenerated()
+{
+    if(!traceBuiltIn || !Tracer::isListing() || !Tracer::enabled(TRACE_ILGEN, TRACE_DETAIL))
+        return;
+
+    for (std::size_t i = 0; i < il_code.size(); ++i)
+    {
+        const VMInstruction& instruction = il_code[i];
+
+        std::ostream& line = Tracer::beginLine(TRACE_ILGEN, TRACE_DETAIL);
+        line << "il\t" << il_base + i << '\t' << ILInstructionToString(instruction.inst) << '\t';
+        switch (opcodeInfo(instruction.inst).operand)
+        {
+            case OPERAND_INT64:  line << instruction.operand.i64; break;
+            case OPERAND_FLOAT:  line << instruction.operand.f64; break;
+            case OPERAND_CONST:  line << instruction.operand.u32; break;
+            case OPERAND_UINT16:
+            case OPERAND_SLOT:   line << instruction.operand.u16; break;
+            default:             line << instruction.operand.u64;
+        }
+        line << '\t' << instruction.scopeIndex;
+        Tracer::endLine();
+    }
+}
+
+void ILGenerator::destroyActiveIterators()
+{
+    //Leaving the function from inside of For loops, iterators would be left on iterator stack otherwise
+    for (std::size_t i = 0; i < active_iterators.back(); ++i)
+    {
+        IL_TRACE("ITER_END");
+        emit(ILInstruction::ITER_END);
+        INC_CURRENT_OFFSET
+    }
+}
+
+void ILGenerator::recordLine(const ASTPtr& statement)
+{
+    recordLine(statement->line);
+}
+
+void ILGenerator::recordLine(std::uint32_t line)
+{
+    //Few statements on the same line only need one entry, 0 is for nodes parser didn't create as statements
+    if(line == 0 || (!line_info.empty() && line_info.back().line == line))
+        return;
+
+    line_info.push_back(ILLineInfo{GET_IL_ADDRESS, line});
+}
+
+void ILGenerator::discardValueIfExists(const ASTPtr& statement)
+{
+    //Expression statements inside of blocks leave their value on stack, pop it so stack depth stays the same
+    //across loop iterations and branches (verifier in interpreter checks that)
+    bool leaves_value = false;
+    switch (statement->getTag())
+    {
+        case ASTTag::Value:
+        case ASTTag::Binary:
+        case ASTTag::Unary:
+        case ASTTag::VarAccess:
+        case ASTTag::Cast:
+            leaves_value = true;
+            break;
+        case ASTTag::Ternary:
+        case ASTTag::BuiltinFunctionCall:
+            leaves_value = statement->evaluateExprType() != EVAL_VOID;
+            break;
+        //Statements, and function calls which only push their return value when its used (USE_RETURN_VAL)
+        default:
+            break;
+    }
+
+    if(leaves_value) {
+        IL_TRACE("POP");
+        emit(ILInstruction::POP);
+        INC_CURRENT_OFFSET
+    }
+}
+
+//---------------STRENGTH REDUCTION---------------
+void ILGenerator::generateReducedBinaryOp(ASTBinaryOp& binary_op_node)
+{
+    //Induction variable already holds 'i * C', left and right are never generated
+    if(binary_op_node.reduction == ASTReduction::InductionVar)
+    {
+        const InductionVariable& induction_var = *binary_op_node.induction_var;
+
+        IL_TRACE("ACCESS_VAR " << symbols.nameOf(induction_var.identifier) << " SLOT: " << induction_var.slot);
+        IL_TRACE("SCOPE_INDEX: " << (int)induction_var.scope_index);
+        emit(ILInstruction::ACCESS_VAR, induction_var.slot, induction_var.scope_index);
+        INC_CURRENT_OFFSET
+        return;
+    }
+
+    binary_op_node.left->accept(*this, true);
+
+    switch (binary_op_node.reduction)
+    {
+        case ASTReduction::Square:
+            generateMulChain(2);
+            break;
+        case ASTReduction::MulChain:
+            generateMulChain(binary_op_node.reduction_operand);
+            break;
+        case ASTReduction::IntPow:
+            binary_op_node.right->accept(*this, true);
+            IL_TRACE("IPOW");
+            emit(ILInstruction::IPOW);
+            INC_CURRENT_OFFSET
+            break;
+        case ASTReduction::MulPow2:
+        case ASTReduction::DivPow2:
+        case ASTReduction::ModPow2:
+        {
+            ILInstruction instruction = binary_op_node.reduction == ASTReduction::MulPow2 ? ILInstruction::MUL_POW2
+                                      : binary_op_node.reduction == ASTReduction::DivPow2 ? ILInstruction::DIV_POW2
+                                      : ILInstruction::MOD_POW2;
+
+            IL_TRACE(ILInstructionToString(instruction) << ' ' << binary_op_node.reduction_operand);
+            emit(instruction, (std::uint16_t)binary_op_node.reduction_operand);
+            INC_CURRENT_OFFSET
+        }
+        break;
+        default:
+            printError("Unsupported strength reduction for Binary Operation. Operation type: ", binary_op_node.op_type);
+    }
+}
+
+//Value to be raised is on top of stack, x^N = x^(N/2) squared for even N, x * x^(N-1) for odd N
+void ILGenerator::generateMulChain(std::int64_t exponent)
+{
+    if(exponent <= 1)
+        return;
+
+    if(exponent % 2 == 0)
+    {
+        generateMulChain(exponent / 2);
+        IL_TRACE("DUP");
+        IL_TRACE("MUL");
+        emit(ILInstruction::DUP);
+        emit(ILInstruction::MUL);
+        INCN_CURRENT_OFFSET(2)
+        return;
+    }
+
+    IL_TRACE("DUP");
+    emit(ILInstruction::DUP);
+    INC_CURRENT_OFFSET
+
+    generateMulChain(exponent - 1);
+
+    IL_TRACE("MUL");
+    emit(ILInstruction::MUL);
+    INC_CURRENT_OFFSET
+}
+
+void ILGenerator::generateInductionVarsInit(ASTForNode& for_node)
+{
+    for (auto &&induction_var : for_node.induction_vars)
+    {
+        IL_TRACE("PUSH_INT64 " << induction_var->initial);
+        IL_TRACE("ASSIGN_VAR " << symbols.nameOf(induction_var->identifier) << " SLOT: " << induction_var->slot);
+        emit(ILInstruction::PUSH_INT64, induction_var->initial);
+        emit(ILInstruction::ASSIGN_VAR, induction_var->slot, induction_var->scope_index);
+        INCN_CURRENT_OFFSET(2)
+    }
+}
+
+void ILGenerator::generateInductionVarsStep(ASTForNode& for_node)
+{
+    for (auto &&induction_var : for_node.induction_vars)
+    {
+        IL_TRACE("ACCESS_VAR " << symbols.nameOf(induction_var->identifier) << " SLOT: " << induction_var->slot);
+        IL_TRACE("PUSH_INT64 " << induction_var->step);
+        IL_TRACE("ADD");
+        IL_TRACE("REASSIGN_VAR " << symbols.nameOf(induction_var->identifier) << " SLOT: " << induction_var->slot);
+        emit(ILInstruction::ACCESS_VAR, induction_var->slot, induction_var->scope_index);
+        emit(ILInstruction::PUSH_INT64, induction_var->step);
+        emit(ILInstruction::ADD);
+        emit(ILInstruction::REASSIGN_VAR, induction_var->slot, induction_var->scope_index);
+        INCN_CURRENT_OFFSET(4)
     }
 }
 
 //---------------INTERMEDIATE LANGUAGE -> BYTECODE GENERATOR---------------
-ListOfInstruction& ILGenerator::generateIL()
+ListOfVMInstruction& ILGenerator::generateIL()
 {
     if(!ast_statements.empty())
     {
+        generateProgramStart();
         for (auto &&ast : ast_statements)
-            ast->accept(*this, false);
-
-        //Manually add END_OF_FILE, cuz the code wont do it by itself
-        il_code.emplace_back(ILInstruction::END_OF_FILE);
-        std::cout << "EOF\n";
+            generateStatement(ast);
+        generateProgramEnd();
 
         return il_code;
     }
     printError("ILGenerator", "Failed to generate bytecode, no code provided.");
 }
 
+void ILGenerator::generateProgramStart()
+{
+    //Global frame is allocated once, every global variable (even the ones in blocks) has a slot in it
+    //While streaming its size isn't known yet, FileWriter patches it in the end
+    IL_TRACE("ALLOC_FRAME " << global_frame_size);
+    emit(ILInstruction::ALLOC_FRAME, global_frame_size);
+    INC_CURRENT_OFFSET
+}
+
+void ILGenerator::generateStatement(const ASTPtr& statement)
+{
+    recordLine(statement);
+    statement->accept(*this, false);
+}
+
+void ILGenerator::generateProgramEnd()
+{
+    //Manually add END_OF_FILE, cuz the code wont do it by itself
+    emit(ILInstruction::END_OF_FILE);
+    IL_TRACE("EOF");
+    traceGenerated();
+}
+
+void ILGenerator::clearGenerated()
+{
+    traceGenerated();
+
+    //Jumps are patched within the statement that made them, so nothing refers back into the cleared IL anymore
+    il_base += il_code.size();
+    il_code.clear();
+    function_info.clear();
+    line_info.clear();
+}
+
+void ILGenerator::generateBlockStatement(const ASTPtr& statement, bool is_sub_expr)
+{
+    recordLine(statement);
+    statement->accept(*this, is_sub_expr);
+    discardValueIfExists(statement);
+}
+
+//---------------CONTROL FLOW---------------
+//Each construct is split in pieces around its bodies, visitors call them around the nodes they have and
+//direct emission (-O0) calls them from parser as it goes. Jumps are backpatched once the body is generated
+void ILGenerator::generateIfStart(const ASTPtr& condition)
+{
+    condition->accept(*this, true);
+
+    IL_TRACE("JUMP_IF_FALSE (If)");
+    emit(ILInstruction::JUMP_IF_FALSE);
+    INC_CURRENT_OFFSET
+    pending_constructs.push_back(ILPendingConstruct{il_code.size() - 1, 0, {}, "If"});
+}
+
+void ILGenerator::generateElifStart(const ASTPtr& condition)
+{
+    condition->accept(*this, true);
+
+    emit(ILInstruction::JUMP_IF_FALSE);
+    INC_CURRENT_OFFSET
+    pending_constructs.back().patch_location = il_code.size() - 1;
+    pending_constructs.back().clause         = "Elif";
+
+    IL_TRACE("JUMP_IF_FALSE (Elif)");
+}
+
+void ILGenerator::generateIfBodyEnd()
+{
+    ILPendingConstruct& construct = pending_constructs.back();
+
+    //Unconditional jump to end of the whole If, every body has one so store them all
+    emit(ILInstruction::JUMP);
+    INC_CURRENT_OFFSET
+    construct.end_jumps.push_back(il_code.size() - 1);
+
+    IL_TRACE("JUMP (" << construct.clause << ")");
+
+    //False condition jumps to next Elif / Else / end
+    patch(construct.patch_location, GET_CURRENT_OFFSET);
+}
+
+void ILGenerator::generateIfEnd()
+{
+    //Whatever is at end is well the final location of end of "if condition"
+    for (auto &&idx : pending_constructs.back().end_jumps)
+        patch(idx, GET_CURRENT_OFFSET);
+
+    pending_constructs.pop_back();
+}
+
+void ILGenerator::generateForStart(ASTForNode& for_node)
+{
+    //Generate iterator instructions
+    for_node.range->accept(*this, false);
+
+    //Derived induction variables live in the same frame as the loop identifier
+    generateInductionVarsInit(for_node);
+
+    //We will evaluate range for next, interpreter will do the job of comparing and jumping
+    //We just provide the location to jump
+    //If the condition is false, it jumps else it doesnt
+    IL_LOOP_START
+    ++active_iterators.back();
+
+    IL_TRACE("ITER_HAS_NEXT LOC");
+    emit(ILInstruction::ITER_HAS_NEXT);
+    INC_CURRENT_OFFSET
+    pending_constructs.push_back(ILPendingConstruct{il_code.size() - 1, GET_CURRENT_OFFSET - 1, {}, "For"});
+
+    //Assign the start value to the identifier using some weird instructions
+    IL_TRACE("ITER_CURRENT");
+    emit(ILInstruction::ITER_CURRENT);
+    INC_CURRENT_OFFSET
+
+    //Bump them before the body, so 'Continue' (which jumps straight to ITER_NEXT) can't skip it
+    generateInductionVarsStep(for_node);
+}
+
+void ILGenerator::generateForEnd()
+{
+    const ILPendingConstruct& construct = pending_constructs.back();
+
+    //Go past the current value and loop again
+    IL_TRACE("ITER_NEXT " << construct.start);
+    emit(ILInstruction::ITER_NEXT, construct.start);
+    INC_CURRENT_OFFSET
+
+    //After this location is where its going to jump if condition is false, same for Break
+    //Both of them land on ITER_END which destroys the iterator
+    patch(construct.patch_location, GET_CURRENT_OFFSET);
+    IL_TRACE("IHN LOC: " << GET_CURRENT_OFFSET);
+
+    //Check if break exists in our code and handle it accordingly
+    handleBreakIfExists(GET_CURRENT_OFFSET);
+
+    IL_TRACE("ITER_END");
+    emit(ILInstruction::ITER_END);
+    INC_CURRENT_OFFSET
+
+    --active_iterators.back();
+    IL_LOOP_END
+    pending_constructs.pop_back();
+}
+
+void ILGenerator::generateWhileStart()
+{
+    IL_LOOP_START
+    pending_constructs.push_back(ILPendingConstruct{0, GET_CURRENT_OFFSET, {}, "While"});
+}
+
+void ILGenerator::generateWhileCondition(const ASTPtr& condition)
+{
+    condition->accept(*this, true);
+
+    //Condition false? jump out of loop
+    IL_TRACE("JUMP_IF_FALSE LOC");
+    emit(ILInstruction::JUMP_IF_FALSE);
+    INC_CURRENT_OFFSET
+    pending_constructs.back().patch_location = il_code.size() - 1;
+}
+
+void ILGenerator::generateWhileEnd()
+{
+    const ILPendingConstruct& construct = pending_constructs.back();
+
+    //End of expression, unconditional jump back to evaluating condition
+    IL_TRACE("JUMP " << construct.start);
+    emit(ILInstruction::JUMP, construct.start);
+    INC_CURRENT_OFFSET
+
+    //End of loop, update JUMP_IF_FALSE location
+    IL_TRACE("LOC: " << GET_CURRENT_OFFSET);
+    patch(construct.patch_location, GET_CURRENT_OFFSET);
+
+    //Same here
+    handleBreakIfExists(GET_CURRENT_OFFSET);
+
+    IL_LOOP_END
+    pending_constructs.pop_back();
+}
+
+void ILGenerator::generateFunctionStart(ASTFunctionDecl& func_decl_node)
+{
+    //Top level if we aren't inside of any function yet
+    bool is_top_level = return_addr.empty();
+
+    NEW_OFFSET_SCOPE
+    //Mark starting of function call
+    IL_TRACE("FUNC_START");
+    emit(ILInstruction::FUNC_START, GET_IL_ADDRESS);
+
+    //Later used for function calls
+    func_decl_node.starting_addr = GET_IL_ADDRESS;
+    function_info.push_back(ILFunctionInfo{
+        func_decl_node.function_name, func_decl_node.starting_addr, func_decl_node.frame_size,
+        static_cast<std::uint16_t>(func_decl_node.function_params.size()), func_decl_node.vargs_type, is_top_level
+    });
+
+    //Frame is destroyed by FUNC_END, tail calls jump right after this instruction and reuse the frame
+    //Parser only knows the frame size once the body is parsed, so it is patched in by generateFunctionEnd
+    IL_TRACE("ALLOC_FRAME " << func_decl_node.frame_size);
+    emit(ILInstruction::ALLOC_FRAME, func_decl_node.frame_size);
+    INC_CURRENT_OFFSET
+    IL_FUNC_START
+    pending_constructs.push_back(ILPendingConstruct{il_code.size() - 1, function_info.size() - 1, {}, "Func"});
+    
+    //Params occupy first slots of the frame in order
+    for(std::uint16_t slot = 0; slot < func_decl_node.function_params.size(); ++slot) {
+        IL_TRACE("ASSIGN_VAR " << symbols.nameOf(func_decl_node.function_params[slot].second) << " SLOT: " << slot);
+        emit(ILInstruction::ASSIGN_VAR, slot, LOCAL_FRAME);
+        INC_CURRENT_OFFSET
+    }
+}
+
+void ILGenerator::generateFunctionEnd(ASTFunctionDecl& func_decl_node)
+{
+    const ILPendingConstruct& construct = pending_constructs.back();
+
+    IL_TRACE("FUNC_END");
+    emit(ILInstruction::FUNC_END, (std::uint16_t)(func_decl_node.vargs_type));
+    INC_CURRENT_OFFSET
+
+    patch(construct.patch_location, func_decl_node.frame_size);
+    function_info[construct.start].frame_size = func_decl_node.frame_size;
+    FLUX_TRACE(TRACE_ILGEN, TRACE_SUMMARY, "Function '" << symbols.nameOf(func_decl_node.function_name) << "' at " << func_decl_node.starting_addr
+                                           << ", frame size " << func_decl_node.frame_size << ", " << GET_CURRENT_OFFSET << " instructions");
+
+    handleReturnIfExists(GET_CURRENT_OFFSET - 1);
+    IL_FUNC_END
+    DELETE_OFFSET_SCOPE
+    pending_constructs.pop_back();
+}
+
 void ILGenerator::visit(ASTValue& value_node, bool)
 {
     //For constant values, push them onto the stack
@@ -50,23 +495,29 @@ void ILGenerator::visit(ASTValue& value_node, bool)
     {
         case EVAL_AUTO: //For auto type, just push some initial value, doesn't matter the value but just a value
         case EVAL_INT:
-            std::cout << "PUSH_INT64 ";
-            il_code.emplace_back(ILInstruction::PUSH_INT64, std::stoll(value_node.value));
+            IL_TRACE("PUSH_INT64 " << value_node.value);
+            emit(ILInstruction::PUSH_INT64, std::stoll(std::string{value_node.value}));
             break;
         case EVAL_FLOAT:
-            std::cout << "PUSH_FLOAT ";
-            il_code.emplace_back(ILInstruction::PUSH_FLOAT, std::stod(value_node.value));
+            IL_TRACE("PUSH_FLOAT " << value_node.value);
+            emit_float(std::stod(std::string{value_node.value}));
             break;
         default:
             printError("ASTValue type not supported: ", value_node.type);
             break;
     }
-    std::cout << value_node.value << '\n';
     INC_CURRENT_OFFSET
 }
 
 void ILGenerator::visit(ASTBinaryOp& binary_op_node, bool)
 {
+    //Cheaper instruction sequence exists for this one
+    if(binary_op_node.reduction != ASTReduction::None)
+    {
+        generateReducedBinaryOp(binary_op_node);
+        return;
+    }
+
     // For binary operations, recursively generate IL for left and right operands
     binary_op_node.left->accept(*this, true);
     binary_op_node.right->accept(*this, true);
@@ -75,69 +526,69 @@ void ILGenerator::visit(ASTBinaryOp& binary_op_node, bool)
 
     switch (binary_op_node.op_type) {
         case TOKEN_PLUS:
-            std::cout << "ADD\n";
+            IL_TRACE("ADD");
             instruction = ILInstruction::ADD;
             break;
         case TOKEN_MINUS:
-            std::cout << "SUB\n";
+            IL_TRACE("SUB");
             instruction = ILInstruction::SUB;
             break;
         case TOKEN_MULT:
-            std::cout << "MUL\n";
+            IL_TRACE("MUL");
             instruction = ILInstruction::MUL;
             break;
         case TOKEN_DIV:
-            std::cout << "DIV\n";
+            IL_TRACE("DIV");
             instruction = ILInstruction::DIV;
             break;
         case TOKEN_MODULO:
-            std::cout << "MOD\n";
+            IL_TRACE("MOD");
             instruction = ILInstruction::MOD;
             break;
         case TOKEN_POW:
-            std::cout << "POW\n";
+            IL_TRACE("POW");
             instruction = ILInstruction::POW;
             break;
         case TOKEN_EEQ:
-            std::cout << "CMP_EQ\n";
+            IL_TRACE("CMP_EQ");
             instruction = ILInstruction::CMP_EQ;
             break;
         case TOKEN_NEQ:
-            std::cout << "CMP_NEQ\n";
+            IL_TRACE("CMP_NEQ");
             instruction = ILInstruction::CMP_NEQ;
             break;
         case TOKEN_GT:
-            std::cout << "CMP_GT\n";
+            IL_TRACE("CMP_GT");
             instruction = ILInstruction::CMP_GT;
             break;
         case TOKEN_LT:
-            std::cout << "CMP_LT\n";
+            IL_TRACE("CMP_LT");
             instruction = ILInstruction::CMP_LT;
             break;
         case TOKEN_GTEQ:
-            std::cout << "CMP_GTEQ\n";
+            IL_TRACE("CMP_GTEQ");
             instruction = ILInstruction::CMP_GTEQ;
             break;
         case TOKEN_LTEQ:
-            std::cout << "CMP_LTEQ\n";
+            IL_TRACE("CMP_LTEQ");
             instruction = ILInstruction::CMP_LTEQ;
             break;
         case TOKEN_KEYWORD_IS:
-            std::cout << "CMP_IS\n";
+            IL_TRACE("CMP_IS");
             instruction = ILInstruction::CMP_IS;
             break;
         case TOKEN_AND:
-            std::cout << "AND\n";
+            IL_TRACE("AND");
             instruction = ILInstruction::AND;
             break;
         case TOKEN_OR:
-            std::cout << "OR\n";
+            IL_TRACE("OR");
             instruction = ILInstruction::OR;
             break;
         default:
             printError("Unsupported Binary Operation. Operation type: ", binary_op_node.op_type);
     }
-    il_code.emplace_back(instruction);
+    emit(instruction);
     INC_CURRENT_OFFSET
 }
 
@@ -147,15 +598,16 @@ void ILGenerator::visit(ASTUnaryOp& unary_op_node, bool)
 
     switch (unary_op_node.op_type)
     {
+        //Nothing to emit, so nothing to count either (jump offsets would be off by one after it otherwise)
         case TOKEN_PLUS:
-            break;
+            return;
         case TOKEN_MINUS:
-            std::cout << "NEG\n";
-            il_code.emplace_back(ILInstruction::NEG);
+            IL_TRACE("NEG");
+            emit(ILInstruction::NEG);
             break;
         case TOKEN_NOT:
-            std::cout << "NOT\n";
-            il_code.emplace_back(ILInstruction::NOT);
+            IL_TRACE("NOT");
+            emit(ILInstruction::NOT);
             break;
         default:
             printError("Unsupported Unary Operation. Operation type: ", unary_op_node.op_type);
@@ -175,36 +627,25 @@ void ILGenerator::visit(ASTVariableAssign& var_assign_node, bool is_sub_expr)
     switch (is_sub_expr)
     {
         case true:
-            var_assign_node.is_reassignment ? std::cout << "REASSIGN_VAR_NO_POP " << var_assign_node.identifier << '\n'
-                                            : std::cout << "ASSIGN_VAR_NO_POP " << var_assign_node.identifier << '\n';
             inst = var_assign_node.is_reassignment ? ILInstruction::REASSIGN_VAR_NO_POP : ILInstruction::ASSIGN_VAR_NO_POP;
             break;
         case false:
-            var_assign_node.is_reassignment ? std::cout << "REASSIGN_VAR " << var_assign_node.identifier << '\n'
-                                            : std::cout << "ASSIGN_VAR " << var_assign_node.identifier << '\n';
             inst = var_assign_node.is_reassignment ? ILInstruction::REASSIGN_VAR : ILInstruction::ASSIGN_VAR;
             break;
     }
-    //Normal assignment = don't care about scope index
-    //Re assignment = we care about scope index
-    if(var_assign_node.is_reassignment) {
-        std::cout << "SCOPE_INDEX: " << (int)var_assign_node.scope_index << '\n';
-        // il_code.emplace_back(ILInstruction::DATAINST_VAR_SCOPE_IDX, 0, var_assign_node.scope_index);
-        // INC_CURRENT_OFFSET
-    }
-
-    il_code.emplace_back(inst, std::move(var_assign_node.identifier), var_assign_node.scope_index);
+    IL_TRACE(ILInstructionToString(inst) << ' ' << symbols.nameOf(var_assign_node.identifier));
+    //Both assignment and re assignment write to a slot in either global or local frame
+    IL_TRACE("SLOT: " << var_assign_node.slot << " SCOPE_INDEX: " << (int)var_assign_node.scope_index);
+    emit(inst, var_assign_node.slot, var_assign_node.scope_index);
     INC_CURRENT_OFFSET
 }
 
 void ILGenerator::visit(ASTVariableAccess& var_access_node, bool)
 {
-    std::cout << "ACCESS_VAR " << var_access_node.identifier << '\n'
-              << "SCOPE_INDEX: " << (int)var_access_node.scope_index << '\n';
+    IL_TRACE("ACCESS_VAR " << symbols.nameOf(var_access_node.identifier));
+    IL_TRACE("SLOT: " << var_access_node.slot << " SCOPE_INDEX: " << (int)var_access_node.scope_index);
     
-    //Pass the scope index as well with special DATAINST instructions
-    // il_code.emplace_back(ILInstruction::DATAINST_VAR_SCOPE_IDX, 0, var_access_node.scope_index);
-    il_code.emplace_back(ILInstruction::ACCESS_VAR, std::move(var_access_node.identifier), var_access_node.scope_index);
+    emit(ILInstruction::ACCESS_VAR, var_access_node.slot, var_access_node.scope_index);
 
     INC_CURRENT_OFFSET
 }
@@ -216,12 +657,12 @@ void ILGenerator::visit(ASTCastNode& expr, bool)
     switch (expr.eval_type)
     {
         case EVAL_INT:
-            std::cout << "CAST_INT\n";
-            il_code.emplace_back(ILInstruction::CAST_INT);    
+            IL_TRACE("CAST_INT");
+            emit(ILInstruction::CAST_INT);    
             break;
         case EVAL_FLOAT:
-            std::cout << "CAST_FLOAT\n";
-            il_code.emplace_back(ILInstruction::CAST_FLOAT);
+            IL_TRACE("CAST_FLOAT");
+            emit(ILInstruction::CAST_FLOAT);
             break;
         default:
             printError("Unsupported Cast<>() Type: ", expr.eval_type);
@@ -234,194 +675,82 @@ void ILGenerator::visit(ASTBlock& statements, bool is_sub_expr)
 {
     //Its just block of statements / expressions, just let the expr do the job 
     for (auto &&expr : statements.getStatements())
-        expr->accept(*this, is_sub_expr);
+        generateBlockStatement(expr, is_sub_expr);
 }
 
 //Painful ternary op ;-;
 //Depending on condition, we either jump or just execute below expression ig
-void ILGenerator::visit(ASTTernaryOp& ternary_node, bool is_sub_expr)
+void ILGenerator::visit(ASTTernaryOp& ternary_node, bool)
 {
     //Generate condition
     ternary_node.condition->accept(*this, true);
 
     //Store the location of Jump instruction
-    il_code.emplace_back(ILInstruction::JUMP_IF_FALSE); //Later we will update the operand as well
+    emit(ILInstruction::JUMP_IF_FALSE); //Later we will update the operand as well
     INC_CURRENT_OFFSET
     std::size_t false_expr_jump_location = il_code.size() - 1;
-    std::cout << "JUMP_IF_FALSE FLOC\n";
+    IL_TRACE("JUMP_IF_FALSE FLOC");
 
     //Generate true expression
     ternary_node.true_expr->accept(*this, true);
     //After executing true expression, we need to JUMP the entire expression (false expression)
 
-    il_code.emplace_back(ILInstruction::JUMP); // we will also update the operand as well later
+    emit(ILInstruction::JUMP); // we will also update the operand as well later
     INC_CURRENT_OFFSET
     std::size_t expr_jump_location   = il_code.size() - 1;
     std::size_t offset_jump_location = GET_CURRENT_OFFSET;
-    std::cout << "JUMP ELOC\n";
+    IL_TRACE("JUMP ELOC");
 
     //Generate false expression
     ternary_node.false_expr->accept(*this, true);
 
     //now that everything is generated, we are going to be updating jump locations
     //First: Jump to False Expression
-    il_code[false_expr_jump_location].value = offset_jump_location;
+    patch(false_expr_jump_location, offset_jump_location);
     
     //Second: Jump entire expression
-    il_code[expr_jump_location].value = GET_CURRENT_OFFSET;
+    patch(expr_jump_location, GET_CURRENT_OFFSET);
 
-    std::cout << "FLOC: " << offset_jump_location << " ELOC: " << GET_CURRENT_OFFSET << '\n';
+    IL_TRACE("FLOC: " << offset_jump_location << " ELOC: " << GET_CURRENT_OFFSET);
 }
 
 void ILGenerator::visit(ASTIfNode& if_node, bool is_sub_expr)
 {
-    //Some important variable
-    ListOfSizeT elif_jump_locations;
-    
-    //Entire If scope starts from here
-    SCOPE_START
-
-    //Generate if condition
-    if_node.if_condition->accept(*this, true);
-
     //Four cases:
     //1) If 2) If Else 3) If Elif* 4) If Elif* Else
-    std::cout << "JUMP_IF_FALSE (If)\n";
-    il_code.emplace_back(ILInstruction::JUMP_IF_FALSE);
-    INC_CURRENT_OFFSET
-    std::size_t jump_if_condition = il_code.size() - 1;
-
-    //Generate if body
+    generateIfStart(if_node.if_condition);
     if_node.if_body->accept(*this, is_sub_expr);
+    generateIfBodyEnd();
 
-    //Now unconditional jump to end of expression from here
-    il_code.emplace_back(ILInstruction::JUMP);
-    INC_CURRENT_OFFSET
-    std::size_t jump_to_end_of_expr = il_code.size() - 1;
-    
-    std::cout << "JUMP (If)\n";
-
-    //False condition jump
-    il_code[jump_if_condition].value = GET_CURRENT_OFFSET;
-
-    //Look for all Elif conditions
+    //Look for all Elif conditions, rest is pretty much same as If
     for (auto &&[elif_condition, elif_body] : if_node.elif_clauses)
     {
-        //Condition for Elif;
-        elif_condition->accept(*this, true);
-
-        //Check for condition (rest will be pretty much same as if)
-        il_code.emplace_back(ILInstruction::JUMP_IF_FALSE);
-        INC_CURRENT_OFFSET
-        std::size_t jump_elif_condition = il_code.size() - 1;
-
-        std::cout << "JUMP_IF_FALSE (Elif)\n";
-
-        //Generate body
+        generateElifStart(elif_condition);
         elif_body->accept(*this, is_sub_expr);
-
-        //Unconditional jump to end of Expression, except here we have multiple Elifs so
-        //Store values in vector
-        il_code.emplace_back(ILInstruction::JUMP);
-        INC_CURRENT_OFFSET
-        elif_jump_locations.push_back(il_code.size() - 1);
-
-        std::cout << "JUMP (Elif)\n";
-
-        //Update the false condition jump to next Elif / Else
-        il_code[jump_elif_condition].value = GET_CURRENT_OFFSET;
+        generateIfBodyEnd();
     }
     
     //If 'Else' exists, generate its body
     if(if_node.else_body != nullptr)
         if_node.else_body->accept(*this, is_sub_expr);
     
-    //Whatever is at end is well the final location of end of "if condition"
-    il_code[jump_to_end_of_expr].value = GET_CURRENT_OFFSET;
-
-    //Also update all the Elifs final location like If
-    for (auto &&idx : elif_jump_locations)
-        il_code[idx].value = GET_CURRENT_OFFSET;
-    
-    SCOPE_END
+    generateIfEnd();
 }
 
 void ILGenerator::visit(ASTForNode& for_node, bool is_sub_expr)
 {
-    SCOPE_START
-
-    //Generate iterator instructions
-    for_node.range->accept(*this, is_sub_expr);
-
-    //We will evaluate range for next, interpreter will do the job of comparing and jumping
-    //We just provide the location to jump
-    //If the condition is false, it jumps else it doesnt
-    IL_LOOP_START
-
-    std::cout << "ITER_HAS_NEXT LOC" << '\n';
-    il_code.emplace_back(ILInstruction::ITER_HAS_NEXT);
-    INC_CURRENT_OFFSET
-    
-    std::size_t iter_has_next_location = il_code.size() - 1;
-    std::size_t iter_has_next_offset   = GET_CURRENT_OFFSET - 1;
-
-    //Assign the start value to the identifier using some weird instructions
-    std::cout << "ITER_CURRENT\n";
-    il_code.emplace_back(ILInstruction::ITER_CURRENT);
-    INC_CURRENT_OFFSET
-
-    //Generate for body
+    generateForStart(for_node);
     for_node.for_body->accept(*this, is_sub_expr);
-    
-    //Go past the current value and loop again
-    std::cout << "ITER_NEXT " << iter_has_next_offset << '\n';
-    il_code.emplace_back(ILInstruction::ITER_NEXT, iter_has_next_offset);
-    INC_CURRENT_OFFSET
-
-    //After this location is where its going to jump if condition is false
-    il_code[iter_has_next_location].value = GET_CURRENT_OFFSET;
-    std::cout << "IHN LOC: " << GET_CURRENT_OFFSET << '\n';
-
-    //Check if break exists in our code and handle it accordingly
-    handleBreakIfExists(GET_CURRENT_OFFSET);
-
-    IL_LOOP_END
-    SCOPE_END
+    generateForEnd();
 }
 
 void ILGenerator::visit(ASTWhileNode& while_node, bool is_sub_expr)
 {
     //This is probably the easiest
-    SCOPE_START
-    IL_LOOP_START
-
-    std::size_t while_condition_location = GET_CURRENT_OFFSET;
-    //Generate condition
-    while_node.while_condition->accept(*this, true);
-    //Condition false? jump out of loop
-    std::cout << "JUMP_IF_FALSE LOC\n";
-    il_code.emplace_back(ILInstruction::JUMP_IF_FALSE);
-    INC_CURRENT_OFFSET
-
-    std::size_t jump_if_false_location = il_code.size() - 1;
-    
-    //Generate body
+    generateWhileStart();
+    generateWhileCondition(while_node.while_condition);
     while_node.while_body->accept(*this, is_sub_expr);
-
-    //End of expression, unconditional jump back to evaluating condition
-    std::cout << "JUMP " << while_condition_location << '\n';
-    il_code.emplace_back(ILInstruction::JUMP, while_condition_location);
-    INC_CURRENT_OFFSET
-
-    //End of loop, update JUMP_IF_FALSE location
-    std::cout << "LOC: " << GET_CURRENT_OFFSET << '\n';
-    il_code[jump_if_false_location].value = GET_CURRENT_OFFSET;
-
-    //Same here
-    handleBreakIfExists(GET_CURRENT_OFFSET);
-
-    IL_LOOP_END
-    SCOPE_END
+    generateWhileEnd();
 }
 
 //------------ITERATORS------------
@@ -439,46 +768,46 @@ void ILGenerator::visit(ASTRangeIterator& range_iter_node, bool is_sub_expr)
     //But what i was thinking was, lets just give emplace a dummy value so its satisfied
     //After initializing Iterator, emplace the ITER_RECALC_STEP instruction
     else {
-        std::cout << "PUSH_INT64 0\n";
-        il_code.emplace_back(ILInstruction::PUSH_INT64, 0);
+        IL_TRACE("PUSH_INT64 0");
+        emit(ILInstruction::PUSH_INT64, 0);
         INC_CURRENT_OFFSET
     }
 
     //Pre init aka set up identifier
-    std::cout << "DATAINST_ITER_ID " << range_iter_node.iter_identifier << '\n';
-    il_code.emplace_back(ILInstruction::DATAINST_ITER_ID, std::move(range_iter_node.iter_identifier));
+    IL_TRACE("DATAINST_ITER_ID " << symbols.nameOf(range_iter_node.iter_identifier) << " SLOT: " << range_iter_node.iter_slot);
+    emit(ILInstruction::DATAINST_ITER_ID, range_iter_node.iter_slot, range_iter_node.iter_scope_index);
 
     //Generate an ITER_INIT instruction passing in the type of iterator and iter data type
     //'Or' them together, then we cast it to integer
     std::uint16_t data = ((std::uint8_t)IteratorType::RANGE_ITERATOR << 8)
                        | ((std::uint8_t)range_iter_node.evaluateIterType());
 
-    std::cout << "ITER_INIT " << data << '\n';
-    il_code.emplace_back(ILInstruction::ITER_INIT, data);
+    IL_TRACE("ITER_INIT " << data);
+    emit(ILInstruction::ITER_INIT, data);
     
     //Inc for both iter and datainst iter
     INCN_CURRENT_OFFSET(2)
     
     //Iterator is now initialized, recalculate step size if step is null
     if(range_iter_node.step == nullptr) {
-        std::cout << "ITER_RECALC_STEP\n";
-        il_code.emplace_back(ILInstruction::ITER_RECALC_STEP);
+        IL_TRACE("ITER_RECALC_STEP");
+        emit(ILInstruction::ITER_RECALC_STEP);
         INC_CURRENT_OFFSET
     }
 }
 
-void ILGenerator::visit(ASTEllipsisIterator& ellipsis_iter_node, bool is_sub_expr)
+void ILGenerator::visit(ASTEllipsisIterator& ellipsis_iter_node, bool)
 {
     //Pre init aka set up identifier
-    std::cout << "DATAINST_ITER_ID " << ellipsis_iter_node.iter_identifier << '\n';
-    il_code.emplace_back(ILInstruction::DATAINST_ITER_ID, std::move(ellipsis_iter_node.iter_identifier));
+    IL_TRACE("DATAINST_ITER_ID " << symbols.nameOf(ellipsis_iter_node.iter_identifier) << " SLOT: " << ellipsis_iter_node.iter_slot);
+    emit(ILInstruction::DATAINST_ITER_ID, ellipsis_iter_node.iter_slot, ellipsis_iter_node.iter_scope_index);
     
     //Init vargs iter
     std::uint16_t data = ((std::uint8_t)IteratorType::ELLIPSIS_ITERATOR << 8)
                        | ((std::uint8_t)ellipsis_iter_node.ellipsis_type);
 
-    std::cout << "ITER_INIT " << data << '\n';
-    il_code.emplace_back(ILInstruction::ITER_INIT, data);
+    IL_TRACE("ITER_INIT " << data);
+    emit(ILInstruction::ITER_INIT, data);
 
     //Inc for both iter and datainst iter
     INCN_CURRENT_OFFSET(2)
@@ -487,36 +816,12 @@ void ILGenerator::visit(ASTEllipsisIterator& ellipsis_iter_node, bool is_sub_exp
 //------------FUNCTIONS------------
 void ILGenerator::visit(ASTFunctionDecl& func_decl_node, bool is_sub_expr)
 {
-    NEW_OFFSET_SCOPE
-    //Mark starting of function call
-    std::cout << "FUNC_START\n";
-    il_code.emplace_back(ILInstruction::FUNC_START, il_code.size());
-
-    //Later used for function calls
-    func_decl_node.starting_addr = il_code.size();
-
-    //Scope end handled by FUNC_END
-    SCOPE_START
-    IL_FUNC_START
-    
-    for(auto&& param : func_decl_node.function_params) {
-        std::cout << "ASSIGN_VAR " << param.second << '\n';
-        il_code.emplace_back(ILInstruction::ASSIGN_VAR, std::move(param.second));
-        INC_CURRENT_OFFSET
-    }
-    
+    generateFunctionStart(func_decl_node);
     func_decl_node.function_body->accept(*this, is_sub_expr);
-
-    std::cout << "FUNC_END\n";
-    il_code.emplace_back(ILInstruction::FUNC_END, (std::uint16_t)(func_decl_node.vargs_type));
-    INC_CURRENT_OFFSET
-
-    handleReturnIfExists(GET_CURRENT_OFFSET - 1);
-    IL_FUNC_END
-    DELETE_OFFSET_SCOPE
+    generateFunctionEnd(func_decl_node);
 }
 
-void ILGenerator::visit(ASTBuiltinFunctionCall& builtin_node, bool is_sub_expr)
+void ILGenerator::visit(ASTBuiltinFunctionCall& builtin_node, bool)
 {
     //Since all of this is builtin, no need to create any stack frame or anything
     for (auto it = builtin_node.function_args.rbegin(); 
@@ -526,14 +831,14 @@ void ILGenerator::visit(ASTBuiltinFunctionCall& builtin_node, bool is_sub_expr)
     
     if(builtin_node.has_vargs)
     {
-        il_code.emplace_back(ILInstruction::PUSH_UINT64, builtin_node.function_args.size());
-        std::cout << "PUSH_UINT64 " << builtin_node.function_args.size() << '\n';
+        emit(ILInstruction::PUSH_UINT64, builtin_node.function_args.size());
+        IL_TRACE("PUSH_UINT64 " << builtin_node.function_args.size());
         INC_CURRENT_OFFSET
     }
 
     //Smallest possible value is 16bit uint
-    il_code.emplace_back(ILInstruction::BUILTIN_CALL, (std::uint16_t)builtin_node.call_number);
-    std::cout << "BUILTIN_CALL " << (int)builtin_node.call_number << '\n';
+    emit(ILInstruction::BUILTIN_CALL, (std::uint16_t)builtin_node.call_number);
+    IL_TRACE("BUILTIN_CALL " << (int)builtin_node.call_number);
     INC_CURRENT_OFFSET
 }
 
@@ -541,24 +846,25 @@ void ILGenerator::visit(ASTFunctionCall& func_call_node, bool is_sub_expr)
 {
     if(func_call_node.is_tail_call)
     {
-        std::cout << "TAIL_CALL_OPTIMIZED\n";
+        IL_TRACE("TAIL_CALL_OPTIMIZED");
         //Only for functions without vargs
         for (auto it = func_call_node.function_args.rbegin(); 
                   it != func_call_node.function_args.rend();
                   ++it) 
             (*it)->accept(*this, is_sub_expr);
 
-        //Jump to the start of the function
-        std::cout << "FUNC_TAIL_CALL\n";
-        il_code.emplace_back(ILInstruction::JUMP, 1ULL);
+        //Jump to the start of the function, iterators of the current call are not needed anymore
+        destroyActiveIterators();
+        IL_TRACE("FUNC_TAIL_CALL");
+        emit(ILInstruction::JUMP, 1ULL);
         INC_CURRENT_OFFSET;
 
         //Since we are reusing the stack frame, there's no need to update the return address
         return;
     }
 
-    std::cout << "PUSH_UINT64 RETADDR\n";
-    il_code.emplace_back(PUSH_UINT64);
+    IL_TRACE("PUSH_UINT64 RETADDR");
+    emit(PUSH_UINT64);
     INC_CURRENT_OFFSET
 
     std::size_t ret_addr = il_code.size() - 1;
@@ -570,71 +876,61 @@ void ILGenerator::visit(ASTFunctionCall& func_call_node, bool is_sub_expr)
         auto params_len = func_call_node.initial_func->function_params.size();
         auto args_len   = func_call_node.function_args.size();
 
-        std::cout << "FUNC_VARGS " << args_len - params_len << '\n';
-        il_code.emplace_back(ILInstruction::FUNC_VARGS, args_len - params_len);
+        IL_TRACE("FUNC_VARGS " << args_len - params_len);
+        emit(ILInstruction::FUNC_VARGS, args_len - params_len);
         INC_CURRENT_OFFSET;
     }
 
     //Really bad syntax but push stuff in reverse order cuz stack will pop in another other when assigning values to variables
+    //Arguments are always sub expressions, even if the call itself is a statement (nested calls need USE_RETURN_VAL)
     for(auto it = func_call_node.function_args.rbegin(); 
              it != func_call_node.function_args.rend();
              ++it)
-        (*it)->accept(*this, is_sub_expr);
+        (*it)->accept(*this, true);
     
-    std::cout << "FUNC_CALL " << func_call_node.initial_func->starting_addr << '\n';
-    il_code.emplace_back(ILInstruction::FUNC_CALL, func_call_node.initial_func->starting_addr);
+    IL_TRACE("FUNC_CALL " << func_call_node.initial_func->starting_addr);
+    emit(ILInstruction::FUNC_CALL, func_call_node.initial_func->starting_addr);
     INC_CURRENT_OFFSET
 
-    il_code[ret_addr].value = GET_CURRENT_OFFSET;
+    patch(ret_addr, GET_CURRENT_OFFSET);
 
     //If 'Return' does return some value, should we use it? if we are in a sub expr, then yes
     //Equivalent to pushing some value to stack
     if(is_sub_expr)
     {
-        std::cout << "USE_RETURN_VAL\n";
-        il_code.emplace_back(ILInstruction::USE_RETURN_VAL);
+        IL_TRACE("USE_RETURN_VAL");
+        emit(ILInstruction::USE_RETURN_VAL);
         INC_CURRENT_OFFSET
     }
 }
 
 //------------BREAK / CONTINUE / RETURN------------
-void ILGenerator::visit(ASTContinue& continue_node, bool is_sub_expr)
+void ILGenerator::visit(ASTContinue& continue_node, bool)
 {
-    //Few conditions we need to see
-    //1) Is it in a symbol table using thing like if conditions(loops don't count)? if yes we manually generate instruction to pop it
-    //2) Is it in a for loop? We use different instruction instead of simple JUMP instruction
-    std::cout << "CONTINUE\n";
-    
-    if(CBR_PARAMS_CHECK_CONDITION(continue_node.continue_params, IS_USING_SYMTBL)) {
-        il_code.emplace_back(ILInstruction::DESTROY_MULTIPLE_SYMBOL_TABLES, 0, continue_node.scopes_to_destroy);
-        INC_CURRENT_OFFSET
-    }
+    //Is it in a for loop? We use different instruction instead of simple JUMP instruction
+    //No scopes to clean up, blocks don't have any runtime representation anymore
+    IL_TRACE("CONTINUE");
 
     ILInstruction instruction = CBR_PARAMS_CHECK_CONDITION(continue_node.continue_params, IS_FOR_LOOP) 
                                     ? ILInstruction::ITER_NEXT 
                                     : ILInstruction::JUMP;
 
-    il_code.emplace_back(instruction, std::move(cb_info.back().first));
+    emit(instruction, std::move(cb_info.back().first));
     INC_CURRENT_OFFSET
 }
 
-void ILGenerator::visit(ASTBreak& break_node, bool is_sub_expr)
+void ILGenerator::visit(ASTBreak&, bool)
 {
     //Where ever you see 'Break', simply push it with no operand, Loops are responsible for updating this operand
-    std::cout << "BREAK\n";
-
-    if(CBR_PARAMS_CHECK_CONDITION(break_node.break_params, IS_USING_SYMTBL)) {
-        il_code.emplace_back(ILInstruction::DESTROY_MULTIPLE_SYMBOL_TABLES, 0, break_node.scopes_to_destroy);
-        INC_CURRENT_OFFSET
-    }
+    IL_TRACE("BREAK");
     
     //Second is where we store all break checkpoints u could say.
     cb_info.back().second.emplace_back(il_code.size());
-    il_code.emplace_back(ILInstruction::JUMP);
+    emit(ILInstruction::JUMP);
     INC_CURRENT_OFFSET
 }
 
-void ILGenerator::visit(ASTReturn& node, bool is_sub_expr)
+void ILGenerator::visit(ASTReturn& node, bool)
 {
     //Return address will contain two things, 64bit index pointing to FUNC_END, left most bit reserved
     //Index determined later on, right now its simply using 'int' as placeholder
@@ -642,14 +938,15 @@ void ILGenerator::visit(ASTReturn& node, bool is_sub_expr)
     if(node.return_expr)
     {
         node.return_expr->accept(*this, true);
-        std::cout << "RETURN\n";
+        IL_TRACE("RETURN");
     }
     else {
-        std::cout << "RETURN NONE\n";
+        IL_TRACE("RETURN NONE");
         canReturn = -1;
     }
+    destroyActiveIterators();
     return_addr.back().emplace_back(il_code.size());
-    il_code.emplace_back(ILInstruction::RETURN, canReturn);
+    emit(ILInstruction::RETURN, canReturn);
     INC_CURRENT_OFFSET
 }
 
@@ -4,13 +4,13 @@
 #include <string>
 #include <vector>
 #include <iostream>
-#include <variant>
 #include <cmath>
 
-#include "file.hpp"
 #include "ast.hpp"
+#include "trace.hpp"
 #include "..\Common\error_printer.hpp"
 #include "..\Common\common.hpp" //Common between Interpreter and Compiler
+#include "..\Common\opcode_table.hpp"
 #include "common.hpp" //Common for files in Compiler only
 
 #define INC_CURRENT_OFFSET     ++current_scope_offset.back();
@@ -18,32 +18,88 @@
 #define GET_CURRENT_OFFSET     current_scope_offset.back()
 #define NEW_OFFSET_SCOPE       current_scope_offset.emplace_back(0);
 #define DELETE_OFFSET_SCOPE    current_scope_offset.pop_back();
+//Address of the next instruction, counting the IL already taken out while streaming
+#define GET_IL_ADDRESS         (il_base + il_code.size())
 
-//Force generate these instructions (strictly to be used in ILGenerator member functions)
-#define SCOPE_START std::cout << "CREATE_SCOPE\n";\
-                    il_code.emplace_back(ILInstruction::CREATE_SYMBOL_TABLE);\
-                    INC_CURRENT_OFFSET
-#define SCOPE_END std::cout << "DESTROY_SCOPE\n";\
-                    il_code.emplace_back(ILInstruction::DESTROY_SYMBOL_TABLE);\
-                    INC_CURRENT_OFFSET
+//What is being generated, as its generated (--trace=ilgen). Listing format gets the finished IL instead (traceGenerated)
+#define IL_TRACE(message) do { if(traceBuiltIn && !Tracer::isListing()) FLUX_TRACE(TRACE_ILGEN, TRACE_DETAIL, message); } while(0)
 
 #define IL_LOOP_START cb_info.emplace_back(GET_CURRENT_OFFSET, std::vector<size_t>{});
 #define IL_LOOP_END   cb_info.pop_back();
 
-#define IL_FUNC_START return_addr.emplace_back(ListOfSizeT{});
-#define IL_FUNC_END   return_addr.pop_back();
+#define IL_FUNC_START return_addr.emplace_back(ListOfSizeT{});\
+                      active_iterators.emplace_back(0);
+#define IL_FUNC_END   return_addr.pop_back();\
+                      active_iterators.pop_back();
 
 //Useful stuff
 using ListOfSizeT       = std::vector<std::size_t>;
 using ContinueBreakInfo = std::vector<std::pair<std::size_t, ListOfSizeT>>;
 
+//Everything FileWriter needs to know about a function besides its code (function descriptors, exports)
+struct ILFunctionInfo
+{
+    SymbolId      name;
+    std::size_t   starting_addr; //IL address right after FUNC_START, same as FUNC_CALL operand
+    std::uint16_t frame_size;
+    std::uint16_t param_count;
+    EvalType      vargs_type;
+    bool          is_top_level;  //Only these are exported
+};
+
+//If / loop / function being generated right now, whatever has to be patched once its body is done
+struct ILPendingConstruct
+{
+    std::size_t patch_location; //JUMP_IF_FALSE / ITER_HAS_NEXT / ALLOC_FRAME (functions), index in il_code
+    std::size_t start;          //Offset loops jump back to, index in function_info for functions
+    ListOfSizeT end_jumps;      //If and Elif bodies jumping past the whole If
+    const char* clause;         //For the IL traced along the way
+};
+
+//Statement starting at IL address 'il_index' came from 'line'
+struct ILLineInfo
+{
+    std::size_t   il_index;
+    std::uint32_t line;
+};
+
 class ILGenerator : public ASTVisitorInterface {
     public:
-        ILGenerator(ListOfASTPtr&& ast)
-            : ast_statements(std::move(ast))
+        //'symbols' only gives names back to ids for the IL traced along the way (--trace=ilgen)
+        ILGenerator(ListOfASTPtr ast, std::uint16_t global_frame_size, const SymbolInterner& symbols)
+            : ast_statements(ast), global_frame_size(global_frame_size), symbols(symbols)
         {}
 
-        ListOfInstruction& generateIL();
+        //Whole tree given to the constructor at once
+        ListOfVMInstruction& generateIL();
+
+        //Streaming, one top level statement at a time (tree given to the constructor isn't used). Whatever was generated
+        //can be taken out and cleared after any statement, addresses keep counting from where the cleared IL ended
+        void generateProgramStart();
+        void generateStatement(const ASTPtr&);
+        void generateProgramEnd();
+        void clearGenerated();
+
+        //Direct emission (-O0), parser calls these as it recognizes each construct instead of building nodes for
+        //statements. Expressions still come as (small) trees. Every Start has to be followed by its End
+        void generateBlockStatement(const ASTPtr&, bool is_sub_expr = false);
+        void recordLine(std::uint32_t);
+        void generateIfStart(const ASTPtr& condition);
+        void generateElifStart(const ASTPtr& condition);
+        void generateIfBodyEnd();
+        void generateIfEnd();
+        void generateForStart(ASTForNode&);
+        void generateForEnd();
+        void generateWhileStart();
+        void generateWhileCondition(const ASTPtr& condition);
+        void generateWhileEnd();
+        void generateFunctionStart(ASTFunctionDecl&);
+        void generateFunctionEnd(ASTFunctionDecl&);
+
+        //Valid after generateIL() (or any of the streaming calls, till clearGenerated())
+        ListOfVMInstruction&               getIL()                 { return il_code; }
+        const std::vector<ILFunctionInfo>& getFunctionInfo() const { return function_info; }
+        const std::vector<ILLineInfo>&     getLineInfo()     const { return line_info; }
 
     private:
         void visit(ASTValue&, bool);
@@ -69,8 +125,22 @@ class ILGenerator : public ASTVisitorInterface {
 
     //Helper function
     private:
+        std::size_t emit(ILInstruction, std::uint64_t operand = 0, std::uint16_t scope_index = 0);
+        void        emit_float(double);
+        void        patch(std::size_t, std::uint64_t operand);
         void handleBreakIfExists(std::size_t);
         void handleReturnIfExists(std::size_t);
+        void destroyActiveIterators();
+        void discardValueIfExists(const ASTPtr&);
+        void recordLine(const ASTPtr&);
+        void traceGenerated();
+
+    //Strength reduction (tagged by StrengthReducer)
+    private:
+        void generateReducedBinaryOp(ASTBinaryOp&);
+        void generateMulChain(std::int64_t);
+        void generateInductionVarsInit(ASTForNode&);
+        void generateInductionVarsStep(ASTForNode&);
 
     private:
     //Temporary solution for Continue / Break
@@ -79,10 +149,23 @@ class ILGenerator : public ASTVisitorInterface {
 
     //Return addrs (function nesting exists so yeah)
         std::vector<ListOfSizeT> return_addr;
+    //Number of For loops we are inside of (per function), Return has to destroy their iterators before leaving
+        ListOfSizeT              active_iterators = {0};
+    //Constructs whose bodies are being generated, innermost on top
+        std::vector<ILPendingConstruct> pending_constructs;
         
         ListOfSizeT       current_scope_offset = {0};
         ListOfASTPtr      ast_statements;
-        ListOfInstruction il_code;
+        std::uint16_t     global_frame_size;
+        //Already encoded the way they go into the file, FUNC_START and FUNC_CALL (IL addresses) aside
+        ListOfVMInstruction il_code;
+        std::size_t         il_base = 0; //IL cleared so far, il_code[0] is at this address
+
+        const SymbolInterner& symbols;
+
+    //Metadata for FileWriter
+        std::vector<ILFunctionInfo> function_info;
+        std::vector<ILLineInfo>     line_info;
 };
 
 #endif
\ No newline at end of file
@@ -1,144 +1,412 @@
-
 /*
- WELCOME TO THE SLOWEST LEXER WHICH I EVER BUILT, THIS IS SO BAD I WANNA DIE,
- WILL OPTIMIZE LATER CUZ THIS GIVES ME CANCER.
+ Lexer works straight on the source text: tokens are views into it, nothing is allocated per token.
+ Character classes come from a lookup table, keywords from a length / first character switch and
+ long runs (whitespace, identifiers, comment bodies) are skipped 16 bytes at a time with SSE2 where available.
+ Line and column are never tracked while lexing, they are counted from the offset when something needs them.
+ Preprocessing happens right here as well: directives are handled when lexed, included files and macro bodies
+ are pushed on the input stack and lexed in place.
 */
 #include <iostream>
+#include <cstring>
+#include <chrono>
 #include "lexer.hpp"
 
-//Global stuff ig
-std::size_t Lexer::line = 1;
-std::size_t Lexer::col = 1;
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define LEXER_USE_SSE2
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #endif
+#endif
 
-void Lexer::advance()
+//Lexer errors are reported through this one
+//Every token lexed (--trace=lex:2), lexed ones not taken yet (peeked / in the ring) show up before the parser gets them
+#define TRACE_TOKEN FLUX_TRACE(TRACE_LEX, TRACE_DETAIL, "Token " << static_cast<int>(token.token_type) << " '" << token.token_value << '\'')
+
+thread_local Lexer* Lexer::active_lexer    = nullptr;
+thread_local bool   Lexer::on_lexer_thread = false;
+
+//-----------------HELPER FUNCTIONS-----------------
+#ifdef LEXER_USE_SSE2
+static inline unsigned int count_trailing_zeros(unsigned int mask)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+//Bytes in 'v' which are in range [lo, hi], only for ASCII ranges (bytes >= 0x80 are negative and never match)
+static inline __m128i in_range(__m128i v, char lo, char hi)
+{
+    return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8(hi + 1)));
+}
+#endif
+
+//Length of run of whitespace starting at 'p'
+static std::size_t scan_spaces(const char* p)
+{
+    std::size_t i = 0;
+#ifdef LEXER_USE_SSE2
+    while(true)
+    {
+        __m128i v    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                       _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\t')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))));
+
+        unsigned int misses = ~static_cast<unsigned int>(_mm_movemask_epi8(hits)) & 0xFFFF;
+        if(misses)
+            return i + count_trailing_zeros(misses);
+        i += 16;
+    }
+#else
+    while(CHAR_IS(p[i], CHAR_CLASS_SPACE))
+        ++i;
+    return i;
+#endif
+}
+
+//Length of run of identifier characters starting at 'p'
+static std::size_t scan_identifier(const char* p)
+{
+    std::size_t i = 0;
+#ifdef LEXER_USE_SSE2
+    while(true)
+    {
+        __m128i v     = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20)); //'A'..'Z' -> 'a'..'z', nothing else lands in that range
+        __m128i hits  = _mm_or_si128(_mm_or_si128(in_range(lower, 'a', 'z'), in_range(v, '0', '9')),
+                                     _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+
+        unsigned int misses = ~static_cast<unsigned int>(_mm_movemask_epi8(hits)) & 0xFFFF;
+        if(misses)
+            return i + count_trailing_zeros(misses);
+        i += 16;
+    }
+#else
+    while(IS_IDENT(p[i]))
+        ++i;
+    return i;
+#endif
+}
+
+//Offset of the first 'c' or '\0' starting at 'p'
+static std::size_t scan_until(const char* p, char c)
+{
+    std::size_t i = 0;
+#ifdef LEXER_USE_SSE2
+    while(true)
+    {
+        __m128i v    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(c)), _mm_cmpeq_epi8(v, _mm_setzero_si128()));
+
+        unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(hits));
+        if(mask)
+            return i + count_trailing_zeros(mask);
+        i += 16;
+    }
+#else
+    while(p[i] != c && p[i] != '\0')
+        ++i;
+    return i;
+#endif
+}
+
+//Keywords are few, length and first character leave at most one candidate to compare against
+static TokenType keyword_or_identifier(std::string_view word)
+{
+    auto match = [&](const char* keyword, TokenType type) {
+        return word == keyword ? type : TOKEN_ID;
+    };
+
+    switch (word.size())
+    {
+        case 2:
+            switch (word[0])
+            {
+                case 'I': return match("If", TOKEN_KEYWORD_IF);
+                case 'i': return word[1] == 'n' ? match("in", TOKEN_KEYWORD_IN) : match("is", TOKEN_KEYWORD_IS);
+            }
+            break;
+        case 3:
+            switch (word[0])
+            {
+                case 'I': return match("Int", TOKEN_KEYWORD_INT);
+                case 'F': return match("For", TOKEN_KEYWORD_FOR);
+            }
+            break;
+        case 4:
+            switch (word[0])
+            {
+                case 'A': return match("Auto", TOKEN_KEYWORD_AUTO);
+                case 'V': return match("Void", TOKEN_KEYWORD_VOID);
+                case 'C': return match("Cast", TOKEN_KEYWORD_CAST);
+                case 'F': return match("Func", TOKEN_KEYWORD_FUNC);
+                case 'E': return word[2] == 'i' ? match("Elif", TOKEN_KEYWORD_ELIF) : match("Else", TOKEN_KEYWORD_ELSE);
+            }
+            break;
+        case 5:
+            switch (word[0])
+            {
+                case 'F': return match("Float", TOKEN_KEYWORD_FLOAT);
+                case 'W': return match("While", TOKEN_KEYWORD_WHILE);
+                case 'B': return match("Break", TOKEN_KEYWORD_BREAK);
+            }
+            break;
+        case 6:
+            return match("Return", TOKEN_KEYWORD_RETURN);
+        case 8:
+            return match("Continue", TOKEN_KEYWORD_CONTINUE);
+    }
+    return TOKEN_ID;
+}
+
+//-----------------
+Lexer::Lexer(std::string&& source, bool pipelined)
+    : main_text(std::move(source)), preprocessor(symbols)
+{
+    main_text.append(LEXER_TEXT_PADDING, '\0');
+    push_input(main_text.data(), main_text.size() - LEXER_TEXT_PADDING, false);
+
+    active_lexer = this;
+
+    //Last thing, the thread starts lexing right away
+    if(pipelined) {
+        ring         = std::make_unique<TokenRing>();
+        lexer_thread = std::thread(&Lexer::run_lexer_thread, this);
+    }
+}
+
+Lexer::~Lexer()
 {
-    if(cur_chr == '\n') {
-        ++line; col = 0;
+    //Lexer thread is still running only if parsing stopped before EOF
+    if(lexer_thread.joinable()) {
+        halt_requested.store(true);
+        lexer_thread.join();
     }
-    else
-        ++col;
+    if(active_lexer == this)
+        active_lexer = nullptr;
+}
+
+void Lexer::push_input(const char* input_text, std::size_t length, bool is_macro)
+{
+    if(!inputs.empty())
+        inputs.back().pos = cur_pos;
+
+    LexerInput input;
+    input.text     = input_text;
+    input.length   = length;
+    input.is_macro = is_macro;
+    inputs.push_back(input);
+
+    text        = input_text;
+    text_length = length;
+    cur_pos     = 0;
+    cur_chr     = text[0];
+}
+
+//False if the source itself ended
+bool Lexer::pop_input()
+{
+    if(inputs.size() == 1)
+        return false;
+
+    inputs.pop_back();
+    text        = inputs.back().text;
+    text_length = inputs.back().length;
+    cur_pos     = inputs.back().pos;
+    cur_chr     = text[cur_pos];
+    return true;
+}
+
+//Directives are only recognized as the very first thing on a line, same as they always were
+bool Lexer::at_line_start() const
+{
+    return !inputs.back().is_macro && (token_start == 0 || text[token_start - 1] == '\n');
+}
+
+void Lexer::advance()
+{
     cur_chr = text[++cur_pos];
 }
 
+void Lexer::advance_by(std::size_t count)
+{
+    cur_pos += count;
+    cur_chr  = text[cur_pos];
+}
+
 char Lexer::peek(std::uint8_t offset)
 {
-    return (offset + cur_pos < text_length) ? text[offset + cur_pos] : text[text_length - 1];
+    //Padding is there for exactly this, anything past the end reads as '\0'
+    return cur_pos + offset < text_length ? text[cur_pos + offset] : '\0';
 }
 
 void Lexer::skip_spaces()
 {
-    while (SANITY_CHECK(cur_chr == ' ' || cur_chr == '\t' || cur_chr == '\n'))
-        advance();
+    advance_by(scan_spaces(&text[cur_pos]));
 }
 
 void Lexer::skip_single_line_comments()
 {
-    while (SANITY_CHECK(cur_chr != '\n'))
-        advance();
+    advance_by(scan_until(&text[cur_pos], '\n'));
     //skip the newline as well
-    advance();
+    if(cur_chr != '\0')
+        advance();
 }
 /**/
 void Lexer::skip_multi_line_comments()
 {
-    while (SANITY_CHECK(!(cur_chr == '*' && peek(1) == '/')))
+    while (true)
+    {
+        advance_by(scan_until(&text[cur_pos], '*'));
+        if(cur_chr == '\0' || peek(1) == '/')
+            break;
         advance();
+    }
 
     //skip '*' and '/'
-    advance();
-    advance();
+    if(cur_chr != '\0')
+        advance_by(2);
 }
 
 void Lexer::lex_digits()
 {
-    char* start_pos = &text[cur_pos];
-    
     //Look only for digits -> 0..9
     while (SANITY_CHECK(IS_DIGIT(cur_chr)))
         advance();
-    
+
     //When while loop breaks, it either hit '.' or some random character
     //If its not '.', its an integer return it
     if(cur_chr != '.')
     {
-        set_token(std::string(start_pos, &text[cur_pos]), TOKEN_INT);
+        set_token(TOKEN_INT);
         return;
     }
     //But if it is a '.', make sure before lexing float, character after '.' is also not a dot
     if(peek(1) != '.')
-    {    
+    {
         //Otherwise, we are expecting a floating type -> 123.123, lex more digits
-        advance(); //Move past '.' as we are constructing string by pointers
+        advance();
 
         while(SANITY_CHECK(IS_DIGIT(cur_chr)))
             advance();
-        
+
         //Set token as float
-        set_token(std::string(start_pos, &text[cur_pos]), TOKEN_FLOAT);
+        set_token(TOKEN_FLOAT);
         return;
     }
     //Else its '..' or some other character, return the current token as integer again
-    set_token(std::string(start_pos, &text[cur_pos]), TOKEN_INT);
+    set_token(TOKEN_INT);
 }
 
-void Lexer::lex_identifier_or_keyword()
+//False if there was no token (directive or macro), lexing just goes on
+bool Lexer::lex_identifier_or_keyword()
 {
-    char* start_pos = &text[cur_pos];
+    advance_by(scan_identifier(&text[cur_pos]));
 
-    while(SANITY_CHECK(IS_IDENT(cur_chr)))
-        advance();
-    
-    //Construct string from starting to current character
-    std::string temp(start_pos, &text[cur_pos]);
+    std::string_view word{text + token_start, cur_pos - token_start};
+    //Keywords get interned as well, macro lookup comes before them
+    SymbolId         symbol = symbols.intern(word);
+
+    if(!inputs.back().is_macro)
+    {
+        if((symbol == SYMBOL_INCLUDE || symbol == SYMBOL_DEFINE) && at_line_start()) {
+            lex_directive(symbol);
+            return false;
+        }
+
+        //Macro body is lexed in place of the identifier, its never expanded again (no recursive macros)
+        if(const std::string* body = preprocessor.findMacro(symbol)) {
+            push_input(body->data(), body->size() - LEXER_TEXT_PADDING, true);
+            return false;
+        }
+    }
+
+    //Keyword or not is only decided once per distinct name
+    while(symbol_types.size() <= symbol)
+        symbol_types.push_back(keyword_or_identifier(symbols.nameOf(static_cast<SymbolId>(symbol_types.size()))));
+
+    token.token_type   = symbol_types[symbol];
+    token.token_value  = word;
+    token.token_symbol = symbol;
+    return true;
+}
+
+void Lexer::lex_directive(SymbolId directive)
+{
+    //Rest of the line, without the newline
+    std::size_t      line_length = scan_until(&text[cur_pos], '\n');
+    std::string_view rest{text + cur_pos, line_length};
+    if(!rest.empty() && rest.back() == '\r')
+        rest.remove_suffix(1);
+    advance_by(line_length);
+
+    if(directive == SYMBOL_INCLUDE)
+    {
+        if(const std::string* included = preprocessor.include(rest))
+            push_input(included->data(), included->size() - LEXER_TEXT_PADDING, false);
+        return;
+    }
 
-    //Using the identifier map, if the string exists in the map, its a keyword, else its just identifier
-    auto elem = identifier_map.find(temp);
-    set_token(temp, (elem != identifier_map.end()) ? elem->second : TOKEN_ID);
+    //define KEY VALUE
+    std::size_t key_start = rest.find_first_not_of(' ');
+    std::size_t key_end   = key_start == std::string_view::npos ? key_start : rest.find(' ', key_start);
+    if(key_end == std::string_view::npos)
+        printError("PreprocessorError", "Expected key identifier after 'define'");
+
+    FLUX_TRACE(TRACE_LEX, TRACE_DETAIL, "define " << rest.substr(key_start, key_end - key_start));
+    preprocessor.addDefine(symbols.intern(rest.substr(key_start, key_end - key_start)), rest.substr(key_end + 1));
 }
 
-void Lexer::lex_this_or_eq_variation(const char* text, const char* text_with_eq, TokenType type, TokenType type_with_eq)
+void Lexer::lex_this_or_eq_variation(TokenType type, TokenType type_with_eq)
 {
     advance();
     if(cur_chr == '=')
     {
         advance();
-        set_token(text_with_eq, type_with_eq);
+        set_token(type_with_eq);
         return;
     }
-    set_token(text, type);
+    set_token(type);
     return;
 }
 
-void Lexer::lex() 
+void Lexer::lex()
 {
     while(true)
     {
         skip_spaces();
+        token_start = cur_pos;
 
         if(IS_DIGIT(cur_chr))
         {
             lex_digits();
             return;
         }
-        if(IS_CHAR(cur_chr) || cur_chr == '_')
+        if(CHAR_IS(cur_chr, CHAR_CLASS_IDENT_START))
         {
-            lex_identifier_or_keyword();
-            return;
+            if(lex_identifier_or_keyword())
+                return;
+            continue;
         }
 
         switch (cur_chr)
         {
             case '+':
-                set_token("+", TOKEN_PLUS);
                 advance();
+                set_token(TOKEN_PLUS);
                 return;
             case '-':
-                set_token("-", TOKEN_MINUS);
                 advance();
+                set_token(TOKEN_MINUS);
                 return;
             case '*':
-                set_token("*", TOKEN_MULT);
                 advance();
+                set_token(TOKEN_MULT);
                 return;
             //Check for comments as well
             case '/':
@@ -155,37 +423,37 @@ void Lexer::lex()
                     skip_multi_line_comments();
                     break;
                 }
-                set_token("/", TOKEN_DIV);
+                set_token(TOKEN_DIV);
                 return;
             case '%':
-                set_token("%", TOKEN_MODULO);
                 advance();
+                set_token(TOKEN_MODULO);
                 return;
             case '(':
-                set_token("(", TOKEN_LPAREN);
                 advance();
+                set_token(TOKEN_LPAREN);
                 return;
             case ')':
-                set_token(")", TOKEN_RPAREN);
                 advance();
+                set_token(TOKEN_RPAREN);
                 return;
             case '{':
-                set_token("{", TOKEN_LBRACE);
                 advance();
+                set_token(TOKEN_LBRACE);
                 return;
             case '}':
-                set_token(")", TOKEN_RBRACE);
                 advance();
+                set_token(TOKEN_RBRACE);
                 return;
             case '^':
-                set_token("^", TOKEN_POW);
                 advance();
+                set_token(TOKEN_POW);
                 return;
             case '&':
                 advance();
                 if(cur_chr == '&') {
                     advance();
-                    set_token("&&", TOKEN_AND);
+                    set_token(TOKEN_AND);
                     return;
                 }
                 printError("LexerError", "'&' bitwise operator currently not supported");
@@ -194,7 +462,7 @@ void Lexer::lex()
                 advance();
                 if(cur_chr == '|') {
                     advance();
-                    set_token("||", TOKEN_OR);
+                    set_token(TOKEN_OR);
                     return;
                 }
                 printError("LexerError", "'|' bitwise operator currently not supported");
@@ -202,33 +470,33 @@ void Lexer::lex()
             //Functions self explanatory
             case '<':
                 //Check either '<' or '<='
-                lex_this_or_eq_variation("<", "<=", TOKEN_LT, TOKEN_LTEQ);
+                lex_this_or_eq_variation(TOKEN_LT, TOKEN_LTEQ);
                 return;
             case '>':
                 //Check either '>' or '>='
-                lex_this_or_eq_variation(">", ">=", TOKEN_GT, TOKEN_GTEQ);
+                lex_this_or_eq_variation(TOKEN_GT, TOKEN_GTEQ);
                 return;
             case '!':
                 //Either '!' not operator, or '!=' operator
-                lex_this_or_eq_variation("!", "!=", TOKEN_NOT, TOKEN_NEQ);
+                lex_this_or_eq_variation(TOKEN_NOT, TOKEN_NEQ);
                 return;
             case '=':
                 //Check if its '==' or simple '='
-                lex_this_or_eq_variation("=", "==", TOKEN_EQ, TOKEN_EEQ);
+                lex_this_or_eq_variation(TOKEN_EQ, TOKEN_EEQ);
                 return;
             //Ternary
             case '?':
-                set_token("?", TOKEN_QUESTION);
                 advance();
+                set_token(TOKEN_QUESTION);
                 return;
             case ':':
-                set_token(":", TOKEN_COLON);
                 advance();
+                set_token(TOKEN_COLON);
                 return;
             //,
             case ',':
-                set_token(",", TOKEN_COMMA);
                 advance();
+                set_token(TOKEN_COMMA);
                 return;
             //.. and ...
             case '.':
@@ -237,24 +505,29 @@ void Lexer::lex()
                     advance();
                     if(cur_chr == '.')
                     {
-                        set_token("...", TOKEN_ELLIPSIS);
                         advance();
+                        set_token(TOKEN_ELLIPSIS);
                         return;
                     }
-                    set_token("..", TOKEN_RANGE);
+                    set_token(TOKEN_RANGE);
                     return;
                 }
                 //Else its an error for now
                 printError("LexerError", "Expected '.' after previous character (Either '..' or '...')");
+                return;
             //End of statements
             case ';':
-                set_token(";", TOKEN_SEMIC);
                 advance();
+                set_token(TOKEN_SEMIC);
                 return;
+            //End of included file or macro body goes on with whatever included it
             case '\0':
-                set_token("EOF", TOKEN_EOF);
+                if(pop_input())
+                    break;
+                token.token_type  = TOKEN_EOF;
+                token.token_value = "EOF";
                 return;
-            
+
             default:
                 printError("LexerError", "Character not supported, Character: ", cur_chr);
         }
@@ -263,42 +536,154 @@ void Lexer::lex()
 //------------------------------------------
 Token& Lexer::get_token()
 {
+    if(ring)
+        return take_token();
+
+    if(has_peeked) {
+        token      = peeked_token;
+        has_peeked = false;
+        return token;
+    }
+
     lex();
+    TRACE_TOKEN;
     return token;
 }
 
 Token& Lexer::get_current_token()
 {
-    return token;
+    return ring ? consumed_token : token;
 }
 
 Token Lexer::peek_next_token()
 {
-    //Save lexer state
-    Token saved_token = token;
-    std::uint64_t saved_pos = cur_pos;
-    char saved_char = cur_chr;
-    
-    //Lex
-    lex();
-    Token next = token;
-    
-    //Rewind lexer state
-    token = saved_token;
-    cur_pos = saved_pos;
-    cur_chr = saved_char;
-    
-    //Return
-    return next;
+    //Next token is whatever is at the front of the ring, nothing comes after EOF
+    if(ring) {
+        if(!lexer_thread.joinable())
+            return consumed_token;
+        const RingToken& next = ring->front();
+        consumed_line_col = {next.line, next.col};
+        return next.token;
+    }
+
+    if(!has_peeked)
+    {
+        //Tokens are just views, this is cheap
+        Token current = token;
+        lex();
+        TRACE_TOKEN;
+        peeked_token = token;
+        token        = current;
+        has_peeked   = true;
+    }
+    return peeked_token;
 }
 
-void Lexer::set_token(const std::string& token_text, TokenType token_type)
+//Token is everything from 'token_start' till the current position
+void Lexer::set_token(TokenType token_type)
 {
     token.token_type  = token_type;
-    token.token_value = std::move(token_text);
+    token.token_value = std::string_view{text + token_start, cur_pos - token_start};
+}
+
+std::pair<std::size_t, std::size_t> Lexer::compute_line_col()
+{
+    //Position inside of a macro body means nothing to anyone, use where the macro was in the file
+    std::size_t index = inputs.size() - 1;
+    while(index > 0 && inputs[index].is_macro)
+        --index;
+
+    LexerInput& input = inputs[index];
+    std::size_t pos   = index == inputs.size() - 1 ? cur_pos : input.pos;
+
+    //Parser mostly asks for increasing offsets, only count what wasn't counted before
+    if(pos < input.line_cache_pos) {
+        input.line_cache_pos        = 0;
+        input.line_cache_line       = 1;
+        input.line_cache_line_start = 0;
+    }
+
+    const char* newline;
+    while((newline = static_cast<const char*>(std::memchr(input.text + input.line_cache_pos, '\n', pos - input.line_cache_pos))) != nullptr)
+    {
+        ++input.line_cache_line;
+        input.line_cache_pos = input.line_cache_line_start = newline - input.text + 1;
+    }
+    input.line_cache_pos = pos;
+
+    return {input.line_cache_line, pos - input.line_cache_line_start + 1};
 }
 
 std::pair<std::size_t, std::size_t> Lexer::getLineColCount()
 {
-    return {line, col};
-}
\ No newline at end of file
+    if(active_lexer == nullptr)
+        return {0, 0};
+    //Parser side of a pipelined lexer, lexer itself is somewhere ahead
+    if(active_lexer->ring && !on_lexer_thread)
+        return active_lexer->consumed_line_col;
+    //Lexer thread only asks to report an error or warning, parser has to get there first
+    if(on_lexer_thread)
+        active_lexer->wait_for_parser();
+    return active_lexer->compute_line_col();
+}
+
+//-----------------PIPELINED LEXING-----------------
+void Lexer::run_lexer_thread()
+{
+    active_lexer    = this;
+    on_lexer_thread = true;
+
+    //Position is the one parser would have seen right after this token was lexed, errors point at the same place
+    do {
+        lex();
+        TRACE_TOKEN;
+        auto [line, col] = compute_line_col();
+        if(!ring->push(RingToken{token, static_cast<std::uint32_t>(line), static_cast<std::uint32_t>(col)}, halt_requested))
+            break;
+    } while(token.token_type != TOKEN_EOF && !halt_requested.load(std::memory_order_acquire));
+
+    lexer_thread_done.store(true, std::memory_order_release);
+}
+
+//Lexer found an error (or warning), without pipelining parser would have gone through every token before it first.
+//Parser might still run into an error of its own on those, that one has to win so messages don't depend on timing
+void Lexer::wait_for_parser()
+{
+    while(!ring->consumerCaughtUp())
+    {
+        //Parser is reporting its own error and exits right after, lexer thread must not print anything anymore
+        if(halt_requested.load(std::memory_order_acquire)) {
+            lexer_thread_done.store(true, std::memory_order_release);
+            for(;;)
+                std::this_thread::sleep_for(std::chrono::seconds(1));
+        }
+        std::this_thread::yield();
+    }
+}
+
+Token& Lexer::take_token()
+{
+    //EOF was taken out already, lexer thread is gone
+    if(!lexer_thread.joinable())
+        return consumed_token;
+
+    const RingToken& next = ring->front();
+    consumed_token    = next.token;
+    consumed_line_col = {next.line, next.col};
+    ring->pop();
+
+    if(consumed_token.token_type == TOKEN_EOF)
+        lexer_thread.join();
+    return consumed_token;
+}
+
+std::string_view Lexer::get_symbol_name(SymbolId id)
+{
+    //Lexer thread interns as it goes, its stopped first. Only errors need names before EOF, so nothing is lost
+    if(lexer_thread.joinable()) {
+        halt_requested.store(true, std::memory_order_release);
+        while(!lexer_thread_done.load(std::memory_order_acquire))
+            std::this_thread::yield();
+    }
+    return symbols.nameOf(id);
+}
@@ -3,77 +3,144 @@
 
 #include <string>
 #include <cstdint>
-#include <unordered_map>
+#include <array>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <thread>
 #include "token.hpp"
+#include "token_ring.hpp"
+#include "trace.hpp"
+#include "preprocessor.hpp"
 
 #define SANITY_CHECK(cnd) ((cur_chr != '\0') && (cnd))
-#define IS_DIGIT(char) (char >= '0' && char <= '9')
 
-#define IS_LOWER_CASE(char) (char >= 'a' && char <= 'z')
-#define IS_UPPER_CASE(char) (char >= 'A' && char <= 'Z')
-#define IS_CHAR(char) (IS_LOWER_CASE(char) || IS_UPPER_CASE(char))
+//Character classes, one table lookup instead of a chain of comparisons
+enum CharClass : std::uint8_t
+{
+    CHAR_CLASS_SPACE       = 1 << 0,
+    CHAR_CLASS_DIGIT       = 1 << 1,
+    CHAR_CLASS_IDENT_START = 1 << 2, //a-z, A-Z, _
+    CHAR_CLASS_IDENT       = 1 << 3  //a-z, A-Z, _, 0-9
+};
+
+constexpr std::array<std::uint8_t, 256> make_char_class_table()
+{
+    std::array<std::uint8_t, 256> table{};
+
+    table[' '] = table['\t'] = table['\n'] = CHAR_CLASS_SPACE;
+    for (int c = '0'; c <= '9'; ++c)
+        table[c] = CHAR_CLASS_DIGIT | CHAR_CLASS_IDENT;
+    for (int c = 'a'; c <= 'z'; ++c)
+        table[c] = CHAR_CLASS_IDENT_START | CHAR_CLASS_IDENT;
+    for (int c = 'A'; c <= 'Z'; ++c)
+        table[c] = CHAR_CLASS_IDENT_START | CHAR_CLASS_IDENT;
+    table['_'] = CHAR_CLASS_IDENT_START | CHAR_CLASS_IDENT;
+
+    return table;
+}
 
-#define IS_IDENT(char) (char == '_' || IS_DIGIT(char) || IS_CHAR(char))
+constexpr std::array<std::uint8_t, 256> char_class_table = make_char_class_table();
+
+#define CHAR_IS(chr, cls) (char_class_table[static_cast<unsigned char>(chr)] & (cls))
+#define IS_DIGIT(chr) CHAR_IS(chr, CHAR_CLASS_DIGIT)
+#define IS_IDENT(chr) CHAR_IS(chr, CHAR_CLASS_IDENT)
+
+//Something being lexed, the source itself, an included file or a macro body
+struct LexerInput
+{
+    const char*  text;   //'\0' padded with LEXER_TEXT_PADDING bytes
+    std::size_t  length;
+    std::size_t  pos = 0;
+    bool         is_macro;
+
+    //Last offset line/col was computed for, next request usually continues from there
+    std::size_t line_cache_pos        = 0;
+    std::size_t line_cache_line       = 1;
+    std::size_t line_cache_line_start = 0;
+};
 
 class Lexer
 {
     public:
-        Lexer(const std::string& text)
-            : text(std::move(text)), text_length(text.length()), cur_pos(0), cur_chr(text[cur_pos])
-        {}
+        //'pipelined' lexes on a thread of its own, tokens are handed over through a ring as fast as its lexed.
+        //Interner is written by that thread, nobody else may touch it till EOF was taken out (see get_symbol_name)
+        Lexer(std::string&& source, bool pipelined = false);
+        ~Lexer();
 
         Token& get_token();
         Token& get_current_token();
         Token  peek_next_token();
+        //Line and column of the active lexer (in the file being lexed), counted from the offset only when somebody asks
         static std::pair<std::size_t, std::size_t> getLineColCount();
+        //Ids of every identifier lexed so far (and macro names), lives as long as the lexer
+        SymbolInterner& get_symbols() { return symbols; }
+        //For error messages only, stops the lexer thread for good when pipelined
+        std::string_view get_symbol_name(SymbolId);
 
     private:
         void advance();
+        void advance_by(std::size_t);
         char peek(std::uint8_t);
-        void set_token(const std::string&, TokenType);
+        void set_token(TokenType);
 
         void skip_spaces();
         void skip_single_line_comments();
         void skip_multi_line_comments();
         void lex_digits();
-        void lex_identifier_or_keyword();
-        void lex_this_or_eq_variation(const char*, const char*, TokenType, TokenType);
+        bool lex_identifier_or_keyword();
+        void lex_this_or_eq_variation(TokenType, TokenType);
+        void lex_directive(SymbolId);
 
         void lex();
 
+    //Input stack, top one is being lexed. cur_pos of the others is saved in their 'pos'
     private:
-        std::string   text;
+        void push_input(const char*, std::size_t, bool);
+        bool pop_input();
+        bool at_line_start() const;
+        std::pair<std::size_t, std::size_t> compute_line_col();
+
+    //Pipelined lexing
+    private:
+        void   run_lexer_thread();
+        void   wait_for_parser();
+        Token& take_token();
+
+    private:
+        std::string             main_text;
+        std::vector<LexerInput> inputs;
+        SymbolInterner          symbols;
+        Preprocessor            preprocessor;
+        //Indexed by SymbolId, keyword token type or TOKEN_ID
+        std::vector<TokenType>  symbol_types;
+
+        //Top of 'inputs'
+        const char*   text;
         std::uint64_t text_length;
     
     private:
         std::uint64_t cur_pos;
+        std::uint64_t token_start = 0;
         char          cur_chr;
         Token         token;
-    
-    private:
-        static std::size_t col;
-        static std::size_t line;
-    
-    private:
-        //For Differentiation of keyword and identifier
-        const std::unordered_map<std::string, TokenType> identifier_map = {
-            {"Auto",     TOKEN_KEYWORD_AUTO},
-            {"Void",     TOKEN_KEYWORD_VOID},
-            {"Int",      TOKEN_KEYWORD_INT},
-            {"Float",    TOKEN_KEYWORD_FLOAT},
-            {"Cast",     TOKEN_KEYWORD_CAST},
-            {"If",       TOKEN_KEYWORD_IF},
-            {"Elif",     TOKEN_KEYWORD_ELIF},
-            {"Else",     TOKEN_KEYWORD_ELSE},
-            {"For",      TOKEN_KEYWORD_FOR},
-            {"in",       TOKEN_KEYWORD_IN},
-            {"is",       TOKEN_KEYWORD_IS},
-            {"While",    TOKEN_KEYWORD_WHILE},
-            {"Func",     TOKEN_KEYWORD_FUNC},
-            {"Continue", TOKEN_KEYWORD_CONTINUE},
-            {"Break",    TOKEN_KEYWORD_BREAK},
-            {"Return",   TOKEN_KEYWORD_RETURN},
-        };
+
+        //One token lookahead, peeking lexes for real (directives have side effects, can't be rewound)
+        Token         peeked_token;
+        bool          has_peeked = false;
+
+        //Per thread, units compiled in parallel (-j) each have their own lexer
+        static thread_local Lexer* active_lexer;
+
+        //Pipelined, everything above belongs to the lexer thread. Parser's side only ever touches these
+        std::unique_ptr<TokenRing>          ring;
+        std::thread                         lexer_thread;
+        std::atomic<bool>                   halt_requested{false};
+        std::atomic<bool>                   lexer_thread_done{false};
+        //Last token taken out of the ring and where the last token parser looked at (taken or peeked) ended
+        Token                               consumed_token;
+        std::pair<std::size_t, std::size_t> consumed_line_col;
+        static thread_local bool            on_lexer_thread;
 };
 
 //SO THAT THIS DOESNT GIVE ERROR OF INCOMPLETE TYPE
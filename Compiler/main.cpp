@@ -1,68 +1,388 @@
 #include <iostream>
 #include <chrono>
-#include <sstream>
 #include <fstream>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <optional>
+#include <thread>
+#include <mutex>
 
-#include "preprocessor.hpp"
 #include "parser.hpp"
+#include "strength_reduction.hpp"
 #include "ilgen.hpp"
 #include "..\Common\error_printer.hpp"
 #include "../Common/common.hpp"
 
 #include "file.hpp"
+#include "replace_file.hpp"
+#include "compile_cache.hpp"
+#include "compile_scheduler.hpp"
+#include "compile_server.hpp"
+#include "compile_watcher.hpp"
+#include "trace.hpp"
 
-int main(int argc, char** argv)
+struct CompileOptions
+{
+    bool           compactCode = false;
+    //-o, single file only. Gen.cflx otherwise (several files go next to their sources)
+    const char*    outputPath  = nullptr;
+    const char*    cacheDir    = std::getenv("FLUX_CACHE_DIR");
+    std::uintmax_t cacheSizeMB = DEFAULT_CACHE_SIZE_MB;
+    unsigned int   jobs        = 1;
+    //One top level statement at a time from parsing to bytecode, memory stays bounded by the biggest statement
+    bool           streaming   = false;
+    //-O0, no optimizations and parser generates IL itself while it parses (streams like above)
+    bool           fastCompile = false;
+    //Lexer runs on a thread of its own ahead of the parser, only when the whole file is parsed at once
+    bool           pipeline    = false;
+    //--trace=, cached output would skip everything there is to trace
+    bool           tracing     = false;
+    //Builds again whenever a source or anything it includes changes, till killed
+    bool           watch       = false;
+};
+
+//Every stage goes through the whole tree before the next one starts
+static void compileWhole(const CompileOptions& options, std::string&& sourceCode, const std::string& outputPath)
+{
+    //Preprocessing, Lexing and Parsing Stage (all at once)
+    Parser parser{std::move(sourceCode), options.pipeline};
+    auto tree = parser.parse();
+    std::uint16_t globalFrameSize = parser.getGlobalFrameSize();
+
+    //Optimization Stage
+    StrengthReducer reducer{parser.getSymbols()};
+    reducer.reduce(tree, globalFrameSize);
+
+    //Intermediate Language Stage
+    ILGenerator ilgen{tree, globalFrameSize, parser.getSymbols()};
+    auto& generatedBytecode = ilgen.generateIL();
+
+    //Write to file, it has to be closed before it goes to the cache
+    {
+        FileWriter fw{outputPath.c_str(), options.compactCode};
+        fw.writeToFile(generatedBytecode, ilgen.getFunctionInfo(), ilgen.getLineInfo(), parser.getSymbols());
+    }
+}
+
+//Parses, optimizes, generates and writes each top level statement before going on to the next one
+static void compileStreaming(const CompileOptions& options, std::string&& sourceCode, const std::string& outputPath)
+{
+    Parser          parser{std::move(sourceCode)};
+    StrengthReducer reducer{parser.getSymbols()};
+    ILGenerator     ilgen{ListOfASTPtr{}, 0, parser.getSymbols()};
+    FileWriter      fw{outputPath.c_str(), options.compactCode};
+
+    ilgen.generateProgramStart();
+
+    bool hasCode = false;
+    while(ASTPtr statement = parser.parseNext())
+    {
+        //Reducer may add global variables, parser keeps handing out slots after them
+        ListOfASTPtr  single{&statement, 1};
+        std::uint16_t globalFrameSize = parser.getGlobalFrameSize();
+        reducer.reduce(single, globalFrameSize);
+        parser.setGlobalFrameSize(globalFrameSize);
+
+        ilgen.generateStatement(statement);
+        fw.writeChunk(ilgen.getIL(), ilgen.getFunctionInfo(), ilgen.getLineInfo(), parser.getSymbols());
+        ilgen.clearGenerated();
+        hasCode = true;
+    }
+
+    if(!hasCode)
+        printError("ILGenerator", "Failed to generate bytecode, no code provided.");
+
+    ilgen.generateProgramEnd();
+    fw.writeChunk(ilgen.getIL(), ilgen.getFunctionInfo(), ilgen.getLineInfo(), parser.getSymbols());
+    fw.finish(parser.getGlobalFrameSize());
+}
+
+//Quickest way from source to file, for scripts and interactive tools. No AST for statements, no optimizations
+static void compileFast(const CompileOptions& options, std::string&& sourceCode, const std::string& outputPath)
+{
+    Parser      parser{std::move(sourceCode)};
+    ILGenerator ilgen{ListOfASTPtr{}, 0, parser.getSymbols()};
+    FileWriter  fw{outputPath.c_str(), options.compactCode};
+
+    ilgen.generateProgramStart();
+
+    bool hasCode = false;
+    while(parser.emitNext(ilgen))
+    {
+        fw.writeChunk(ilgen.getIL(), ilgen.getFunctionInfo(), ilgen.getLineInfo(), parser.getSymbols());
+        ilgen.clearGenerated();
+        hasCode = true;
+    }
+
+    if(!hasCode)
+        printError("ILGenerator", "Failed to generate bytecode, no code provided.");
+
+    ilgen.generateProgramEnd();
+    fw.writeChunk(ilgen.getIL(), ilgen.getFunctionInfo(), ilgen.getLineInfo(), parser.getSymbols());
+    fw.finish(parser.getGlobalFrameSize());
+}
+
+//Compiles one translation unit into 'outputPath', true if the output came from the cache
+static bool compileFile(const CompileOptions& options, const std::string& sourcePath, const std::string& outputPath)
+{
+    //Read the source code from a file, straight into the string lexer will work on (with room for its padding)
+    std::ifstream in_file{sourcePath, std::ios_base::binary | std::ios_base::ate};
+    if(!in_file.is_open()) {
+        std::cout << "[CompilerError]: Failed to open file: " << sourcePath << '\n';
+        std::exit(1);
+    }
+
+    std::string sourceCode;
+    sourceCode.reserve(static_cast<std::size_t>(in_file.tellg()) + LEXER_TEXT_PADDING);
+    sourceCode.resize(static_cast<std::size_t>(in_file.tellg()));
+    in_file.seekg(0);
+    in_file.read(sourceCode.data(), sourceCode.size());
+
+    //Output depends on the source and every file it includes, if none of it changed neither did the output
+    //Compile server keeps recent results in memory under the same keys, those go first
+    std::optional<CompileCache> cache;
+    std::string                 cacheKey;
+    if(options.cacheDir != nullptr && *options.cacheDir != '\0')
+        cache.emplace(options.cacheDir, options.cacheSizeMB * 1024 * 1024);
+
+    if(cache || CompileServer::inRequest())
+    {
+        cacheKey = CompileCache::makeKey(sourceCode, Preprocessor::collectDependencies(sourceCode), options.compactCode, !options.fastCompile);
+
+        if(!options.tracing && CompileServer::lookupResult(cacheKey, outputPath.c_str()))
+            return true;
+        if(!options.tracing && cache && cache->lookup(cacheKey, outputPath.c_str())) {
+            CompileServer::storeResult(cacheKey, outputPath.c_str());
+            return true;
+        }
+    }
+
+    if(options.fastCompile)
+        compileFast(options, std::move(sourceCode), outputPath);
+    else if(options.streaming)
+        compileStreaming(options, std::move(sourceCode), outputPath);
+    else
+        compileWhole(options, std::move(sourceCode), outputPath);
+
+    if(cache)
+        cache->store(cacheKey, outputPath.c_str());
+    CompileServer::storeResult(cacheKey, outputPath.c_str());
+
+    return false;
+}
+
+//Whole compiler run, in-process or inside of a compile server request
+static int runCompiler(int argc, char** argv)
 {
     const char* const EXT = ".flux";
-    
-    std::ios::sync_with_stdio(false);
 
-    //Make sure there are exactly 2 cmd args
-    if(argc != 2) {
-        std::cout << "[USAGE]: .\\FluxCompiler [filename].flux\n";
+    //Flags first, then one or more files
+    CompileOptions           options;
+    std::vector<std::string> sourceFiles;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if(argv[i][0] != '-')
+            sourceFiles.emplace_back(argv[i]);
+        else if(std::strcmp(argv[i], "--compact") == 0)
+            options.compactCode = true;
+        else if(std::strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+            options.outputPath = argv[++i];
+        else if(std::strcmp(argv[i], "--stream") == 0)
+            options.streaming = true;
+        else if(std::strcmp(argv[i], "-O0") == 0 || std::strcmp(argv[i], "--fast-compile") == 0)
+            options.fastCompile = true;
+        else if(std::strcmp(argv[i], "--pipeline") == 0)
+            options.pipeline = true;
+        else if(std::strcmp(argv[i], "--watch") == 0)
+            options.watch = true;
+        else if(std::strncmp(argv[i], "--trace=", 8) == 0)
+        {
+            if(!Tracer::configure(argv[i] + 8)) {
+                std::cout << "[CompilerError]: Invalid trace categories: " << argv[i] + 8 << " (expected lex, parse, opt, ilgen or all, each optionally followed by ':1' or ':2')\n";
+                std::exit(1);
+            }
+            options.tracing = true;
+        }
+        else if(std::strncmp(argv[i], "--trace-file=", 13) == 0)
+        {
+            if(!Tracer::setOutput(argv[i] + 13)) {
+                std::cout << "[CompilerError]: Failed to open trace file: " << argv[i] + 13 << '\n';
+                std::exit(1);
+            }
+        }
+        else if(std::strcmp(argv[i], "--trace-format=listing") == 0)
+            Tracer::setListing(true);
+        else if(std::strcmp(argv[i], "--trace-format=text") == 0)
+            Tracer::setListing(false);
+        else if(std::strncmp(argv[i], "--cache-dir=", 12) == 0)
+            options.cacheDir = argv[i] + 12;
+        else if(std::strncmp(argv[i], "--cache-size=", 13) == 0)
+            options.cacheSizeMB = std::strtoull(argv[i] + 13, nullptr, 10);
+        //'-j N' or '-jN', just '-j' is one job per core
+        else if(std::strncmp(argv[i], "-j", 2) == 0)
+        {
+            const char* count = argv[i][2] != '\0' ? argv[i] + 2 : (i + 1 < argc && std::isdigit(argv[i + 1][0]) ? argv[++i] : nullptr);
+            options.jobs      = count != nullptr ? std::strtoul(count, nullptr, 10) : std::thread::hardware_concurrency();
+            if(options.jobs == 0)
+                options.jobs = 1;
+        }
+        else {
+            std::cout << "[CompilerError]: Unknown option: " << argv[i] << '\n';
+            std::exit(1);
+        }
+    }
+
+    if(sourceFiles.empty()) {
+        std::cout << "[USAGE]: .\\FluxCompiler [-o output.cflx] [--compact] [--stream] [-O0] [--pipeline] [--watch] [--trace=categories] [--cache-dir=dir] [--cache-size=MB] [-j N] [filename].flux...\n"
+                  << "         .\\FluxCompiler --server [--socket=path] [--cache-size=MB]\n"
+                  << "         .\\FluxCompiler --client [--socket=path] [options] [filename].flux...\n";
         std::exit(1);
     }
 
-    //Check if the file name ends with .flux extension
-    const char* filename = argv[1];
-    if (!checkFileExt(EXT, filename)) {
-        std::cout << "[CompilerError]: File must have a `" << EXT << "` extension: " << filename << '\n';
+    if(options.outputPath != nullptr && sourceFiles.size() != 1) {
+        std::cout << "[CompilerError]: -o can only be used with a single file, several go next to their sources\n";
         std::exit(1);
     }
 
-    //Read the source code from a file
-    std::ifstream in_file{filename};
-    if(!in_file.is_open()) {
-        std::cout << "[CompilerError]: Failed to open file: " << filename << '\n';
+    //Check if the file names end with .flux extension
+    for (auto &&filename : sourceFiles)
+    {
+        if (!checkFileExt(EXT, filename.c_str())) {
+            std::cout << "[CompilerError]: File must have a `" << EXT << "` extension: " << filename << '\n';
+            std::exit(1);
+        }
+    }
+
+    if(options.tracing)
+    {
+        if(!traceBuiltIn)
+            std::cout << "[Warning]: Compiler was built without traces, --trace does nothing (build with FLUX_ENABLE_TRACE defined)\n";
+        flushTracesBeforeExit = Tracer::flush;
+    }
+
+    //Unsynced std::cout can't be written from several threads at once
+    if(options.jobs == 1)
+        std::ios::sync_with_stdio(false);
+
+    //Single file goes to Gen.cflx like always (or wherever -o says), several go next to their sources (a.flux -> a.cflx)
+    bool singleFile = sourceFiles.size() == 1;
+
+    auto build = [&](const std::vector<std::string>& units) {
+        //----------------COMPILATION START----------------
+        auto       start = std::chrono::high_resolution_clock::now();
+        std::mutex outputMutex;
+
+        CompileScheduler scheduler;
+        for (auto &&filename : units)
+            scheduler.addUnit(filename);
+
+        scheduler.run(options.jobs, [&](const std::string& sourcePath) {
+            std::string outputPath = options.outputPath != nullptr ? options.outputPath
+                                   : singleFile ? "Gen.cflx" : sourcePath.substr(0, sourcePath.size() - std::strlen(EXT)) + ".cflx";
+            bool        cached;
+
+            //Whatever runs the output (hot reload) never sees it half written, or written by a failed build.
+            //FileWriter already replaces it at once, results copied out of a cache don't
+            if(options.watch) {
+                std::string temporaryPath = temporaryPathFor(outputPath);
+                cached = compileFile(options, sourcePath, temporaryPath);
+                if(!replaceFile(temporaryPath, outputPath)) {
+                    std::lock_guard<std::mutex> lock{outputMutex};
+                    std::cout << "[CompilerError]: Failed to replace " << outputPath << '\n';
+                    exitAfterError();
+                }
+            }
+            else
+                cached = compileFile(options, sourcePath, outputPath);
+
+            auto end = std::chrono::high_resolution_clock::now();
+            std::lock_guard<std::mutex> lock{outputMutex};
+
+            std::cout << "Compilation Successful" << (cached ? " (cached)" : "");
+            if(!singleFile)
+                std::cout << ": " << sourcePath << " -> " << outputPath;
+            std::cout << ". Time to compile: " << (std::chrono::duration_cast<std::chrono::microseconds>(end - start)).count() << " microsec" << '\n';
+        });
+        //----------------COMPILATION END----------------
+
+        return 0;
+    };
+
+    if(options.watch && CompileServer::inRequest())
+    {
+        std::cout << "[CompilerError]: --watch can't be run by the compile server, run it without --client\n";
+        return 1;
+    }
+
+    if(options.watch)
+    {
+        CompileWatcher watcher{sourceFiles};
+        watcher.run(build);
+        std::cout << "[CompilerError]: Failed to watch files for changes (--watch is Linux only)\n";
         std::exit(1);
     }
-    
-    std::stringstream sourceCode;
-    sourceCode << in_file.rdbuf();
 
-    //----------------COMPILATION START----------------
-    auto start = std::chrono::high_resolution_clock::now();
+    return build(sourceFiles);
+}
+
+int main(int argc, char** argv)
+{
+    //Server and client flags are handled here, everything else is for runCompiler (in-process or in the server)
+    bool        server     = false;
+    bool        client     = std::getenv("FLUX_SERVER_SOCKET") != nullptr;
+    bool        watch      = false;
+    std::string socketPath = CompileServer::defaultSocketPath();
 
-    //Preprocessing Stage
-    Preprocessor preprocess{std::move(sourceCode.str())};
+    std::vector<char*> arguments = {argv[0]};
+    for (int i = 1; i < argc; ++i)
+    {
+        if(std::strcmp(argv[i], "--server") == 0)
+            server = true;
+        else if(std::strcmp(argv[i], "--client") == 0)
+            client = true;
+        else if(std::strncmp(argv[i], "--socket=", 9) == 0)
+            socketPath = argv[i] + 9;
+        else {
+            watch = watch || std::strcmp(argv[i], "--watch") == 0;
+            arguments.push_back(argv[i]);
+        }
+    }
 
-    //Lexing and Parsing Stage
-    Parser parser{preprocess.preprocess()};
-    auto& tree = parser.parse();
+    if(server)
+    {
+        //Only thing the server itself takes is how much it keeps in memory
+        std::uintmax_t cacheSizeMB = DEFAULT_CACHE_SIZE_MB;
+        for (std::size_t i = 1; i < arguments.size(); ++i)
+        {
+            if(std::strncmp(arguments[i], "--cache-size=", 13) == 0)
+                cacheSizeMB = std::strtoull(arguments[i] + 13, nullptr, 10);
+            else {
+                std::cout << "[CompilerError]: Unknown server option: " << arguments[i] << '\n';
+                std::exit(1);
+            }
+        }
 
-    //Intermediate Language Stage
-    ILGenerator ilgen{std::move(tree)};
-    auto& generatedBytecode = ilgen.generateIL();
+        CompileServer::serve(socketPath, runCompiler, cacheSizeMB * 1024 * 1024);
+        std::cout << "[CompilerError]: Failed to start compile server on: " << socketPath << " (already running?)\n";
+        std::exit(1);
+    }
 
-    //----------------COMPILATION END----------------
-    auto end = std::chrono::high_resolution_clock::now();
-    
-    //Write to file
-    FileWriter fw{"Gen.cflx"};
-    fw.writeToFile(generatedBytecode);
+    //Server runs with its own environment, cache directory of this one has to be passed along
+    //Watching never finishes so the server would never answer, it's done here instead
+    if(client && !watch)
+    {
+        std::vector<std::string> forwarded;
+        if(const char* cacheDir = std::getenv("FLUX_CACHE_DIR"))
+            forwarded.push_back(std::string{"--cache-dir="} + cacheDir);
+        forwarded.insert(forwarded.end(), arguments.begin() + 1, arguments.end());
 
-    std::cout << "Compilation Successful. Time to compile: " <<
-        (std::chrono::duration_cast<std::chrono::microseconds>(end - start)).count() << " microsec" << '\n';
+        int exitCode = 0;
+        if(CompileServer::request(socketPath, forwarded, exitCode))
+            return exitCode;
+    }
 
-    return 0;
-}
\ No newline at end of file
+    arguments.push_back(nullptr);
+    return runCompiler(static_cast<int>(arguments.size() - 1), arguments.data());
+}
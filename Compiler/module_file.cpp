@@ -0,0 +1,137 @@
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+#include "module_file.hpp"
+#include "replace_file.hpp"
+#include "../Common/cflx_format.hpp"
+
+bool writeModuleFile(const std::string& path, const ModuleContents& contents)
+{
+    //Sorted, same module always gives the exact same file
+    std::vector<std::pair<std::string, std::string>> sorted(contents.defines.begin(), contents.defines.end());
+    std::sort(sorted.begin(), sorted.end());
+
+    std::string                strings(1, '\0');
+    std::vector<CflxDefine>    records;
+    std::vector<std::uint32_t> includes;
+    for (auto &&[key, value] : sorted)
+    {
+        CflxDefine define{};
+        define.keyOffset = static_cast<std::uint32_t>(strings.size());
+        strings.append(key).push_back('\0');
+        define.valueOffset = static_cast<std::uint32_t>(strings.size());
+        strings.append(value).push_back('\0');
+        records.push_back(define);
+    }
+    for (auto &&include : contents.includes)
+    {
+        includes.push_back(static_cast<std::uint32_t>(strings.size()));
+        strings.append(include).push_back('\0');
+    }
+
+    //Header, section table (string table, defines, includes), then every section aligned
+    auto align = [](std::size_t size) { return (size + CFLX_SECTION_ALIGNMENT - 1) / CFLX_SECTION_ALIGNMENT * CFLX_SECTION_ALIGNMENT; };
+
+    CflxSection sections[3]{};
+    sections[0].type   = CFLX_SECTION_STRING_TABLE;
+    sections[0].offset = align(sizeof(CflxHeader) + sizeof(sections));
+    sections[0].size   = strings.size();
+    sections[1].type   = CFLX_SECTION_DEFINES;
+    sections[1].offset = align(sections[0].offset + sections[0].size);
+    sections[1].size   = records.size() * sizeof(CflxDefine);
+    sections[2].type   = CFLX_SECTION_INCLUDES;
+    sections[2].offset = align(sections[1].offset + sections[1].size);
+    sections[2].size   = includes.size() * sizeof(std::uint32_t);
+
+    std::vector<char> buffer(align(sections[2].offset + sections[2].size), 0);
+    std::memcpy(buffer.data() + sizeof(CflxHeader), sections, sizeof(sections));
+    std::memcpy(buffer.data() + sections[0].offset, strings.data(), strings.size());
+    if(!records.empty())
+        std::memcpy(buffer.data() + sections[1].offset, records.data(), sections[1].size);
+    if(!includes.empty())
+        std::memcpy(buffer.data() + sections[2].offset, includes.data(), sections[2].size);
+
+    CflxHeader header{};
+    std::memcpy(header.magic, CFLX_MAGIC, sizeof(header.magic));
+    header.versionMajor = CFLX_MODULE_VERSION;
+    header.versionMinor = CFLX_VERSION_MINOR;
+    header.flags        = CFLX_FLAG_MODULE;
+    header.sectionCount = 3;
+    header.checksum     = cflxChecksum(buffer.data() + sizeof(CflxHeader), buffer.size() - sizeof(CflxHeader));
+    std::memcpy(buffer.data(), &header, sizeof(CflxHeader));
+
+    //Other compilers (or -j threads) may be writing or reading the same module right now
+    return replaceFileContents(path, buffer.data(), buffer.size());
+}
+
+bool readModuleFile(const std::string& path, ModuleContents& contents)
+{
+    std::ifstream in{path, std::ios_base::binary};
+    if(!in)
+        return false;
+
+    std::ostringstream buffer;
+    buffer << in.rdbuf();
+    const std::string data = buffer.str();
+
+    if(data.size() < sizeof(CflxHeader))
+        return false;
+
+    CflxHeader header;
+    std::memcpy(&header, data.data(), sizeof(header));
+    if(std::memcmp(header.magic, CFLX_MAGIC, sizeof(CFLX_MAGIC)) != 0 || header.versionMajor != CFLX_MODULE_VERSION
+       || !(header.flags & CFLX_FLAG_MODULE)
+       || header.sectionCount > (data.size() - sizeof(CflxHeader)) / sizeof(CflxSection)
+       || cflxChecksum(data.data() + sizeof(CflxHeader), data.size() - sizeof(CflxHeader)) != header.checksum)
+        return false;
+
+    const char*                strings     = nullptr;
+    std::size_t                stringsSize = 0;
+    std::vector<CflxDefine>    records;
+    std::vector<std::uint32_t> includes;
+
+    for (std::uint32_t i = 0; i < header.sectionCount; ++i)
+    {
+        CflxSection section;
+        std::memcpy(&section, data.data() + sizeof(CflxHeader) + i * sizeof(CflxSection), sizeof(section));
+        if(section.offset > data.size() || section.size > data.size() - section.offset)
+            return false;
+
+        if(section.type == CFLX_SECTION_STRING_TABLE) {
+            strings     = data.data() + section.offset;
+            stringsSize = section.size;
+        }
+        else if(section.type == CFLX_SECTION_DEFINES) {
+            records.resize(section.size / sizeof(CflxDefine));
+            std::memcpy(records.data(), data.data() + section.offset, records.size() * sizeof(CflxDefine));
+        }
+        else if(section.type == CFLX_SECTION_INCLUDES) {
+            includes.resize(section.size / sizeof(std::uint32_t));
+            std::memcpy(includes.data(), data.data() + section.offset, includes.size() * sizeof(std::uint32_t));
+        }
+    }
+
+    if(strings == nullptr || stringsSize == 0 || strings[stringsSize - 1] != '\0')
+        return false;
+
+    //Nothing is kept unless the whole file is fine
+    ModuleContents loaded;
+    for (auto &&define : records)
+    {
+        if(define.keyOffset >= stringsSize || define.valueOffset >= stringsSize)
+            return false;
+        loaded.defines[strings + define.keyOffset] = strings + define.valueOffset;
+    }
+    for (auto &&include : includes)
+    {
+        if(include >= stringsSize)
+            return false;
+        loaded.includes.emplace_back(strings + include);
+    }
+
+    contents = std::move(loaded);
+    return true;
+}
@@ -0,0 +1,27 @@
+/* Precompiled modules (.fluxm), made the first time a module is included and used instead of its source after that.
+ * Only modules made of nothing but defines (and comments / other includes) can be precompiled, which is all of
+ * the standard library. Anything with code in it is still included as text.
+ * File is the same container as .cflx (see cflx_format.hpp) with CFLX_FLAG_MODULE, a string table, the defines
+ * and the includes. Defines of included modules are never copied in, those are loaded from their own source / .fluxm
+ * every time, so a .fluxm can't get out of date because something it includes changed.
+*/
+#ifndef UNNAMED_MODULE_FILE_HPP
+#define UNNAMED_MODULE_FILE_HPP
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+using ModuleDefines = std::unordered_map<std::string, std::string>;
+
+struct ModuleContents
+{
+    std::vector<std::string> includes; //A/B.flux paths, in the order they are included
+    ModuleDefines            defines;  //Only the ones of the module itself
+};
+
+//Both return false on failure without printing anything, caller just falls back to the module source
+bool writeModuleFile(const std::string& path, const ModuleContents& contents);
+bool readModuleFile(const std::string& path, ModuleContents& contents);
+
+#endif
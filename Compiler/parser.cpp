@@ -1,12 +1,120 @@
 #include <iostream>
 #include "parser.hpp"
+#include "ilgen.hpp"
 
-ListOfASTPtr& Parser::parse()
+ListOfASTPtr Parser::parse()
 {
     while(lex.get_current_token().token_type != TOKEN_EOF)
         statements.emplace_back(parse_statement());
 
-    return statements;
+    return arena.copyList(statements);
+}
+
+ASTPtr Parser::parseNext()
+{
+    streaming = true;
+    release_statement();
+
+    if(lex.get_current_token().token_type == TOKEN_EOF)
+        return nullptr;
+    return parse_statement();
+}
+
+bool Parser::emitNext(ILGenerator& ilgen)
+{
+    emitter   = &ilgen;
+    streaming = true;
+    release_statement();
+
+    if(lex.get_current_token().token_type == TOKEN_EOF)
+        return false;
+
+    //Compound statements are already generated by the time they are parsed
+    if(ASTPtr statement = parse_statement())
+        ilgen.generateStatement(statement);
+    return true;
+}
+
+std::uint16_t Parser::getGlobalFrameSize() const
+{
+    return frame_sizes.front();
+}
+
+void Parser::setGlobalFrameSize(std::uint16_t size)
+{
+    frame_sizes.front() = size;
+}
+
+//-----------------Streaming-----------------
+void Parser::release_statement()
+{
+    //Only global names outlive a statement, whatever they point to has to be moved out of the statement first
+    std::sort(statement_bindings.begin(), statement_bindings.end());
+    statement_bindings.erase(std::unique(statement_bindings.begin(), statement_bindings.end()), statement_bindings.end());
+
+    for (auto &&index : statement_bindings)
+    {
+        SymbolInfo& info = bindings[index].info;
+        if(info.type != EVAL_CALLABLE)
+            info.expr = persist_constant_expr(info.expr);
+    }
+    statement_bindings.clear();
+
+    //Signature is all a call needs, body is gone for good
+    for (auto &&function : statement_functions)
+        function->function_body = nullptr;
+    statement_functions.clear();
+
+    arena.reset();
+}
+
+//Copy of 'expr' outside of the statement arena, only if pre_evaluate_tree could do something with it.
+//Anything else can't be pre-evaluated anyways, nullptr makes pre_evaluate_tree fail the same way it would have
+ASTPtr Parser::persist_constant_expr(ASTPtr expr)
+{
+    if(expr == nullptr)
+        return nullptr;
+
+    switch(expr->getTag())
+    {
+        case ASTTag::Value:
+        {
+            const auto& value_node = static_cast<const ASTValue&>(*expr);
+            return persistent_arena.make<ASTValue>(value_node.type, persistent_arena.copyString(value_node.value));
+        }
+        case ASTTag::Binary:
+        {
+            const auto& binary_op_node = static_cast<const ASTBinaryOp&>(*expr);
+
+            ASTPtr left  = persist_constant_expr(binary_op_node.left);
+            ASTPtr right = persist_constant_expr(binary_op_node.right);
+            if(left == nullptr || right == nullptr)
+                return nullptr;
+            return persistent_arena.make<ASTBinaryOp>(binary_op_node.op_type, left, right);
+        }
+        case ASTTag::Unary:
+        {
+            const auto& unary_op_node = static_cast<const ASTUnaryOp&>(*expr);
+
+            ASTPtr unary_expr = persist_constant_expr(unary_op_node.expr);
+            return unary_expr == nullptr ? nullptr : persistent_arena.make<ASTUnaryOp>(unary_op_node.op_type, unary_expr);
+        }
+        case ASTTag::Cast:
+        {
+            const auto& cast_node = static_cast<const ASTCastNode&>(*expr);
+
+            ASTPtr cast_expr = persist_constant_expr(cast_node.eval_expr);
+            return cast_expr == nullptr ? nullptr : persistent_arena.make<ASTCastNode>(cast_node.eval_type, cast_expr);
+        }
+        case ASTTag::VarAccess:
+        {
+            const auto& var_access_node = static_cast<const ASTVariableAccess&>(*expr);
+            return persistent_arena.make<ASTVariableAccess>(var_access_node.identifier, var_access_node.var_type,
+                                                            var_access_node.scope_index, var_access_node.slot);
+        }
+        default:
+            return nullptr;
+    }
 }
 
 //-----------------Helper Functions-----------------
@@ -52,11 +160,11 @@ ListOfASTPtr Parser::parse_list(TokenType starting_token, TokenType ending_token
         printError("Expected starting token '", token_type_to_string.at(starting_token), '\'');
     advance();
 
-    ListOfASTPtr expr_list;
+    std::size_t list_start = list_scratch.size();
 
     while (!match_types(ending_token))
     {
-        expr_list.emplace_back(parse_expr());
+        list_scratch.emplace_back(parse_expr());
 
         if(!match_types(TOKEN_COMMA))
             break;
@@ -67,36 +175,34 @@ ListOfASTPtr Parser::parse_list(TokenType starting_token, TokenType ending_token
         printError("Expected ending token '", token_type_to_string.at(ending_token), '\'');
     advance();
 
-    //I trust compiler will RVO this, if not i cry
-    return expr_list;
+    return finish_list(list_start);
 }
 
 //-----------------TECHNICALLY Helper Functions-----------------
 ASTPtr Parser::parse_function_decl()
 {
-    //For dummy nodes so they have some lifetime and not instantly be dead
-    ListOfASTPtr temporary_dummy_scope;
-
     EvalType return_type = parse_type_as_param();
     
     if(!match_types(TOKEN_ID))
         printError("ParserError", "Expected identifier for function name");
 
-    std::string identifier = std::move(current_token.token_value);
+    SymbolId         identifier = current_token.token_symbol;
+    std::string_view name       = current_token.token_value; //For traces, interner may still belong to the lexer thread
     //Check if the identifier isn't already declared
     if(find_id_from_current_scope(identifier))
-        printError("ParserError", "Function name '", identifier, "' already exists (either as a variable or some other function name), use another one");
+        printError("ParserError", "Function name '", current_token.token_value, "' already exists (either as a variable or some other function name), use another one");
     advance();
 
-    //Create scope after we validate identifier
+    //Create scope after we validate identifier, function also gets its own frame for params and locals
     create_scope();
+    create_frame();
 
     if(!match_types(TOKEN_LPAREN))
         printError("ParserError", "Expected '(' after identifier");
     advance();
     
-    FuncParams func_params;
-    EvalType   vargs_type = EVAL_UNKNOWN;
+    std::vector<std::pair<EvalType, SymbolId>> func_params;
+    EvalType                                   vargs_type = EVAL_UNKNOWN;
 
     while (!match_types(TOKEN_RPAREN))
     {
@@ -105,7 +211,7 @@ ASTPtr Parser::parse_function_decl()
         //Vargs, break out of loop
         if(match_types(TOKEN_ELLIPSIS)) {
             //Used to detect if func has vargs by statements in function body
-            set_value_to_top_frame(current_token.token_value, nullptr, param_type);
+            set_value_to_top_frame(SYMBOL_ELLIPSIS, nullptr, param_type);
             advance();
 
             vargs_type = param_type;
@@ -116,12 +222,13 @@ ASTPtr Parser::parse_function_decl()
         if(!match_types(TOKEN_ID))
             printError("ParserError", "Expected identifier after type");
 
-        //Create dummy node, set its value in symbol table, move its pointer to dummy scope where its lifetime is managed
-        ASTPtr dummy_expr = std::make_unique<ASTDummyNode>(param_type);
-        set_value_to_top_frame(current_token.token_value, dummy_expr, param_type);
-        temporary_dummy_scope.emplace_back(std::move(dummy_expr));
+        //Create dummy node (it lives in the arena like any other node) and set its value in symbol table
+        //Params are the first slots of function frame, in the same order as they are declared
+        ASTPtr dummy_expr = arena.make<ASTDummyNode>(param_type);
+        SymbolId param_name = current_token.token_symbol;
+        set_value_to_top_frame(param_name, dummy_expr, param_type, allocate_slot(param_name));
 
-        func_params.emplace_back(param_type, std::move(current_token.token_value));
+        func_params.emplace_back(param_type, param_name);
         advance();
 
         if(!match_types(TOKEN_COMMA))
@@ -134,28 +241,43 @@ ASTPtr Parser::parse_function_decl()
     advance();
 
     //Pre set it to symbol table once to allow recursive calls to be a thing
-    auto func_node = create_func_decl_node(return_type, identifier, std::move(func_params), nullptr, vargs_type);
+    auto func_node = create_func_decl_node(return_type, identifier, persistent_arena.copyList(func_params), nullptr, vargs_type);
     set_value_to_top_frame(identifier, func_node, EVAL_CALLABLE);
     
+    ASTFunctionDecl* prev_function = current_function;
+    current_function = static_cast<ASTFunctionDecl*>(func_node);
+
+    //Frame size isn't known yet, its patched in once the body is done
+    if(emitter != nullptr)
+        emitter->generateFunctionStart(*current_function);
+
     SAVE_RETURN_TYPE(return_type)
     ASTPtr func_body = parse_block(true);
     RESTORE_RETURN_TYPE
+
+    current_function = prev_function;
     
     //Weird ahh syntax but this allows me to set its body manually
     //I want to keep AST nodes as clean as possible without adding too many functions hence this syntax
-    static_cast<ASTFunctionDecl*>(func_node.get())->function_body = std::move(func_body);
+    static_cast<ASTFunctionDecl*>(func_node)->function_body = func_body;
+    static_cast<ASTFunctionDecl*>(func_node)->frame_size    = destroy_frame();
+    FLUX_TRACE(TRACE_PARSE, TRACE_SUMMARY, "Function '" << name << "' with " << static_cast<ASTFunctionDecl*>(func_node)->function_params.size()
+                                           << " params, frame size " << static_cast<ASTFunctionDecl*>(func_node)->frame_size);
+
+    if(emitter != nullptr)
+        emitter->generateFunctionEnd(*static_cast<ASTFunctionDecl*>(func_node));
 
     destroy_scope();
     //We destroy function scope but the scope behind the function scope is still present, that's where we push its value again
     set_value_to_top_frame(identifier, func_node, EVAL_CALLABLE);
-    return func_node;
+    return emitter != nullptr ? nullptr : func_node;
 }
 
-ASTPtr Parser::parse_function_call(const std::string& func_name)
+ASTPtr Parser::parse_function_call(SymbolId func_name)
 {
     ASTFunctionDecl* inital_function = static_cast<ASTFunctionDecl*>(get_expr_from_symbol_table(func_name));
     FuncArgs         func_args       = parse_list(TOKEN_LPAREN, TOKEN_RPAREN);
-    FuncParams&      func_params     = inital_function->function_params;
+    FuncParams       func_params     = inital_function->function_params;
     EvalType         vargs_type      = inital_function->vargs_type;
     bool             has_vargs       = vargs_type != EVAL_UNKNOWN;
 
@@ -163,10 +285,10 @@ ASTPtr Parser::parse_function_call(const std::string& func_name)
 
     //For vargs we just need to see if its '<' or not, no need for it to be equal
     if(has_vargs && args_len < params_len)
-        printError("ParserError", "Function '", func_name, "' expected atleast ", params_len, " arguments but got ", args_len);
+        printError("ParserError", "Function '", symbol_name(func_name), "' expected atleast ", params_len, " arguments but got ", args_len);
     //Check if len of function params matches len of func_args, if it doesn't, error
     if(!has_vargs && args_len != params_len)
-        printError("ParserError", "Function '", func_name, "' expected ", params_len, " arguments but got ", args_len);
+        printError("ParserError", "Function '", symbol_name(func_name), "' expected ", params_len, " arguments but got ", args_len);
     
     //Check datatype compatibility between args and params
     for (std::size_t i = 0; i < params_len; ++i)
@@ -179,7 +301,7 @@ ASTPtr Parser::parse_function_call(const std::string& func_name)
         EvalType arg_type = func_args[i]->evaluateExprType();
 
         if (arg_type != param_type)
-            printError("ParserError", "Parameter '", func_params[i].second, "' has incompatible type with the Argument passed to it");
+            printError("ParserError", "Parameter '", symbol_name(func_params[i].second), "' has incompatible type with the Argument passed to it");
     }
     //If vargs exist and its not auto type vargs, check compatibility from params len as starting point till args len
     if(has_vargs && vargs_type != EVAL_AUTO)
@@ -193,10 +315,10 @@ ASTPtr Parser::parse_function_call(const std::string& func_name)
     }
 
     //All set, create node and return
-    return create_func_call_node(std::move(func_args), inital_function);
+    return create_func_call_node(func_args, inital_function);
 }
 
-ASTPtr Parser::parse_builtin_function_call(const std::string& func_name)
+ASTPtr Parser::parse_builtin_function_call(SymbolId func_name)
 {
     auto&&   function  = builtinMap.at(func_name);
     bool     has_vargs = std::get<1>(function) == UINT64_MAX;
@@ -206,10 +328,10 @@ ASTPtr Parser::parse_builtin_function_call(const std::string& func_name)
 
     //Same as parse_function_call
     if(!has_vargs && args_len != params_len)
-        printError("ParserError", "Function '", func_name, "' expected ", params_len, " arguments but got ", args_len);
+        printError("ParserError", "Function '", symbol_name(func_name), "' expected ", params_len, " arguments but got ", args_len);
     
     //Simply return builtin_node
-    return create_builtin_func_call_node(std::get<0>(function), std::get<2>(function), std::move(func_args), has_vargs);
+    return create_builtin_func_call_node(std::get<0>(function), std::get<2>(function), func_args, has_vargs);
 }
 
 ASTPtr Parser::parse_if_condition()
@@ -228,9 +350,15 @@ ASTPtr Parser::parse_if_condition()
         printError("ParserError", "Expected closing ')' for If clause");
     advance();
 
+    if(emitter != nullptr)
+        emitter->generateIfStart(if_condition);
+
     //Look for '{' body '}'
     ASTPtr if_body = parse_block();
 
+    if(emitter != nullptr)
+        emitter->generateIfBodyEnd();
+
     //Now check for Elif clauses, if they exist that is. Condition, Body
     std::vector<std::pair<ASTPtr, ASTPtr>> elif_clauses;
     while(match_types(TOKEN_KEYWORD_ELIF))
@@ -245,10 +373,18 @@ ASTPtr Parser::parse_if_condition()
         if(!match_types(TOKEN_RPAREN)) printError("ParserError", "Expected closing ')' for Elif clause after condition");
         advance();
 
+        if(emitter != nullptr)
+            emitter->generateElifStart(elif_condition);
+
         //'{' body '}'
         auto elif_body = parse_block();
 
-        elif_clauses.push_back({std::move(elif_condition), std::move(elif_body)});
+        if(emitter != nullptr) {
+            emitter->generateIfBodyEnd();
+            continue;
+        }
+
+        elif_clauses.push_back({elif_condition, elif_body});
     }
 
     //Look for else if it exists
@@ -260,16 +396,21 @@ ASTPtr Parser::parse_if_condition()
         else_block = parse_block();
     }
 
+    if(emitter != nullptr) {
+        emitter->generateIfEnd();
+        return nullptr;
+    }
+
     //With all the information create IfNode
-    return create_if_node(std::move(if_condition), std::move(if_body), std::move(elif_clauses), std::move(else_block));
+    return create_if_node(if_condition, if_body, arena.copyList(elif_clauses), else_block);
 }
 
 ASTPtr Parser::parse_for_loop()
 {
     //Look for an identifier
-    std::string id = std::move(current_token.token_value);
     if(!match_types(TOKEN_ID))
         printError("ParserError", "Expected identifier after 'For'");
+    SymbolId id = current_token.token_symbol;
     
     advance();
     //Look for 'in' keyword
@@ -281,14 +422,28 @@ ASTPtr Parser::parse_for_loop()
     //Get iterator
     auto iter = parse_iterator(id);
 
-    //Add the for identifier to symbol table with the evaluated type of range
-    set_value_to_top_frame(id, iter, iter->evaluateIterType());
+    //Add the for identifier to symbol table with the evaluated type of range, iterator writes straight into its slot
+    std::uint16_t scope_index = current_scope_index();
+    std::uint16_t slot        = allocate_slot(id);
+    set_value_to_top_frame(id, iter, iter->evaluateIterType(), slot);
+
+    auto iter_node = static_cast<ASTBaseIterator*>(iter);
+    iter_node->iter_scope_index = scope_index;
+    iter_node->iter_slot        = slot;
+
+    //Generating the loop needs everything but its body, so node is made before the body is parsed
+    if(emitter != nullptr) {
+        emitter->generateForStart(*static_cast<ASTForNode*>(create_for_node(id, iter, nullptr, scope_index, slot)));
+        parse_block();
+        emitter->generateForEnd();
+        return nullptr;
+    }
 
     //Now look for code block as usual
     auto for_body = parse_block();
 
     //Thats it return node
-    return create_for_node(id, std::move(iter), std::move(for_body));
+    return create_for_node(id, iter, for_body, scope_index, slot);
 }
 
 ASTPtr Parser::parse_while_loop()
@@ -298,19 +453,30 @@ ASTPtr Parser::parse_while_loop()
         printError("ParserError", "Expected '(' after 'While'");
     advance();
 
+    //Condition is generated after the loop start, where 'Continue' and every iteration jump to
+    if(emitter != nullptr)
+        emitter->generateWhileStart();
+
     ASTPtr while_condition = parse_comp_expr();
 
     if(!match_types(TOKEN_RPAREN))
         printError("ParserError", "Expected ')' after Expression");
     advance();
 
+    if(emitter != nullptr) {
+        emitter->generateWhileCondition(while_condition);
+        parse_block();
+        emitter->generateWhileEnd();
+        return nullptr;
+    }
+
     ASTPtr while_body = parse_block();
 
     //Create and return it
-    return create_while_node(std::move(while_condition), std::move(while_body));
+    return create_while_node(while_condition, while_body);
 }
 
-ASTPtr Parser::parse_iterator(const std::string& iter_id)
+ASTPtr Parser::parse_iterator(SymbolId iter_id)
 {
     //Vargs iterator
     if(match_types(TOKEN_ELLIPSIS))
@@ -319,7 +485,7 @@ ASTPtr Parser::parse_iterator(const std::string& iter_id)
     return parse_range_iterator(iter_id, 0);
 }
 
-ASTPtr Parser::parse_range_iterator(const std::string& iter_id, bool condition_or_construction)
+ASTPtr Parser::parse_range_iterator(SymbolId iter_id, bool condition_or_construction)
 {
     //Look for start..stop..step || start : stop : step
     TokenType range_split_token;
@@ -359,7 +525,7 @@ ASTPtr Parser::parse_range_iterator(const std::string& iter_id, bool condition_o
                 start = create_value_node(EVAL_INT, std::to_string(eval_start));
                 stop  = create_value_node(EVAL_INT, std::to_string(eval_stop));
 
-                step = std::move(create_value_node(EVAL_INT, (eval_start < eval_stop ? "1" : "-1")));
+                step = create_value_node(EVAL_INT, (eval_start < eval_stop ? "1" : "-1"));
             }
             //We failed to pre evaluate, dont do anything, just notify for now
             catch(const std::runtime_error& e) {
@@ -384,7 +550,7 @@ ASTPtr Parser::parse_range_iterator(const std::string& iter_id, bool condition_o
 
                 std::double_t interval = 10.0f * std::pow(10, order-1);
 
-                step = std::move(create_value_node(EVAL_FLOAT, std::to_string(eval_start < eval_stop ? interval : -interval)));
+                step = create_value_node(EVAL_FLOAT, std::to_string(eval_start < eval_stop ? interval : -interval));
             }
             catch(const std::runtime_error& e) {
                 printError("ParserError", "Failed to Pre-Evaluate step value for 'RangeIterator', please specify step value (start..stop..step)");
@@ -392,13 +558,13 @@ ASTPtr Parser::parse_range_iterator(const std::string& iter_id, bool condition_o
         }
     }
 
-    return create_range_iter_node(std::move(start), std::move(stop), std::move(step), iter_id, condition_or_construction);
+    return create_range_iter_node(start, stop, step, iter_id, condition_or_construction);
 }
 
-ASTPtr Parser::parse_ellipsis_iterator(const std::string& iter_id)
+ASTPtr Parser::parse_ellipsis_iterator(SymbolId iter_id)
 {
     //Check if we can use ... or not
-    auto&&[type, idx] = get_type_from_symbol_table(current_token.token_value);
+    auto&&[type, idx, slot] = get_type_from_symbol_table(SYMBOL_ELLIPSIS);
     //Means we are not inside of a function having vargs or not inside of a function at all
     if(type == EVAL_UNKNOWN)
         printError("ParserError", "Can't use '...' syntax in 'For' loop. Can only be used inside of functions having Variadic Arguments");
@@ -414,31 +580,39 @@ ASTPtr Parser::parse_block(bool is_func)
     if(!match_types(TOKEN_LBRACE)) printError("ParserError", "Expected '{' for statement");
     advance();
 
-    ListOfASTPtr statements;
+    std::size_t list_start = list_scratch.size();
     while(!match_types(TOKEN_RBRACE))
     {
         auto stmt = parse_statement();
         
         //-------Tailcall handling-------
-        if((is_func) && (stmt->getTag() == ASTTag::Return)) {
-            const auto return_stmt = static_cast<ASTReturn*>(stmt.get());
+        if((is_func) && (stmt != nullptr) && (stmt->getTag() == ASTTag::Return)) {
+            const auto return_stmt = static_cast<ASTReturn*>(stmt);
             
             if(return_stmt->return_expr->getTag() == ASTTag::FunctionCall) {
-                const auto func_call = static_cast<ASTFunctionCall*>(return_stmt->return_expr.get());
+                const auto func_call = static_cast<ASTFunctionCall*>(return_stmt->return_expr);
                 //Set tailcall to true only if its recursion, vargs does not support TCO for now
-                func_call->is_tail_call = (func_call->initial_func->function_body == nullptr)
+                //(body of a function that already ended may be gone too while streaming, so it can't tell us that)
+                func_call->is_tail_call = (func_call->initial_func == current_function)
                                           &&
                                           (func_call->initial_func->vargs_type == EVAL_UNKNOWN);
             }
         }
         
-        statements.emplace_back(std::move(stmt));
+        if(emitter != nullptr) {
+            //nullptr is an If / loop / function already generated
+            if(stmt != nullptr)
+                emitter->generateBlockStatement(stmt);
+            continue;
+        }
+
+        list_scratch.emplace_back(stmt);
     }
         
     if(!match_types(TOKEN_RBRACE)) printError("ParserError", "Expected '}' for statement");
     advance();
 
-    return create_block_node(std::move(statements));
+    return emitter != nullptr ? nullptr : create_block_node(finish_list(list_start));
 }
 
 ASTPtr Parser::parse_cast()
@@ -461,19 +635,19 @@ ASTPtr Parser::parse_cast()
     advance();
 
     //construct and return the dummy ast node
-    return create_cast_node(eval_type, std::move(expr));
+    return create_cast_node(eval_type, expr);
 }
 
-ASTPtr Parser::parse_reassignment(EvalType var_type, std::uint16_t scope_index)
+ASTPtr Parser::parse_reassignment(EvalType var_type, std::uint16_t scope_index, std::uint16_t slot)
 {
     //Grab the identifier
     if(!match_types(TOKEN_ID))
         printError("ParserError", "Expected identifier after type");
 
     //Variable name should exist
-    std::string identifier = std::move(current_token.token_value);
-    if(get_type_from_symbol_table(identifier).first == EVAL_UNKNOWN)
-        printError("ParserError", "Trying to access variable: '", identifier, "' that doesn't exist.");
+    SymbolId identifier = current_token.token_symbol;
+    if(std::get<0>(get_type_from_symbol_table(identifier)) == EVAL_UNKNOWN)
+        printError("ParserError", "Trying to access variable: '", current_token.token_value, "' that doesn't exist.");
 
     advance();
 
@@ -491,15 +665,18 @@ ASTPtr Parser::parse_reassignment(EvalType var_type, std::uint16_t scope_index)
     {
         //Add it to symbol table and create AST
         set_value_to_nth_frame(identifier, var_expr, var_type);
-        return create_variable_assign_node(var_type, identifier, std::move(var_expr), true, scope_index);
+        return create_variable_assign_node(var_type, identifier, var_expr, true, scope_index, slot);
     }
     //Oops, types dont match, errrorrrrr!
-    printError("ParserError", "Evaluated expression type doesn't match the type pre-assigned to variable: ", identifier);
+    printError("ParserError", "Evaluated expression type doesn't match the type pre-assigned to variable: ", symbol_name(identifier));
 }
 
-ASTPtr Parser::parse_declaration(EvalType var_type, std::uint16_t scope_index)
+ASTPtr Parser::parse_declaration(EvalType var_type)
 {
-    ListOfASTPtr declarations;
+    //Declarations always go to the frame we are currently in
+    std::uint16_t scope_index = current_scope_index();
+
+    std::size_t list_start = list_scratch.size();
     //We check for multiple variables to assign for
     //Type identifier, identifier = expr, identifier;
     while(true)
@@ -509,9 +686,9 @@ ASTPtr Parser::parse_declaration(EvalType var_type, std::uint16_t scope_index)
             printError("ParserError", "Expected identifier after type");
 
         //Variable name should not clash with the existing names
-        std::string identifier = std::move(current_token.token_value);
+        SymbolId identifier = current_token.token_symbol;
         if(find_id_from_current_scope(identifier))
-            printError("ParserError", "Current variable: '", identifier, "' already exists, use another name");
+            printError("ParserError", "Current variable: '", current_token.token_value, "' already exists, use another name");
 
         advance();
 
@@ -520,11 +697,12 @@ ASTPtr Parser::parse_declaration(EvalType var_type, std::uint16_t scope_index)
         {
             //Yeah its a bit hard to understand but uhh yeah
             //Bro the compiler is useless af
-            declarations.emplace_back(create_variable_assign_node(
-                    var_type, identifier, create_value_node(var_type, "0"), false, scope_index));
+            std::uint16_t slot = allocate_slot(identifier);
+            list_scratch.emplace_back(create_variable_assign_node(
+                    var_type, identifier, create_value_node(var_type, "0"), false, scope_index, slot));
             
             //Now add it to symbol table ig
-            set_value_to_top_frame(identifier, declarations.back(), var_type);
+            set_value_to_top_frame(identifier, list_scratch.back(), var_type, slot);
         }
         //We found '=' symbol
         else
@@ -537,13 +715,14 @@ ASTPtr Parser::parse_declaration(EvalType var_type, std::uint16_t scope_index)
 
             if(var_type == expr_type || var_type == EVAL_AUTO)
             {
-                //Add it to symbol table and create AST
-                set_value_to_top_frame(identifier, var_expr, var_type);
-                declarations.emplace_back(create_variable_assign_node(var_type, identifier, std::move(var_expr), false, scope_index));
+                //Add it to symbol table and create AST, slot is allocated after the expression so 'Int a = a' still sees the old 'a'
+                std::uint16_t slot = allocate_slot(identifier);
+                set_value_to_top_frame(identifier, var_expr, var_type, slot);
+                list_scratch.emplace_back(create_variable_assign_node(var_type, identifier, var_expr, false, scope_index, slot));
             }
             else
                 //Oops, types dont match, errrorrrrr!
-                printError("ParserError", "Evaluated expression type doesn't match the type assigned to variable: '", identifier, '\'');
+                printError("ParserError", "Evaluated expression type doesn't match the type assigned to variable: '", symbol_name(identifier), '\'');
         }
         //Now we look for ',' if we dont find it, then we know that we reached the end of it;
         if(!match_types(TOKEN_COMMA))
@@ -552,77 +731,31 @@ ASTPtr Parser::parse_declaration(EvalType var_type, std::uint16_t scope_index)
     }
 
     //return ASTBlock after we r done parsing this
-    return create_block_node(std::move(declarations));
+    return create_block_node(finish_list(list_start));
 }
 
-ASTPtr Parser::parse_variable(EvalType var_type, bool is_reassignment, std::uint16_t scope_index)
+ASTPtr Parser::parse_variable(EvalType var_type, bool is_reassignment, std::uint16_t scope_index, std::uint16_t slot)
 {
     switch (is_reassignment)
     {
         case true:
-            return parse_reassignment(var_type, scope_index);
+            return parse_reassignment(var_type, scope_index, slot);
         case false:
-            return parse_declaration(var_type, scope_index);
-    }
-}
-
-//common binary operations such as addition, subtraction etc
-ASTPtr Parser::common_binary_op(
-        ParseFuncPtr callback_left,
-        TokenType first,
-        TokenType second,
-        ParseFuncPtr callback_right = nullptr)
-{
-    if(callback_right == nullptr)
-        callback_right = callback_left;
-    
-    auto left = callback_left();
-
-    
-    while (match_types(first) || match_types(second))
-    {
-        //save the current operator type
-        TokenType op = current_token.token_type;
-        advance();
-
-        auto right = callback_right();
-        
-        left = create_binary_op_node(op, std::move(left), std::move(right));
+            return parse_declaration(var_type);
     }
-    
-    return left;
-}
-
-//Overload of common_binary_op for multiple params
-ASTPtr Parser::common_binary_op(
-    ParseFuncPtr callback_left,
-    std::size_t mask,
-    ParseFuncPtr callback_right = nullptr)
-{
-    if(callback_right == nullptr)
-        callback_right = callback_left;
-    
-    auto left = callback_left();
-
-    while(SAME_PRECEDENCE_MASK_CHECK(current_token.token_type, mask))
-    {
-        //save the current operator type
-        TokenType op = current_token.token_type;
-        advance();
-
-        auto right = callback_right();
-        
-        left = create_binary_op_node(op, std::move(left), std::move(right));
-    }
-
-    return left;
 }
 
 //-----------------START OF PARSING-----------------
 ASTPtr Parser::parse_statement()
 {
-    ASTPtr    function_return_value = nullptr;
-    TokenType statement_type = current_token.token_type;
+    ASTPtr        function_return_value = nullptr;
+    TokenType     statement_type = current_token.token_type;
+    std::uint32_t statement_line = static_cast<std::uint32_t>(Lexer::getLineColCount().first);
+    FLUX_TRACE(TRACE_PARSE, TRACE_DETAIL, "Line " << statement_line << ": '" << current_token.token_value << "' statement, scope depth " << scope_starts.size());
+
+    //If / loops / functions are generated while they are parsed, their line has to be known before that
+    if(emitter != nullptr && statement_type >= TOKEN_KEYWORD_IF && statement_type <= TOKEN_KEYWORD_FUNC)
+        emitter->recordLine(statement_line);
 
     switch(statement_type)
     {
@@ -632,21 +765,17 @@ ASTPtr Parser::parse_statement()
         {
             EvalType var_type = token_to_eval_type.at(current_token.token_type);
             advance();
-            //Scope index really doesn't matter for assignment, i'm just putting random values cuz why not
-            function_return_value = parse_variable(var_type, false, UINT16_MAX);
+            //Scope index and slot really don't matter for declaration, they are decided by parse_declaration itself
+            function_return_value = parse_variable(var_type, false, UINT16_MAX, UINT16_MAX);
         }
         break;
         case TOKEN_KEYWORD_IF:
         {
             advance();
 
-            CBR_PARAMS_START(IS_USING_SYMTBL)
-            SCOPE_DEPTH_INC
             create_scope();
             function_return_value = parse_if_condition();
             destroy_scope();
-            SCOPE_DEPTH_DEC
-            CBR_PARAMS_END
         }
         break;
         case TOKEN_KEYWORD_FOR:
@@ -686,7 +815,7 @@ ASTPtr Parser::parse_statement()
                 printError("ParserError", "'Continue' not allowed outside of a loop");
             
             advance();
-            function_return_value = create_continue_node(cbr_params, non_loops_scope_depth);
+            function_return_value = create_continue_node(cbr_params);
         }
         break;
         case TOKEN_KEYWORD_BREAK:
@@ -695,7 +824,7 @@ ASTPtr Parser::parse_statement()
                 printError("ParserError", "'Break' not allowed outside of a loop");
             
             advance();
-            function_return_value = create_break_node(cbr_params, non_loops_scope_depth);
+            function_return_value = create_break_node(cbr_params);
         }
         break;
         case TOKEN_KEYWORD_RETURN:
@@ -726,7 +855,7 @@ ASTPtr Parser::parse_statement()
                 if(return_type != current_return_type && current_return_type != EVAL_AUTO)
                     printError("ParserError", "Return type does not match the function's declared return type");
 
-                function_return_value = create_return_node(std::move(return_expr));
+                function_return_value = create_return_node(return_expr);
             }
         }
         break;
@@ -747,6 +876,9 @@ ASTPtr Parser::parse_statement()
         advance();
     }
 
+    //Direct emission doesn't make nodes for If / loops / functions
+    if(function_return_value != nullptr)
+        function_return_value->line = statement_line;
     return function_return_value;
 }
 
@@ -758,15 +890,15 @@ ASTPtr Parser::parse_expr()
     {
         if(peek().token_type == TOKEN_EQ)
         {
-            auto&&[type, scope_index] = get_type_from_symbol_table(current_token.token_value);
+            auto&&[type, scope_index, slot] = get_type_from_symbol_table(current_token.token_symbol);
             if(type == EVAL_UNKNOWN)
                 printError("ParserError", "Undefined variable: ", current_token.token_value);
 
-            return parse_variable(type, true, scope_index);
+            return parse_variable(type, true, scope_index, slot);
         }
     }
     
-    auto expr = common_binary_op(std::bind(parse_comp_expr, this), TOKEN_AND, TOKEN_OR);
+    auto expr = parse_binary_expr(PRECEDENCE_LOGICAL);
 
     //we can now check for Ternary operation, if we have a '?' token
     if(match_types(TOKEN_QUESTION))
@@ -784,80 +916,96 @@ ASTPtr Parser::parse_expr()
         auto false_expr = parse_expr();
 
         //now return Ternary Operation
-        return create_ternary_op_node(std::move(expr), std::move(true_expr), std::move(false_expr));
+        return create_ternary_op_node(expr, true_expr, false_expr);
     }
 
     //Not a ternary expression
     return expr;
 }
 
-//'!' | 'is' or arith_expr 
+//'!' | 'is' or arith_expr, used where '&&' / '||' can't appear (While condition)
 ASTPtr Parser::parse_comp_expr()
 {
-    //For ! expr
-    if(match_types(TOKEN_NOT))
-    {
-        TokenType type = current_token.token_type;
-        advance();
-        
-        //Get Comparision expression again
-        auto expr = parse_comp_expr();
-
-        return create_unary_op_node(type, std::move(expr));
-    }
-    //For the other stuff, they all have same precedance so just pass them all in common binary op
-    ///Note: Mask (comparisionTypeMask) already exists in ast.hpp
-    auto compExpr = common_binary_op(std::bind(parse_arith_expr, this), comparisionTypeMask);
-
-    //Expr is Type
-    if(match_types(TOKEN_KEYWORD_IS))
-    {
-        advance();
-        auto type = parse_type();
-        return create_binary_op_node(TOKEN_KEYWORD_IS, std::move(compExpr), create_value_node(EVAL_INT, std::to_string(type)));
-    }
-
-    return compExpr;
+    return parse_binary_expr(PRECEDENCE_COMPARISON);
 }
 
-//Plus/Minus operation
+//Plus/Minus operation and everything that binds tighter (Range bounds)
 ASTPtr Parser::parse_arith_expr()
 {
-    return common_binary_op(std::bind(&parse_term, this), TOKEN_PLUS, TOKEN_MINUS);
+    return parse_binary_expr(PRECEDENCE_ARITH);
 }
 
-//Multiply/Divide/Modulo operation for two numbers
-ASTPtr Parser::parse_term()
+//Precedence climbing over binaryOperatorTable (ast.hpp), only operators binding at least as tight as 'min_precedence' are taken
+ASTPtr Parser::parse_binary_expr(std::uint8_t min_precedence)
 {
-    //Note: Mask(termExprTypeMask) exists in ast.hpp
-    return common_binary_op(std::bind(&parse_unary, this), termExprTypeMask);
+    auto left = parse_prefix_expr(min_precedence);
+
+    //'Expr is Type' ends the comparision, only '&&' / '||' may follow it
+    std::uint8_t max_precedence = PRECEDENCE_POWER;
+
+    while(true)
+    {
+        TokenType op = current_token.token_type;
+
+        if(op == TOKEN_KEYWORD_IS)
+        {
+            if(min_precedence > PRECEDENCE_COMPARISON || max_precedence < PRECEDENCE_COMPARISON)
+                break;
+            advance();
+
+            auto type = parse_type();
+            left = create_binary_op_node(TOKEN_KEYWORD_IS, left, create_value_node(EVAL_INT, std::to_string(type)));
+            max_precedence = PRECEDENCE_LOGICAL;
+            continue;
+        }
+
+        //Tokens past the table (shouldn't exist but eh) and non operators have no precedence
+        if(op >= binaryOperatorTable.size())
+            break;
+
+        const BinaryOperatorInfo& info = binaryOperatorTable[op];
+        if(info.precedence == PRECEDENCE_NONE || info.precedence < min_precedence || info.precedence > max_precedence)
+            break;
+        advance();
+
+        //Left associative: right side only takes operators binding tighter than this one
+        auto right = parse_binary_expr(info.is_right_assoc ? info.precedence : info.precedence + 1);
+        left = create_binary_op_node(op, left, right);
+    }
+
+    return left;
 }
 
-//Unary Op
-ASTPtr Parser::parse_unary()
+//Unary ops (-5, +30, !a, etc) or a call / atom
+ASTPtr Parser::parse_prefix_expr(std::uint8_t min_precedence)
 {
     switch (current_token.token_type)
     {
-        //Unary ops (-5, +30, etc)
+        //'-2 ^ 2' is '-(2 ^ 2)', so only power goes into the operand
         case TOKEN_MINUS:
         case TOKEN_PLUS:
         {
             TokenType op_type = current_token.token_type;
+            advance();
+
+            auto expr = parse_binary_expr(PRECEDENCE_POWER);
+            return create_unary_op_node(op_type, expr);
+        }
+        //'!' negates a whole comparision, so its not allowed inside of arithmetic (falls through to atom error)
+        case TOKEN_NOT:
+        {
+            if(min_precedence > PRECEDENCE_COMPARISON)
+                break;
 
+            TokenType op_type = current_token.token_type;
             advance();
-            auto expr = parse_unary();
 
-            return create_unary_op_node(op_type, std::move(expr));
+            auto expr = parse_binary_expr(PRECEDENCE_COMPARISON);
+            return create_unary_op_node(op_type, expr);
         }
     }
 
-    return parse_power();
-}
-
-//For power operations, like 2 ^ 2 etc
-ASTPtr Parser::parse_power()
-{
-    return common_binary_op(std::bind(&parse_call, this), TOKEN_POW, TOKEN_POW, std::bind(&parse_unary, this));
+    return parse_call();
 }
 
 //Function call or simply return atom
@@ -881,6 +1029,10 @@ ASTPtr Parser::parse_call()
         return parse_function_call(id.identifier);
     }
 
+    //Functions can't be used as values, there is nothing to push for them
+    if(atom->isCallable())
+        printError("ParserError", "Function '", symbol_name(static_cast<const ASTVariableAccess&>(*atom).identifier), "' must be called using '()'");
+
     //Else just return the atom
     return atom;
 }
@@ -893,13 +1045,14 @@ ASTPtr Parser::parse_atom()
         //Variable/Function getter
         case TOKEN_ID:
         {
-            auto&&[type, scope_index] = get_type_from_symbol_table(current_token.token_value);
-            bool  isBuiltinType       = builtinMap.find(current_token.token_value) != builtinMap.end();
+            SymbolId identifier = current_token.token_symbol;
+            auto&&[type, scope_index, slot] = get_type_from_symbol_table(identifier);
+            bool  isBuiltinType             = builtinMap.find(identifier) != builtinMap.end();
 
             if(type != EVAL_UNKNOWN || (isBuiltinType))
             {
                 //We need the proper string value
-                auto expr = create_variable_access_node(isBuiltinType ? EVAL_BUILTIN : type, current_token.token_value, scope_index);
+                auto expr = create_variable_access_node(isBuiltinType ? EVAL_BUILTIN : type, identifier, scope_index, slot);
                 advance();
                 return expr;
             }
@@ -935,104 +1088,116 @@ ASTPtr Parser::parse_atom()
 }
 
 //-----------------NODE CREATION-----------------
-ASTPtr Parser::create_value_node(EvalType type, const std::string& value)
+ASTPtr Parser::create_value_node(EvalType type, std::string_view value)
 {
-    return std::make_unique<ASTValue>(type, value);
+    return arena.make<ASTValue>(type, arena.copyString(value));
 }
 
-ASTPtr Parser::create_binary_op_node(TokenType op_type, ASTPtr&& left, ASTPtr&& right)
+ASTPtr Parser::create_binary_op_node(TokenType op_type, ASTPtr left, ASTPtr right)
 {
-    return std::make_unique<ASTBinaryOp>(op_type, std::move(left), std::move(right));
+    return arena.make<ASTBinaryOp>(op_type, left, right);
 }
 
-ASTPtr Parser::create_unary_op_node(TokenType op_type, ASTPtr&& expr)
+ASTPtr Parser::create_unary_op_node(TokenType op_type, ASTPtr expr)
 {
-    return std::make_unique<ASTUnaryOp>(op_type, std::move(expr));
+    return arena.make<ASTUnaryOp>(op_type, expr);
 }
 
-ASTPtr Parser::create_variable_assign_node(EvalType var_type, const std::string& identifier, ASTPtr&& var_expr,
-                                            bool is_reassignment, std::uint16_t scope_index)
+ASTPtr Parser::create_variable_assign_node(EvalType var_type, SymbolId identifier, ASTPtr var_expr,
+                                            bool is_reassignment, std::uint16_t scope_index, std::uint16_t slot)
 {
-    return std::make_unique<ASTVariableAssign>(identifier, var_type, std::move(var_expr), is_reassignment, scope_index);
+    return arena.make<ASTVariableAssign>(identifier, var_type, var_expr, is_reassignment, scope_index, slot);
 }
 
-ASTPtr Parser::create_variable_access_node(EvalType var_type, const std::string& identifier, std::uint16_t scope_index)
+ASTPtr Parser::create_variable_access_node(EvalType var_type, SymbolId identifier, std::uint16_t scope_index, std::uint16_t slot)
 {
-    return std::make_unique<ASTVariableAccess>(identifier, var_type, scope_index);
+    return arena.make<ASTVariableAccess>(identifier, var_type, scope_index, slot);
 }
 
-ASTPtr Parser::create_cast_node(EvalType eval_type, ASTPtr&& expr)
+ASTPtr Parser::create_cast_node(EvalType eval_type, ASTPtr expr)
 {
-    return std::make_unique<ASTCastNode>(eval_type, std::move(expr));
+    return arena.make<ASTCastNode>(eval_type, expr);
 }
 
-ASTPtr Parser::create_range_iter_node(ASTPtr&& start, ASTPtr&& stop, ASTPtr&& step, const std::string& iter_id, bool condition_or_construction)
+ASTPtr Parser::create_range_iter_node(ASTPtr start, ASTPtr stop, ASTPtr step, SymbolId iter_id, bool condition_or_construction)
 {
-    return std::make_unique<ASTRangeIterator>(std::move(start), std::move(stop), std::move(step), iter_id, condition_or_construction);
+    return arena.make<ASTRangeIterator>(start, stop, step, iter_id, condition_or_construction);
 }
 
-ASTPtr Parser::create_ellipsis_iter_node(EvalType ellipsis_type, const std::string& iter_id)
+ASTPtr Parser::create_ellipsis_iter_node(EvalType ellipsis_type, SymbolId iter_id)
 {
-    return std::make_unique<ASTEllipsisIterator>(ellipsis_type, iter_id);
+    return arena.make<ASTEllipsisIterator>(ellipsis_type, iter_id);
 }
 
-ASTPtr Parser::create_block_node(ListOfASTPtr&& statements)
+ASTPtr Parser::create_block_node(ListOfASTPtr statements)
 {
-    return std::make_unique<ASTBlock>(std::move(statements));
+    return arena.make<ASTBlock>(statements);
 }
 
-ASTPtr Parser::create_ternary_op_node(ASTPtr&& condition, ASTPtr&& true_expr, ASTPtr&& false_expr)
+ASTPtr Parser::create_ternary_op_node(ASTPtr condition, ASTPtr true_expr, ASTPtr false_expr)
 {
-    return std::make_unique<ASTTernaryOp>(std::move(condition), std::move(true_expr), std::move(false_expr)); 
+    return arena.make<ASTTernaryOp>(condition, true_expr, false_expr); 
 }
 
-ASTPtr Parser::create_if_node(ASTPtr&& if_cond, ASTPtr&& if_body, std::vector<std::pair<ASTPtr, ASTPtr>>&& elif_clauses, ASTPtr&& else_body)
+ASTPtr Parser::create_if_node(ASTPtr if_cond, ASTPtr if_body, ASTIfNode::ElifCondition elif_clauses, ASTPtr else_body)
 {
-    return std::make_unique<ASTIfNode>(std::move(if_cond), std::move(if_body), std::move(elif_clauses), std::move(else_body));
+    return arena.make<ASTIfNode>(if_cond, if_body, elif_clauses, else_body);
 }
 
-ASTPtr Parser::create_for_node(const std::string& id, ASTPtr&& range, ASTPtr&& for_body)
+ASTPtr Parser::create_for_node(SymbolId id, ASTPtr range, ASTPtr for_body, std::uint16_t scope_index, std::uint16_t slot)
 {
-    return std::make_unique<ASTForNode>(id, std::move(range), std::move(for_body));
+    return arena.make<ASTForNode>(id, range, for_body, scope_index, slot);
 }
 
-ASTPtr Parser::create_while_node(ASTPtr&& while_condition, ASTPtr&& while_body)
+ASTPtr Parser::create_while_node(ASTPtr while_condition, ASTPtr while_body)
 {
-    return std::make_unique<ASTWhileNode>(std::move(while_condition), std::move(while_body));
+    return arena.make<ASTWhileNode>(while_condition, while_body);
 }
 
-ASTPtr Parser::create_func_decl_node(EvalType return_type, const std::string& func_name,
-                                    FuncParams&& func_params, ASTPtr&& func_body, EvalType vargs_type)
+ASTPtr Parser::create_func_decl_node(EvalType return_type, SymbolId func_name,
+                                    FuncParams func_params, ASTPtr func_body, EvalType vargs_type)
 {
-    return std::make_unique<ASTFunctionDecl>(return_type, func_name, std::move(func_params), std::move(func_body), vargs_type);
+    //Calls refer to the declaration long after its body is gone (streaming), so it doesn't go into the statement arena
+    ASTFunctionDecl* func_node = persistent_arena.make<ASTFunctionDecl>(return_type, func_name, func_params, func_body, vargs_type);
+    if(streaming)
+        statement_functions.push_back(func_node);
+    return func_node;
 }
 
-ASTPtr Parser::create_func_call_node(FuncArgs&& func_args, ASTFunctionDecl* initial_func)
+ASTPtr Parser::create_func_call_node(FuncArgs func_args, ASTFunctionDecl* initial_func)
 {
-    return std::make_unique<ASTFunctionCall>(std::move(func_args), initial_func);
+    return arena.make<ASTFunctionCall>(func_args, initial_func);
 }
 
-ASTPtr Parser::create_builtin_func_call_node(std::uint8_t call_number, EvalType return_type, FuncArgs&& func_args, bool has_vargs)
+ASTPtr Parser::create_builtin_func_call_node(std::uint8_t call_number, EvalType return_type, FuncArgs func_args, bool has_vargs)
 {
-    return std::make_unique<ASTBuiltinFunctionCall>(call_number, return_type, std::move(func_args), has_vargs);
+    return arena.make<ASTBuiltinFunctionCall>(call_number, return_type, func_args, has_vargs);
 }
 
-ASTPtr Parser::create_continue_node(std::uint8_t continue_params, std::uint16_t scopes_to_destroy)
+ASTPtr Parser::create_continue_node(std::uint8_t continue_params)
 {
-    return std::make_unique<ASTContinue>(continue_params, scopes_to_destroy);
+    return arena.make<ASTContinue>(continue_params);
 }
 
-ASTPtr Parser::create_break_node(std::uint8_t break_params, std::uint16_t scopes_to_destroy)
+ASTPtr Parser::create_break_node(std::uint8_t break_params)
 {
-    return std::make_unique<ASTBreak>(break_params, scopes_to_destroy);
+    return arena.make<ASTBreak>(break_params);
 }
 
-ASTPtr Parser::create_return_node(ASTPtr&& return_expr)
+ASTPtr Parser::create_return_node(ASTPtr return_expr)
 {
-    return std::make_unique<ASTReturn>(std::move(return_expr));
+    return arena.make<ASTReturn>(return_expr);
 }
 
 //-----------------ACTUALLY Helper functions-----------------
+ListOfASTPtr Parser::finish_list(std::size_t list_start)
+{
+    //Everything pushed since 'list_start' belongs to the list, give the scratch space back for the parent list
+    auto list = arena.copyList(list_scratch.data() + list_start, list_scratch.size() - list_start);
+    list_scratch.resize(list_start);
+    return list;
+}
+
 void Parser::advance()
 {
     current_token = lex.get_token();
@@ -1049,66 +1214,128 @@ bool Parser::match_types(TokenType type)
 }
 
 //Scope management
-void Parser::set_value_to_top_frame(const std::string& id, const ASTPtr& expr, EvalType ttype)
+SymbolBinding* Parser::find_binding(SymbolId id)
 {
-    //Get the top most symbol table and 
-    temporary_symbol_table.back().emplace(id, std::make_pair(expr.get(), ttype));
+    if(id >= innermost_binding.size() || innermost_binding[id] == NO_BINDING)
+        return nullptr;
+    return &bindings[innermost_binding[id]];
 }
 
-void Parser::set_value_to_nth_frame(const std::string& id, const ASTPtr& expr, EvalType ttype)
+void Parser::set_value_to_top_frame(SymbolId id, const ASTPtr& expr, EvalType ttype, std::uint16_t slot)
 {
-    //Search for the value and set it
-    for (auto it = temporary_symbol_table.rbegin(); it != temporary_symbol_table.rend(); ++it) {
-        auto symbol = it->find(id);
-        if (symbol != it->end()) {
-            symbol->second = std::make_pair(expr.get(), ttype);
-            break;
-        }
-    }
+    //Already declared in this very scope, first declaration stays (same as emplace into a map would do)
+    if(find_id_from_current_scope(id))
+        return;
+
+    if(id >= innermost_binding.size())
+        innermost_binding.resize(id + 1, NO_BINDING);
+
+    //Shadow whatever the outer scopes had under this name, destroy_scope brings it back
+    std::uint16_t frame_depth = frame_sizes.size() - 1;
+    bindings.push_back(SymbolBinding{SymbolInfo{expr, ttype, slot, frame_depth}, id, innermost_binding[id]});
+    innermost_binding[id] = static_cast<std::uint32_t>(bindings.size() - 1);
+
+    if(streaming && scope_starts.size() == 1)
+        statement_bindings.push_back(innermost_binding[id]);
 }
 
-std::pair<EvalType, std::uint16_t> Parser::get_type_from_symbol_table(const std::string& id)
+void Parser::set_value_to_nth_frame(SymbolId id, const ASTPtr& expr, EvalType ttype)
 {
-    //Scope index is basically Vector index, but because we are using iterators, we do some stuff to get index
-    //This loop stuff is weird bruh, cant understand why loops sometimes don't work
-    for (auto it = temporary_symbol_table.rbegin(); it != temporary_symbol_table.rend(); ++it) {
-        auto symbol = it->find(id);
-        if (symbol != it->end()) {
-            return std::make_pair(symbol->second.second, std::distance(it, temporary_symbol_table.rend()) - 1);
-        }
+    //Slot stays the same, only the latest expression and type change
+    if(SymbolBinding* binding = find_binding(id)) {
+        binding->info.expr = expr;
+        binding->info.type = ttype;
+
+        //Global one, bindings below the first scope after the global one
+        std::uint32_t index = innermost_binding[id];
+        if(streaming && (scope_starts.size() == 1 || index < scope_starts[1]))
+            statement_bindings.push_back(index);
     }
-    return std::make_pair(EVAL_UNKNOWN, 0);
+}
+
+std::tuple<EvalType, std::uint16_t, std::uint16_t> Parser::get_type_from_symbol_table(SymbolId id)
+{
+    //Returns type, scope index (FrameType) and slot of the variable
+    SymbolBinding* binding = find_binding(id);
+    if(binding == nullptr)
+        return std::make_tuple(EVAL_UNKNOWN, 0, 0);
+
+    const SymbolInfo& info = binding->info;
+
+    //Functions and vargs marker don't live in any frame, global variables are visible from everywhere
+    if(info.slot == UINT16_MAX || info.frame_depth == 0)
+        return std::make_tuple(info.type, GLOBAL_FRAME, info.slot);
+
+    //Frame of the enclosing function is long gone (or is a different call) by the time inner function runs
+    if(info.frame_depth != frame_sizes.size() - 1)
+        printError("ParserError", "Variable '", symbol_name(id), "' belongs to an enclosing function and can't be accessed from a nested function");
+
+    return std::make_tuple(info.type, LOCAL_FRAME, info.slot);
 }
 
 //This variation is pretty much used for pre-evaluating expressions, and function calls
-ASTRawPtr Parser::get_expr_from_symbol_table(const std::string& id)
+ASTRawPtr Parser::get_expr_from_symbol_table(SymbolId id)
 {
-    for (auto it = temporary_symbol_table.rbegin(); it != temporary_symbol_table.rend(); ++it) {
-        auto symbol = it->find(id);
-        if (symbol != it->end()) {
-            return symbol->second.first;
-        }
-    }
+    if(SymbolBinding* binding = find_binding(id))
+        return binding->info.expr;
+
     //This can't/shouldn't really fail, as this is used after creation of tree
     printError("SymbolTableError", "Error getting 'expr' from symbol table");
 }
 
-bool Parser::find_id_from_current_scope(const std::string& identifier)
+bool Parser::find_id_from_current_scope(SymbolId identifier)
 {
-    auto symbol = temporary_symbol_table.back().find(identifier);
-    return symbol != temporary_symbol_table.back().end();    
+    //Bindings of the current scope are the ones pushed after it was created
+    return identifier < innermost_binding.size() && innermost_binding[identifier] != NO_BINDING
+           && innermost_binding[identifier] >= scope_starts.back();
 }
 
 void Parser::create_scope()
 {
     //Create and push a scope
-    temporary_symbol_table.emplace_back();    
+    scope_starts.push_back(static_cast<std::uint32_t>(bindings.size()));
 }
 
 void Parser::destroy_scope()
 {
-    //Pop the scope
-    temporary_symbol_table.pop_back();
+    //Pop the scope, every name declared in it goes back to what it was shadowing
+    while(bindings.size() > scope_starts.back())
+    {
+        innermost_binding[bindings.back().symbol] = bindings.back().shadowed;
+        bindings.pop_back();
+    }
+    scope_starts.pop_back();
+}
+
+std::string_view Parser::symbol_name(SymbolId id)
+{
+    return lex.get_symbol_name(id);
+}
+
+//Frame management, every block of a function shares the function frame, so slots are never reused
+std::uint16_t Parser::allocate_slot(SymbolId id)
+{
+    if(frame_sizes.back() == UINT16_MAX)
+        printError("ParserError", "Too many variables in a single function (or global scope), failed to allocate slot for '", symbol_name(id), '\'');
+    
+    return frame_sizes.back()++;
+}
+
+std::uint16_t Parser::current_scope_index()
+{
+    return frame_sizes.size() == 1 ? GLOBAL_FRAME : LOCAL_FRAME;
+}
+
+void Parser::create_frame()
+{
+    frame_sizes.emplace_back(0);
+}
+
+std::uint16_t Parser::destroy_frame()
+{
+    std::uint16_t frame_size = frame_sizes.back();
+    frame_sizes.pop_back();
+    return frame_size;
 }
 
 //------------------CT EVALUATOR------------------
@@ -1125,9 +1352,9 @@ constexpr RV Parser::pre_evaluate_tree(const ASTNode& node) {
             switch (value_node.type)
             {
                 case EVAL_INT:
-                    return std::stoll(value_node.value);
+                    return std::stoll(std::string{value_node.value});
                 case EVAL_FLOAT:
-                    return std::stod(value_node.value);
+                    return std::stod(std::string{value_node.value});
                 default:
                     printError("ParserError -> CompileTimeEvaluationError", "Invalid Evaluated type found for ValueNode");
             }
@@ -1202,7 +1429,10 @@ constexpr RV Parser::pre_evaluate_tree(const ASTNode& node) {
             const auto& var_access_node = static_cast<const ASTVariableAccess&>(node);
 
             //Temporary solution for now
+            //nullptr when streaming threw away an expression that couldn't be pre-evaluated anyways
             auto expr = get_expr_from_symbol_table(var_access_node.identifier);
+            if(expr == nullptr)
+                throw std::runtime_error("Err");
             return pre_evaluate_tree<RV>(*expr);
         }
         default:
@@ -1,17 +1,36 @@
 #ifndef UNNAMED_PARSER_HPP
 #define UNNAMED_PARSER_HPP
 
-#include <functional>
 #include <unordered_map>
 #include <vector>
+#include <algorithm>
 #include <cmath>
 
 #include "lexer.hpp"
+#include "trace.hpp"
 #include "ast.hpp"
 #include "common.hpp"
 
-using ParseFuncPtr = std::function<ASTPtr(void)>;
-using SymbolTable  = std::vector<std::unordered_map<std::string, std::pair<ASTRawPtr, EvalType>>>;
+//Everything parser knows about a name, slot is UINT16_MAX for stuff that doesn't live in a frame (functions, vargs marker)
+struct SymbolInfo
+{
+    ASTRawPtr     expr;
+    EvalType      type;
+    std::uint16_t slot;
+    std::uint16_t frame_depth; //0 = global frame, anything above is the function nesting level
+};
+
+#define NO_BINDING UINT32_MAX
+
+class ILGenerator;
+
+//One declaration of a name, declarations it shadows are chained through 'shadowed'
+struct SymbolBinding
+{
+    SymbolInfo    info;
+    SymbolId      symbol;
+    std::uint32_t shadowed; //Index in Parser::bindings, NO_BINDING if nothing was declared under this name before
+};
 
 //All the defines to be strictly used in Parser member functions
 //CBR is Continue/Break/Return Parameters, each statement handles stuff differently
@@ -26,28 +45,36 @@ using SymbolTable  = std::vector<std::unordered_map<std::string, std::pair<ASTRa
 
 #define RESTORE_RETURN_TYPE current_return_type = prev_return_type;
 
-//I could have put this code in create and destroy scope function but that would inc/dec this value for loops as well
-//Which i dont want. Also we only increment if the statement is in a loop, else we just dont;
-#define SCOPE_DEPTH_INC non_loops_scope_depth += CBR_PARAMS_CHECK_CONDITION(cbr_params, IS_LOOP);
-#define SCOPE_DEPTH_DEC non_loops_scope_depth -= CBR_PARAMS_CHECK_CONDITION(cbr_params, IS_LOOP);
-
 class Parser
 {
     public:
-        Parser(const std::string& text) 
-            : lex(text), current_token(lex.get_token())
+        //'pipelinedLexer' lexes on a thread of its own, only for parse() (see Lexer)
+        Parser(std::string&& text, bool pipelinedLexer = false)
+            : lex(std::move(text), pipelinedLexer), current_token(lex.get_token())
         {}
 
-        ListOfASTPtr& parse();
+        //Nodes stay valid as long as the Parser does
+        ListOfASTPtr parse();
+        //Streaming alternative to parse(), one top level statement at a time, nullptr once there are none left.
+        //Statement stays valid only until the next call, its nodes are freed then (function signatures are kept)
+        ASTPtr parseNext();
+        //Valid after parse() (or for whatever parseNext() went through), number of slots needed by global variables
+        std::uint16_t getGlobalFrameSize() const;
+        //Optimizations may add global variables of their own, parser has to hand out slots after those
+        void setGlobalFrameSize(std::uint16_t);
+        //Direct emission (-O0), one top level statement goes straight into 'ilgen' while its parsed, false once there
+        //are none left. No nodes are made for statements (only for expressions) and none of them outlive the call
+        bool emitNext(ILGenerator& ilgen);
+        //Names of every SymbolId in the tree
+        SymbolInterner& getSymbols() { return lex.get_symbols(); }
         
     private:
         ASTPtr parse_statement();
         ASTPtr parse_expr();
         ASTPtr parse_comp_expr();
         ASTPtr parse_arith_expr();
-        ASTPtr parse_term();
-        ASTPtr parse_unary();
-        ASTPtr parse_power();
+        ASTPtr parse_binary_expr(std::uint8_t);
+        ASTPtr parse_prefix_expr(std::uint8_t);
         ASTPtr parse_call();
         ASTPtr parse_atom();
     
@@ -58,62 +85,75 @@ class Parser
     
     private:
         ASTPtr parse_function_decl();
-        ASTPtr parse_function_call(const std::string&);
-        ASTPtr parse_builtin_function_call(const std::string&);
+        ASTPtr parse_function_call(SymbolId);
+        ASTPtr parse_builtin_function_call(SymbolId);
         ASTPtr parse_if_condition();
         ASTPtr parse_for_loop();
         ASTPtr parse_while_loop();
-        ASTPtr parse_iterator(const std::string&);
-        ASTPtr parse_range_iterator(const std::string&, bool);
-        ASTPtr parse_ellipsis_iterator(const std::string&);
+        ASTPtr parse_iterator(SymbolId);
+        ASTPtr parse_range_iterator(SymbolId, bool);
+        ASTPtr parse_ellipsis_iterator(SymbolId);
         ASTPtr parse_block(bool = false);
         ASTPtr parse_cast();
-        ASTPtr parse_variable(EvalType, bool, std::uint16_t);
-        ASTPtr parse_reassignment(EvalType, std::uint16_t);
-        ASTPtr parse_declaration(EvalType, std::uint16_t);
-        ASTPtr common_binary_op(ParseFuncPtr, TokenType, TokenType, ParseFuncPtr);
-        ASTPtr common_binary_op(ParseFuncPtr, std::size_t, ParseFuncPtr);
+        ASTPtr parse_variable(EvalType, bool, std::uint16_t, std::uint16_t);
+        ASTPtr parse_reassignment(EvalType, std::uint16_t, std::uint16_t);
+        ASTPtr parse_declaration(EvalType);
     
     private:
-        ASTPtr create_value_node(EvalType type, const std::string& token);
-        ASTPtr create_binary_op_node(TokenType, ASTPtr&&, ASTPtr&&);
-        ASTPtr create_unary_op_node(TokenType, ASTPtr&&);
-        ASTPtr create_variable_assign_node(EvalType, const std::string&, ASTPtr&&, bool, std::uint16_t);
-        ASTPtr create_variable_access_node(EvalType, const std::string&, std::uint16_t);
-        ASTPtr create_cast_node(EvalType, ASTPtr&&);
-        ASTPtr create_block_node(ListOfASTPtr&&);
-        ASTPtr create_ternary_op_node(ASTPtr&&, ASTPtr&&, ASTPtr&&);
-        ASTPtr create_if_node(ASTPtr&&, ASTPtr&&, std::vector<std::pair<ASTPtr, ASTPtr>>&&, ASTPtr&&);
-        ASTPtr create_range_iter_node(ASTPtr&&, ASTPtr&&, ASTPtr&&, const std::string&, bool);
-        ASTPtr create_ellipsis_iter_node(EvalType, const std::string&);
-        ASTPtr create_for_node(const std::string&, ASTPtr&&, ASTPtr&&);
-        ASTPtr create_while_node(ASTPtr&&, ASTPtr&&);
-        ASTPtr create_func_decl_node(EvalType, const std::string&, FuncParams&&, ASTPtr&&, EvalType);
-        ASTPtr create_func_call_node(FuncArgs&&, ASTFunctionDecl*);
-        ASTPtr create_builtin_func_call_node(std::uint8_t, EvalType, FuncArgs&&, bool);
-        ASTPtr create_continue_node(std::uint8_t, std::uint16_t);
-        ASTPtr create_break_node(std::uint8_t, std::uint16_t);
-        ASTPtr create_return_node(ASTPtr&&);
+        ASTPtr create_value_node(EvalType type, std::string_view token);
+        ASTPtr create_binary_op_node(TokenType, ASTPtr, ASTPtr);
+        ASTPtr create_unary_op_node(TokenType, ASTPtr);
+        ASTPtr create_variable_assign_node(EvalType, SymbolId, ASTPtr, bool, std::uint16_t, std::uint16_t);
+        ASTPtr create_variable_access_node(EvalType, SymbolId, std::uint16_t, std::uint16_t);
+        ASTPtr create_cast_node(EvalType, ASTPtr);
+        ASTPtr create_block_node(ListOfASTPtr);
+        ASTPtr create_ternary_op_node(ASTPtr, ASTPtr, ASTPtr);
+        ASTPtr create_if_node(ASTPtr, ASTPtr, ASTIfNode::ElifCondition, ASTPtr);
+        ASTPtr create_range_iter_node(ASTPtr, ASTPtr, ASTPtr, SymbolId, bool);
+        ASTPtr create_ellipsis_iter_node(EvalType, SymbolId);
+        ASTPtr create_for_node(SymbolId, ASTPtr, ASTPtr, std::uint16_t, std::uint16_t);
+        ASTPtr create_while_node(ASTPtr, ASTPtr);
+        ASTPtr create_func_decl_node(EvalType, SymbolId, FuncParams, ASTPtr, EvalType);
+        ASTPtr create_func_call_node(FuncArgs, ASTFunctionDecl*);
+        ASTPtr create_builtin_func_call_node(std::uint8_t, EvalType, FuncArgs, bool);
+        ASTPtr create_continue_node(std::uint8_t);
+        ASTPtr create_break_node(std::uint8_t);
+        ASTPtr create_return_node(ASTPtr);
 
     //Scope
     private:
-        void                               set_value_to_top_frame(const std::string&, const ASTPtr&, EvalType);
-        void                               set_value_to_nth_frame(const std::string&, const ASTPtr&, EvalType);
-        std::pair<EvalType, std::uint16_t> get_type_from_symbol_table(const std::string&);
-        ASTRawPtr                          get_expr_from_symbol_table(const std::string&);
-        bool                               find_id_from_current_scope(const std::string&);
-        void                               create_scope();
-        void                               destroy_scope();
+        void                                              set_value_to_top_frame(SymbolId, const ASTPtr&, EvalType, std::uint16_t = UINT16_MAX);
+        void                                              set_value_to_nth_frame(SymbolId, const ASTPtr&, EvalType);
+        std::tuple<EvalType, std::uint16_t, std::uint16_t> get_type_from_symbol_table(SymbolId);
+        ASTRawPtr                                         get_expr_from_symbol_table(SymbolId);
+        bool                                              find_id_from_current_scope(SymbolId);
+        void                                              create_scope();
+        void                                              destroy_scope();
+        SymbolBinding*                                    find_binding(SymbolId);
+        std::string_view                                  symbol_name(SymbolId);
+    
+    //Frames (block scopes are flattened into the function / global frame)
+    private:
+        std::uint16_t allocate_slot(SymbolId);
+        std::uint16_t current_scope_index();
+        void          create_frame();
+        std::uint16_t destroy_frame();
 
     //Compile time Evaluator
     private:
         template<typename RV>
         constexpr RV pre_evaluate_tree(const ASTNode&);
 
+    //Streaming
     private:
-        void  advance();
-        Token peek();
-        bool  match_types(TokenType);
+        void   release_statement();
+        ASTPtr persist_constant_expr(ASTPtr);
+
+    private:
+        ListOfASTPtr finish_list(std::size_t);
+        void         advance();
+        Token        peek();
+        bool         match_types(TokenType);
 
     private:
         Lexer  lex;
@@ -121,13 +161,34 @@ class Parser
 
         //For (CBR) Continue, Break, Return / Functions / etc.
         std::uint8_t  cbr_params = 0;
-        std::uint16_t non_loops_scope_depth = 0;
         EvalType      current_return_type = EVAL_VOID;
-
+        //Function whose body is being parsed right now, only calls to it can become tail calls
+        ASTFunctionDecl* current_function = nullptr;
+        //Set only for direct emission, statements are generated the moment they are parsed and parse_* return nullptr
+        //for If / For / While / Func (and blocks) since there's nothing left to do with them
+        ILGenerator*     emitter = nullptr;
+
+        //Every node of the compilation unit, freed all at once with the Parser (or with each statement, see parseNext)
+        ASTArena arena;
+        //Whatever has to outlive the statement it was parsed in: function declarations (calls refer to them)
+        //and expressions of global variables that can be pre-evaluated
+        ASTArena persistent_arena;
+        //Streaming, global bindings whose expression was set and functions declared by the statement parsed last
+        bool                          streaming = false;
+        std::vector<std::uint32_t>    statement_bindings;
+        std::vector<ASTFunctionDecl*> statement_functions;
         //Maybe the real statements were the friends we parsed along the way
-        ListOfASTPtr statements;
-        //Temporary symbol table for variables, stack based scoping mechanism, initialize it with global table
-        SymbolTable  temporary_symbol_table = {{}};
+        std::vector<ASTPtr> statements;
+        //Elements of the lists being parsed right now, nested lists stack on top of their parent's elements
+        std::vector<ASTPtr> list_scratch;
+        //Symbol table for variables, flat instead of a map per scope. Every declaration is pushed on 'bindings',
+        //'innermost_binding' is indexed by SymbolId and says which of them a name refers to right now.
+        //'scope_starts' is the scope stack, size of 'bindings' when each scope was created (first one is global)
+        std::vector<SymbolBinding> bindings;
+        std::vector<std::uint32_t> innermost_binding;
+        std::vector<std::uint32_t> scope_starts = {0};
+        //Number of slots handed out so far in each frame, first one is the global frame
+        std::vector<std::uint16_t> frame_sizes = {0};
 
         //Token type to Eval type converter
         const std::unordered_map<TokenType, EvalType> token_to_eval_type = {
@@ -140,15 +201,16 @@ class Parser
         };
 
         //Maps builtin types to their call number, number of arguments they take (uint64 max meaning they take vargs) and return type
-        const std::unordered_map<std::string, std::tuple<std::uint8_t, std::size_t, EvalType>> builtinMap = {
+        //Names are predefined symbols (see symbol_interner.hpp), every lexer interns them up front
+        const std::unordered_map<SymbolId, std::tuple<std::uint8_t, std::size_t, EvalType>> builtinMap = {
             //IO
-            {"__VMInternals_WriteToConsole__",     std::make_tuple(BUILTIN_WRITE_CONSOLE, UINT64_MAX, EVAL_VOID )},
-            {"__VMInternals_ReadIntFromConsole__", std::make_tuple(BUILTIN_IREAD_CONSOLE, 0,          EVAL_INT  )},
+            {SYMBOL_WRITE_CONSOLE, std::make_tuple(BUILTIN_WRITE_CONSOLE, UINT64_MAX, EVAL_VOID )},
+            {SYMBOL_IREAD_CONSOLE, std::make_tuple(BUILTIN_IREAD_CONSOLE, 0,          EVAL_INT  )},
             //MATH
-            {"__VMInternals_Sqrt__",               std::make_tuple(BUILTIN_SQRT,          1,          EVAL_FLOAT)},
-            {"__VMInternals_Gamma__",              std::make_tuple(BUILTIN_GAMMA,         1,          EVAL_FLOAT)},
+            {SYMBOL_SQRT,          std::make_tuple(BUILTIN_SQRT,          1,          EVAL_FLOAT)},
+            {SYMBOL_GAMMA,         std::make_tuple(BUILTIN_GAMMA,         1,          EVAL_FLOAT)},
             //TIME
-            {"__VMInternals_GetCurrentTime__",     std::make_tuple(BUILTIN_GETTIME,       0,          EVAL_INT)},
+            {SYMBOL_GETTIME,       std::make_tuple(BUILTIN_GETTIME,       0,          EVAL_INT)},
         };
 };
 
@@ -1,100 +1,285 @@
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <mutex>
+
 #include "preprocessor.hpp"
+#include "trace.hpp"
+#include "..\Common\error_printer.hpp"
+
+namespace fs = std::filesystem;
 
-void Preprocessor::preprocessInternal(std::string&& sourceCode)
+//Defines only modules read so far (by absolute path), good as long as neither the source nor the .fluxm changed.
+//Modules they include have entries of their own, checked every time they are included through this one.
+//Shared by units compiled in parallel (-j) and by every request a compile server forks (see compile_server.hpp)
+struct LoadedModule
 {
-    std::string line;
-    std::istringstream source{std::move(sourceCode)};
-    std::unordered_set<std::string> preprocessedFiles;
+    bool               hasSource;
+    fs::file_time_type sourceTime;
+    fs::file_time_type moduleTime;
+    ModuleContents     contents;
+};
+static std::mutex                                    loadedModulesMutex;
+static std::unordered_map<std::string, LoadedModule> loadedModules;
+static std::vector<std::string>                      newlyLoadedModules;
 
-    while (std::getline(source, line))
+//-----------------HELPER FUNCTIONS-----------------
+//Anything other than whitespace and comments
+static bool hasCode(const std::string& text)
+{
+    for (std::size_t i = 0; i < text.size(); ++i)
     {
-        if(line.empty())
-        {
-            output << '\n';
+        if(std::isspace(static_cast<unsigned char>(text[i])))
             continue;
+
+        if(text.compare(i, 2, "//") == 0) {
+            i = text.find('\n', i);
+            if(i == std::string::npos)
+                return false;
         }
+        else if(text.compare(i, 2, "/*") == 0) {
+            i = text.find("*/", i + 2);
+            if(i == std::string::npos)
+                return false;
+            ++i;
+        }
+        else
+            return true;
+    }
+    return false;
+}
 
-        if(line.compare(0, 7, "include") == 0)
-        {
-            std::string filePath = line.substr(8);
-            
-            //Remove whitespace
-            filePath.erase(std::remove_if(filePath.begin(), filePath.end(), ::isspace), filePath.end());
+static bool readFile(const std::string& path, std::string& out)
+{
+    std::ifstream file{path, std::ios_base::binary};
+    if(!file)
+        return false;
+
+    std::ostringstream buffer;
+    buffer << file.rdbuf();
+    out = buffer.str();
+    return true;
+}
 
-            //Replace all '.' with '/'
-            std::replace(filePath.begin(), filePath.end(), '.', '/');
+//'define KEY VALUE' line without 'define', false if there is no value
+static bool splitDefine(std::string_view rest, std::string_view& key, std::string_view& value)
+{
+    std::size_t keyStart = rest.find_first_not_of(' ');
+    std::size_t keyEnd   = keyStart == std::string_view::npos ? keyStart : rest.find(' ', keyStart);
+    if(keyEnd == std::string_view::npos)
+        return false;
 
-            //Manually add .flux extension at the end
-            filePath.append(".flux");
+    key   = rest.substr(keyStart, keyEnd - keyStart);
+    value = rest.substr(keyEnd + 1);
+    if(!value.empty() && value.back() == '\r')
+        value.remove_suffix(1);
+    return true;
+}
 
-            //If the file already exists, ignore it
-            if(preprocessedFiles.find(filePath) != preprocessedFiles.end())
-                continue;
-            
-            preprocessedFiles.insert(filePath);
-            //Open file and read its content to preprocess
-            std::ifstream file{filePath};
-            if(!file) {
-                std::cout << "PreprocessorError: " << "File not found for 'include' directive: " << filePath << '\n';
-                std::exit(1);
-            }
-
-            std::ostringstream buffer;
-            buffer << file.rdbuf();
-
-            preprocessInternal(std::move(buffer.str()));
-            output << '\n';
-        }
+//Defines and includes of a module made of nothing but those and comments, false if there is any code in it.
+//Whether the included modules are defines only too is only known once they are included
+static bool scanModule(const std::string& source, ModuleContents& contents)
+{
+    std::istringstream lines{source};
+    std::string        line, rest;
+
+    while(std::getline(lines, line))
+    {
+        if(line.compare(0, 7, "include") == 0)
+            contents.includes.push_back(includePathToFile(std::string_view{line}.substr(7)));
         else if(line.compare(0, 6, "define") == 0)
         {
-            std::size_t keyStart = 7; //position after "define "
-            std::size_t keyEnd   = line.find(' ', keyStart);
-            
-            if(keyEnd == std::string::npos)
-            {
-                std::cout << "PreprocessorError: " << "Expected key identifier after 'define'" << '\n';
-                std::exit(1);
-            }
-
-            std::string key{line.data() + keyStart, keyEnd - keyStart};
-            std::string value{line.data() + keyEnd + 1};
-
-            macros[std::move(key)] = std::move(value);
+            std::string_view key, value;
+            if(!splitDefine(std::string_view{line}.substr(6), key, value))
+                return false;
+            contents.defines[std::string{key}] = std::string{value};
         }
         else
-            processLine(line);
+            rest.append(line).push_back('\n');
+    }
+
+    return !hasCode(rest);
+}
+
+std::string includePathToFile(std::string_view modulePath)
+{
+    std::string filePath;
+    //Remove whitespace, replace all '.' with '/'
+    for (char c : modulePath)
+        if(!std::isspace(static_cast<unsigned char>(c)))
+            filePath.push_back(c == '.' ? '/' : c);
+
+    //Manually add .flux extension at the end
+    filePath.append(".flux");
+    return filePath;
+}
+
+//-----------------
+void Preprocessor::addDefine(SymbolId key, std::string_view value)
+{
+    std::string& body = macroBodies.emplace_back(value);
+    body.append(LEXER_TEXT_PADDING, '\0');
+
+    if(key >= macros.size())
+        macros.resize(key + 1, nullptr);
+    macros[key] = &body;
+}
+
+const std::string* Preprocessor::include(std::string_view modulePath)
+{
+    std::string filePath = includePathToFile(modulePath);
+
+    //If the file was already included, ignore it
+    if(!includedFiles.insert(filePath).second) {
+        FLUX_TRACE(TRACE_LEX, TRACE_SUMMARY, "include " << filePath << ": already included");
+        return nullptr;
+    }
+
+    //Defines only module, nothing to lex
+    ModuleDefines defines;
+    if(includeDefinesOnly(filePath, defines)) {
+        FLUX_TRACE(TRACE_LEX, TRACE_SUMMARY, "include " << filePath << ": " << defines.size() << " defines only");
+        for (auto &&[key, value] : defines)
+            addDefine(symbols.intern(key), value);
+        return nullptr;
     }
+    FLUX_TRACE(TRACE_LEX, TRACE_SUMMARY, "include " << filePath);
+
+    auto& text = loadedFiles.emplace_back(std::make_unique<std::string>());
+    if(!readFile(filePath, *text))
+        printError("PreprocessorError", "File not found for 'include' directive: ", filePath);
+
+    text->append(LEXER_TEXT_PADDING, '\0');
+    return text.get();
+}
+
+//Modules being included on this thread right now, modules are precompiled on several threads at once (-j)
+static thread_local std::unordered_set<std::string> modulesInProgress;
+
+bool Preprocessor::includeDefinesOnly(const std::string& sourcePath, ModuleDefines& defines)
+{
+    std::error_code ec;
+    std::string     absolutePath = fs::absolute(sourcePath, ec).lexically_normal().string();
+
+    //Module including itself (through others or not) is left to the lexer, which includes every file only once
+    if(!modulesInProgress.insert(absolutePath).second)
+        return false;
+
+    //Same order as lexing it would give, except a module's own defines always win over the ones it includes
+    ModuleContents contents;
+    bool           definesOnly = loadModuleContents(sourcePath, absolutePath, contents);
+    for (std::size_t i = 0; definesOnly && i < contents.includes.size(); ++i)
+        definesOnly = includeDefinesOnly(contents.includes[i], defines);
+    modulesInProgress.erase(absolutePath);
+    if(!definesOnly)
+        return false;
+
+    for (auto &&[key, value] : contents.defines)
+        defines[key] = value;
+    return true;
 }
 
-void Preprocessor::processLine(std::string& line)
+bool Preprocessor::loadModuleContents(const std::string& sourcePath, const std::string& absolutePath, ModuleContents& contents)
 {
-    std::size_t i = 0, n = line.size();
+    //Flux/IO.flux -> Flux/IO.fluxm
+    std::string     modulePath = sourcePath + 'm';
+    std::error_code ec;
+
+    //Missing files get the minimum time, so a module that still isn't there matches too
+    bool               hasSource  = fs::exists(sourcePath, ec);
+    fs::file_time_type sourceTime = hasSource ? fs::last_write_time(sourcePath, ec) : fs::file_time_type::min();
+    fs::file_time_type moduleTime = fs::last_write_time(modulePath, ec);
+    if(ec)
+        moduleTime = fs::file_time_type::min();
 
-    while(i < n)
     {
-        //Identifiers
-        if(std::isalnum(line[i]) || line[i] == '_')
+        std::lock_guard<std::mutex> lock{loadedModulesMutex};
+        auto loaded = loadedModules.find(absolutePath);
+        if(loaded != loadedModules.end() && loaded->second.hasSource == hasSource &&
+           loaded->second.sourceTime == sourceTime && loaded->second.moduleTime == moduleTime)
         {
-            //Start of the word
-            std::size_t start = i;
-
-            while (i < n && (std::isalnum(line[i]) || line[i] == '_'))
-                ++i;
-            
-            std::string word{line.data() + start, i - start};
-
-            // Check if the word is a macro
-            auto it = macros.find(word);
-            if (it != macros.end())
-                output << it->second;
-            else
-                output << word;
+            contents = loaded->second.contents;
+            return true;
         }
-        //Any other punctuation
-        else {
-            output << line[i];
-            ++i;
+    }
+
+    //Precompiled module is used as long as its not older than its source (or only the module exists)
+    bool usable = moduleTime != fs::file_time_type::min() && (!hasSource || moduleTime >= sourceTime) &&
+                  readModuleFile(modulePath, contents);
+    if(!usable)
+    {
+        std::string source;
+        contents = ModuleContents{};
+        if(!hasSource || !readFile(sourcePath, source) || !scanModule(source, contents))
+            return false;
+
+        //Can't write next to the source (read only install or whatever), it'll just be scanned again next time
+        writeModuleFile(modulePath, contents);
+        moduleTime = fs::last_write_time(modulePath, ec);
+        if(ec)
+            moduleTime = fs::file_time_type::min();
+    }
+
+    std::lock_guard<std::mutex> lock{loadedModulesMutex};
+    if(loadedModules.insert_or_assign(absolutePath, LoadedModule{hasSource, sourceTime, moduleTime, contents}).second)
+        newlyLoadedModules.push_back(absolutePath);
+    return true;
+}
+
+std::string Preprocessor::collectDependencies(const std::string& source)
+{
+    std::string                     dependencies;
+    std::unordered_set<std::string> visited;
+    std::vector<std::string>        pending = {source};
+
+    while(!pending.empty())
+    {
+        std::string text = std::move(pending.back());
+        pending.pop_back();
+
+        for (auto &&filePath : findIncludes(text))
+        {
+            if(!visited.insert(filePath).second)
+                continue;
+
+            std::string contents;
+            if(!readFile(filePath, contents))
+                readFile(filePath + 'm', contents);
+
+            dependencies.append(filePath).push_back('\0');
+            dependencies.append(contents).push_back('\0');
+            pending.push_back(std::move(contents));
         }
     }
-    output << '\n';
+    return dependencies;
+}
+
+std::vector<std::string> Preprocessor::findIncludes(const std::string& source)
+{
+    std::vector<std::string> includes;
+    std::istringstream       lines{source};
+    std::string              line;
+
+    //Every 'include' line counts, even one that ends up commented out, worst case is a cache miss / an extra dependency
+    while(std::getline(lines, line))
+        if(line.compare(0, 7, "include") == 0)
+            includes.push_back(includePathToFile(std::string_view{line}.substr(7)));
+
+    return includes;
+}
+
+void Preprocessor::precompileModule(const std::string& filePath)
+{
+    //Defines are thrown away, only the .fluxm written on the way (and what is kept in memory) matters
+    ModuleDefines defines;
+    includeDefinesOnly(filePath, defines);
+}
+
+std::vector<std::string> Preprocessor::takeNewlyLoadedModules()
+{
+    std::vector<std::string>    taken;
+    std::lock_guard<std::mutex> lock{loadedModulesMutex};
+    taken.swap(newlyLoadedModules);
+    return taken;
 }
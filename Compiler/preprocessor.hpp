@@ -1,36 +1,70 @@
+/* Directives and macros for the Lexer, which handles them at the token level while lexing:
+ *  - 'define KEY VALUE' at the start of a line adds a macro, identifiers matching KEY are lexed from VALUE instead
+ *  - 'include A.B' at the start of a line loads A/B.flux, either its precompiled defines (see module_file.hpp)
+ *    or its text, which Lexer stacks on top of the current input
+ * Nothing is ever copied into one big preprocessed source.
+*/
 #ifndef UNNAMED_PREPROCESSOR_HPP
 #define UNNAMED_PREPROCESSOR_HPP
 
-#include <sstream>
 #include <string>
-#include <fstream>
+#include <string_view>
+#include <deque>
+#include <memory>
+#include <vector>
 #include <unordered_map>
 #include <unordered_set>
-#include <algorithm>
 
-#include "..\Common\error_printer.hpp"
+#include "module_file.hpp"
+#include "symbol_interner.hpp"
+
+//Bytes of '\0' after the end of every lexer input (source, included file, macro body), so 16 byte wide scans never read past it
+#define LEXER_TEXT_PADDING 16
 
 class Preprocessor
 {
 public:
-    Preprocessor(std::string&& source)
-    {
-        output.str().reserve(source.size());
-        preprocessInternal(std::move(source));
-    }
+    //Macro names are interned into the same 'symbols' as the identifiers Lexer looks them up with
+    explicit Preprocessor(SymbolInterner& symbols)
+        : symbols(symbols)
+    {}
+
+    //Macro body, '\0' padded so Lexer can scan it like any other input. nullptr if 'name' is not a macro
+    const std::string* findMacro(SymbolId name) const { return name < macros.size() ? macros[name] : nullptr; }
+    void               addDefine(SymbolId key, std::string_view value);
+
+    //Text of included file ('\0' padded) to be lexed next, nullptr if there is nothing to lex
+    //(already included, or only defines which are added right away)
+    const std::string* include(std::string_view modulePath);
 
-    std::string preprocess()
-    {
-        return output.str();
-    }
+    //Contents of every file 'source' includes (transitively), for the compile cache key
+    static std::string collectDependencies(const std::string& source);
+    //Files 'source' includes directly, in the order they are included
+    static std::vector<std::string> findIncludes(const std::string& source);
+    //Brings the .fluxm of 'filePath' (and of the modules it includes) up to date if its a defines only module,
+    //nothing happens otherwise
+    static void precompileModule(const std::string& filePath);
+    //Absolute paths of defines only modules read from disk since the last call (they are kept in memory from then on)
+    static std::vector<std::string> takeNewlyLoadedModules();
 
 private:
-    void preprocessInternal(std::string&&);
-    void processLine(std::string&);
+    static bool includeDefinesOnly(const std::string&, ModuleDefines&);
+    static bool loadModuleContents(const std::string&, const std::string&, ModuleContents&);
 
 private:
-    std::ostringstream output;
-    std::unordered_map<std::string, std::string> macros;
+    SymbolInterner& symbols;
+
+    //Indexed by SymbolId of the name, nullptr if its not a macro. Redefined macro gets a new body,
+    //old one stays alive as tokens might still point into it
+    std::vector<const std::string*> macros;
+    std::deque<std::string>         macroBodies;
+
+    std::unordered_set<std::string> includedFiles;
+    //Tokens point into these till the very end of compilation
+    std::vector<std::unique_ptr<std::string>> loadedFiles;
 };
 
-#endif
\ No newline at end of file
+//'include A.B' -> A/B.flux
+std::string includePathToFile(std::string_view);
+
+#endif
@@ -0,0 +1,61 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <system_error>
+#include <thread>
+
+#ifdef _WIN32
+    #include <process.h>
+    #define getProcessId _getpid
+#else
+    #include <unistd.h>
+    #define getProcessId ::getpid
+#endif
+
+#include "replace_file.hpp"
+
+namespace fs = std::filesystem;
+
+std::string temporaryPathFor(const std::string& path)
+{
+    static std::atomic<unsigned int> counter{0};
+
+    std::size_t writer = std::hash<std::thread::id>{}(std::this_thread::get_id()) ^
+                         static_cast<std::size_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+
+    char suffix[64];
+    std::snprintf(suffix, sizeof(suffix), ".%x.%zx.%x.tmp", static_cast<unsigned int>(getProcessId()), writer, counter++);
+    return path + suffix;
+}
+
+bool replaceFile(const std::string& temporaryPath, const std::string& path)
+{
+    //Unlike std::rename this replaces an existing file on Windows as well
+    std::error_code ec;
+    fs::rename(temporaryPath, path, ec);
+    if(!ec)
+        return true;
+
+    fs::remove(temporaryPath, ec);
+    return false;
+}
+
+bool replaceFileContents(const std::string& path, const void* data, std::size_t size)
+{
+    std::string temporaryPath = temporaryPathFor(path);
+    std::FILE*  file          = std::fopen(temporaryPath.c_str(), "wb");
+    if(file == nullptr)
+        return false;
+
+    //Whole file goes in one piece, nothing to gain from copying it through a buffer first
+    std::setvbuf(file, nullptr, _IONBF, 0);
+    bool written = std::fwrite(data, 1, size, file) == size;
+    written      = std::fclose(file) == 0 && written;
+    if(!written) {
+        std::remove(temporaryPath.c_str());
+        return false;
+    }
+    return replaceFile(temporaryPath, path);
+}
@@ -0,0 +1,18 @@
+/* Files something else may be reading right now (an interpreter running the .cflx it mapped, other compilers sharing
+ * a cache or a .fluxm) are never rewritten in place. New contents go to a temporary file next to the old one, which is
+ * then renamed over it, readers see either the old file or the new one and never lose pages they have mapped.
+*/
+#ifndef UNNAMED_REPLACE_FILE_HPP
+#define UNNAMED_REPLACE_FILE_HPP
+
+#include <cstddef>
+#include <string>
+
+//Next to 'path', unique per process, thread and call so writers of the same file never share one
+std::string temporaryPathFor(const std::string& path);
+//Renames 'temporaryPath' over 'path' (replacing it on Windows too), the temporary file is removed if that fails
+bool replaceFile(const std::string& temporaryPath, const std::string& path);
+//Writes 'data' to a temporary file in one go and renames it over 'path'
+bool replaceFileContents(const std::string& path, const void* data, std::size_t size);
+
+#endif
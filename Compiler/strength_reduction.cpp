@@ -0,0 +1,320 @@
+#include "strength_reduction.hpp"
+
+//---------------HELPER FUNCTIONS---------------
+//Same order as ASTReduction, for --trace=opt
+static constexpr const char* reductionNames[] = {"None", "Square", "MulChain", "IntPow", "MulPow2", "DivPow2", "ModPow2", "InductionVar"};
+
+//Only plain Int literals count as constants, anything else might have side effects or an unknown value
+static bool getIntConstant(const ASTPtr& node, std::int64_t& out)
+{
+    if(node->getTag() != ASTTag::Value)
+        return false;
+
+    const auto& value_node = static_cast<const ASTValue&>(*node);
+    if(value_node.type != EVAL_INT)
+        return false;
+
+    out = std::stoll(std::string{value_node.value});
+    return true;
+}
+
+//Returns N if value is 2^N (N >= 1), else 0
+static std::int64_t getPowerOfTwoShift(std::int64_t value)
+{
+    if(value < 2 || (value & (value - 1)) != 0)
+        return 0;
+
+    std::int64_t shift = 0;
+    while((value >>= 1) != 0)
+        ++shift;
+
+    return shift;
+}
+
+//---------------STRENGTH REDUCTION---------------
+void StrengthReducer::reduce(ListOfASTPtr& ast, std::uint16_t& global_frame_size)
+{
+    current_frame_size = &global_frame_size;
+
+    for (auto &&statement : ast)
+        statement->accept(*this, false);
+}
+
+void StrengthReducer::reduceArithmetic(ASTBinaryOp& node)
+{
+    std::int64_t constant;
+
+    switch (node.op_type)
+    {
+        case TOKEN_POW:
+        {
+            EvalType base_type = node.left->evaluateExprType();
+
+            if(getIntConstant(node.right, constant))
+            {
+                //x ^ 2 is exact for Float as well, x * x rounds exactly the same way
+                if(constant == 2 && (base_type == EVAL_INT || base_type == EVAL_FLOAT)) {
+                    node.reduction = ASTReduction::Square;
+                    return;
+                }
+                //Longer chains round differently than 'pow' for Float, so only Int
+                if(constant >= 1 && constant <= MAX_POW_MUL_CHAIN && base_type == EVAL_INT) {
+                    node.reduction         = ASTReduction::MulChain;
+                    node.reduction_operand = constant;
+                    return;
+                }
+            }
+            //Both sides are Int, exponentiation by squaring instead of 'std::pow'
+            if(base_type == EVAL_INT && node.right->evaluateExprType() == EVAL_INT)
+                node.reduction = ASTReduction::IntPow;
+        }
+        break;
+
+        case TOKEN_MULT:
+        {
+            //Constant on the left side (8 * x), multiplication commutes and the constant has no side effects
+            if(getIntConstant(node.left, constant) && !getIntConstant(node.right, constant))
+                std::swap(node.left, node.right);
+
+            if(node.left->evaluateExprType() != EVAL_INT || !getIntConstant(node.right, constant))
+                return;
+
+            if(std::int64_t shift = getPowerOfTwoShift(constant)) {
+                node.reduction         = ASTReduction::MulPow2;
+                node.reduction_operand = shift;
+            }
+        }
+        break;
+
+        case TOKEN_DIV:
+        case TOKEN_MODULO:
+        {
+            if(node.left->evaluateExprType() != EVAL_INT || !getIntConstant(node.right, constant))
+                return;
+
+            if(std::int64_t shift = getPowerOfTwoShift(constant)) {
+                node.reduction         = node.op_type == TOKEN_DIV ? ASTReduction::DivPow2 : ASTReduction::ModPow2;
+                node.reduction_operand = shift;
+            }
+        }
+        break;
+
+        //Nothing cheaper for the rest
+        default:
+            break;
+    }
+}
+
+void StrengthReducer::collectInductionCandidate(ASTBinaryOp& node)
+{
+    if(node.op_type != TOKEN_MULT || active_loops.empty())
+        return;
+
+    //reduceArithmetic already moved constants to the right side
+    std::int64_t constant;
+    if(node.left->getTag() != ASTTag::VarAccess || !getIntConstant(node.right, constant))
+        return;
+
+    const auto& var_access_node = static_cast<const ASTVariableAccess&>(*node.left);
+
+    //Innermost loop owning this identifier, shadowing variables live in a different slot
+    for (auto it = active_loops.rbegin(); it != active_loops.rend(); ++it)
+    {
+        if(it->node->slot == var_access_node.slot && it->node->scope_index == var_access_node.scope_index) {
+            it->candidates[constant].push_back(&node);
+            return;
+        }
+    }
+}
+
+void StrengthReducer::visit(ASTValue&, bool)
+{}
+
+void StrengthReducer::visit(ASTBinaryOp& binary_op_node, bool)
+{
+    binary_op_node.left->accept(*this, true);
+    binary_op_node.right->accept(*this, true);
+
+    reduceArithmetic(binary_op_node);
+    collectInductionCandidate(binary_op_node);
+
+    if(binary_op_node.reduction != ASTReduction::None)
+        FLUX_TRACE(TRACE_OPT, TRACE_SUMMARY, reductionNames[static_cast<int>(binary_op_node.reduction)] << ' ' << binary_op_node.reduction_operand);
+}
+
+void StrengthReducer::visit(ASTUnaryOp& unary_op_node, bool)
+{
+    unary_op_node.expr->accept(*this, true);
+}
+
+void StrengthReducer::visit(ASTVariableAssign& var_assign_node, bool)
+{
+    var_assign_node.expr->accept(*this, true);
+
+    if(!var_assign_node.is_reassignment)
+        return;
+
+    //Loop identifier reassigned inside of the body, 'i * C' is no longer a linear function of the iteration
+    for (auto &&loop : active_loops)
+        if(loop.node->slot == var_assign_node.slot && loop.node->scope_index == var_assign_node.scope_index)
+            loop.id_modified = true;
+}
+
+void StrengthReducer::visit(ASTVariableAccess&, bool)
+{}
+
+void StrengthReducer::visit(ASTCastNode& cast_node, bool)
+{
+    cast_node.eval_expr->accept(*this, true);
+}
+
+void StrengthReducer::visit(ASTBlock& block_node, bool is_sub_expr)
+{
+    for (auto &&statement : block_node.getStatements())
+        statement->accept(*this, is_sub_expr);
+}
+
+void StrengthReducer::visit(ASTRangeIterator& range_iter_node, bool)
+{
+    range_iter_node.start->accept(*this, true);
+    range_iter_node.stop->accept(*this, true);
+
+    if(range_iter_node.step != nullptr)
+        range_iter_node.step->accept(*this, true);
+}
+
+void StrengthReducer::visit(ASTEllipsisIterator&, bool)
+{}
+
+void StrengthReducer::visit(ASTTernaryOp& ternary_node, bool)
+{
+    ternary_node.condition->accept(*this, true);
+    ternary_node.true_expr->accept(*this, true);
+    ternary_node.false_expr->accept(*this, true);
+}
+
+void StrengthReducer::visit(ASTIfNode& if_node, bool is_sub_expr)
+{
+    if_node.if_condition->accept(*this, true);
+    if_node.if_body->accept(*this, is_sub_expr);
+
+    for (auto &&[elif_condition, elif_body] : if_node.elif_clauses)
+    {
+        elif_condition->accept(*this, true);
+        elif_body->accept(*this, is_sub_expr);
+    }
+
+    if(if_node.else_body != nullptr)
+        if_node.else_body->accept(*this, is_sub_expr);
+}
+
+void StrengthReducer::visit(ASTForNode& for_node, bool is_sub_expr)
+{
+    //Range is evaluated once before the loop, its not part of the loop body
+    for_node.range->accept(*this, true);
+
+    //Only Int ranges with constant start and step (parser pre-evaluates them whenever it can).
+    //Without a step its 1 or -1 depending on which way the range goes (see ITER_RECALC_STEP), so stop has to be known too
+    std::int64_t start, stop, step;
+    auto range_iter_node = dynamic_cast<ASTRangeIterator*>(for_node.range);
+
+    bool is_linear = range_iter_node != nullptr && getIntConstant(range_iter_node->start, start);
+    if(is_linear && range_iter_node->step != nullptr)
+        is_linear = getIntConstant(range_iter_node->step, step);
+    else if(is_linear) {
+        is_linear = getIntConstant(range_iter_node->stop, stop);
+        step      = start < stop ? 1 : -1;
+    }
+
+    if(!is_linear) {
+        for_node.for_body->accept(*this, is_sub_expr);
+        return;
+    }
+
+    active_loops.push_back(LoopInfo{&for_node, start, step, false, {}});
+    for_node.for_body->accept(*this, is_sub_expr);
+
+    LoopInfo loop = std::move(active_loops.back());
+    active_loops.pop_back();
+
+    if(loop.id_modified)
+        return;
+
+    for (auto &&[constant, uses] : loop.candidates)
+    {
+        //No free slot left in this frame, just leave the multiplications as they are
+        if(uses.size() < MIN_INDUCTION_VAR_USES || *current_frame_size == UINT16_MAX)
+            continue;
+
+        //Unsigned math so overflow wraps around exactly like the runtime MUL/ADD would
+        auto wrapping_mul = [](std::int64_t a, std::int64_t b) {
+            return static_cast<std::int64_t>(static_cast<std::uint64_t>(a) * static_cast<std::uint64_t>(b));
+        };
+        auto wrapping_sub = [](std::int64_t a, std::int64_t b) {
+            return static_cast<std::int64_t>(static_cast<std::uint64_t>(a) - static_cast<std::uint64_t>(b));
+        };
+
+        auto induction_var = std::make_unique<InductionVariable>();
+        induction_var->identifier  = symbols.intern("$iv_" + std::string{symbols.nameOf(for_node.id)} + "_" + std::to_string(constant));
+        induction_var->scope_index = for_node.scope_index;
+        induction_var->slot        = (*current_frame_size)++;
+        induction_var->step        = wrapping_mul(loop.step, constant);
+        induction_var->initial     = wrapping_sub(wrapping_mul(start, constant), induction_var->step);
+
+        for (auto &&use : uses) {
+            use->reduction     = ASTReduction::InductionVar;
+            use->induction_var = induction_var.get();
+        }
+
+        FLUX_TRACE(TRACE_OPT, TRACE_SUMMARY, "Line " << for_node.line << ": " << symbols.nameOf(induction_var->identifier) << " in slot " << induction_var->slot
+                                             << " replaces " << uses.size() << " multiplications, step " << induction_var->step);
+        for_node.induction_vars.emplace_back(std::move(induction_var));
+    }
+}
+
+void StrengthReducer::visit(ASTWhileNode& while_node, bool is_sub_expr)
+{
+    while_node.while_condition->accept(*this, true);
+    while_node.while_body->accept(*this, is_sub_expr);
+}
+
+void StrengthReducer::visit(ASTFunctionDecl& func_decl_node, bool is_sub_expr)
+{
+    //Function body has its own scopes, loops outside of it can't be seen from inside
+    auto saved_loops      = std::move(active_loops);
+    auto saved_frame_size = current_frame_size;
+    active_loops.clear();
+    current_frame_size = &func_decl_node.frame_size;
+
+    func_decl_node.function_body->accept(*this, is_sub_expr);
+
+    active_loops       = std::move(saved_loops);
+    current_frame_size = saved_frame_size;
+}
+
+void StrengthReducer::visit(ASTFunctionCall& func_call_node, bool)
+{
+    for (auto &&arg : func_call_node.function_args)
+        arg->accept(*this, true);
+}
+
+void StrengthReducer::visit(ASTBuiltinFunctionCall& builtin_node, bool)
+{
+    for (auto &&arg : builtin_node.function_args)
+        arg->accept(*this, true);
+}
+
+void StrengthReducer::visit(ASTContinue&, bool)
+{}
+
+void StrengthReducer::visit(ASTBreak&, bool)
+{}
+
+void StrengthReducer::visit(ASTReturn& return_node, bool)
+{
+    if(return_node.return_expr)
+        return_node.return_expr->accept(*this, true);
+}
+
+void StrengthReducer::visit(ASTDummyNode&, bool)
+{}
@@ -0,0 +1,75 @@
+/* Strength reduction pass, runs over the AST after parsing and before ILGenerator.
+ * It doesn't rewrite the tree itself, it only tags binary operations (ASTBinaryOp::reduction)
+ * and For loops (ASTForNode::induction_vars) so ILGenerator can emit cheaper instructions.
+*/
+#ifndef UNNAMED_STRENGTH_REDUCTION_HPP
+#define UNNAMED_STRENGTH_REDUCTION_HPP
+
+#include <map>
+#include <vector>
+#include <string>
+
+#include "ast.hpp"
+#include "trace.hpp"
+
+//Largest constant exponent expanded into a DUP/MUL chain, anything above is cheaper as a single IPOW
+#define MAX_POW_MUL_CHAIN 4
+//'i * C' needs to show up atleast this many times in a loop body before a derived induction variable
+//pays for its own update (ACCESS_VAR, PUSH, ADD, REASSIGN_VAR) at the start of every iteration
+#define MIN_INDUCTION_VAR_USES 2
+
+class StrengthReducer : public ASTVisitorInterface {
+    public:
+        //Hidden names of induction variables are interned into 'symbols', same as the names in the tree
+        StrengthReducer(SymbolInterner& symbols)
+            : symbols(symbols)
+        {}
+
+        //'global_frame_size' grows if induction variables are allocated in the global frame
+        void reduce(ListOfASTPtr& ast, std::uint16_t& global_frame_size);
+
+    private:
+        void visit(ASTValue&, bool);
+        void visit(ASTBinaryOp&, bool);
+        void visit(ASTUnaryOp&, bool);
+        void visit(ASTVariableAssign&, bool);
+        void visit(ASTVariableAccess&, bool);
+        void visit(ASTCastNode&, bool);
+        void visit(ASTBlock&, bool);
+        void visit(ASTRangeIterator&, bool);
+        void visit(ASTEllipsisIterator&, bool);
+        void visit(ASTTernaryOp&, bool);
+        void visit(ASTIfNode&, bool);
+        void visit(ASTForNode&, bool);
+        void visit(ASTWhileNode&, bool);
+        void visit(ASTFunctionDecl&, bool);
+        void visit(ASTFunctionCall&, bool);
+        void visit(ASTBuiltinFunctionCall&, bool);
+        void visit(ASTContinue&, bool);
+        void visit(ASTBreak&, bool);
+        void visit(ASTReturn&, bool);
+        void visit(ASTDummyNode&, bool);
+
+    //Helper functions
+    private:
+        void reduceArithmetic(ASTBinaryOp&);
+        void collectInductionCandidate(ASTBinaryOp&);
+
+    private:
+        SymbolInterner& symbols;
+
+        //Everything we know about a For loop while we are inside of its body
+        struct LoopInfo
+        {
+            ASTForNode*   node;
+            std::int64_t  start, step;
+            bool          id_modified = false;
+            //Constant C -> every 'i * C' found in the body
+            std::map<std::int64_t, std::vector<ASTBinaryOp*>> candidates;
+        };
+        std::vector<LoopInfo> active_loops;
+        //Size of the frame we are currently in, induction variables get their slots from here
+        std::uint16_t*        current_frame_size = nullptr;
+};
+
+#endif
@@ -0,0 +1,66 @@
+#include <array>
+#include <functional>
+
+#include "symbol_interner.hpp"
+
+//Same order as PredefinedSymbol
+static constexpr std::array<std::string_view, SYMBOL_PREDEFINED_COUNT> predefinedNames = {
+    "include",
+    "define",
+    "...",
+    "__VMInternals_WriteToConsole__",
+    "__VMInternals_ReadIntFromConsole__",
+    "__VMInternals_Sqrt__",
+    "__VMInternals_Gamma__",
+    "__VMInternals_GetCurrentTime__"
+};
+
+SymbolInterner::SymbolInterner()
+{
+    //Typical unit has a few hundred distinct names, growing early on is the only real cost otherwise
+    slots.resize(2048, 0);
+    hashes.reserve(1024);
+    names.reserve(1024);
+
+    for (auto &&name : predefinedNames)
+        intern(name);
+}
+
+SymbolId SymbolInterner::intern(std::string_view name)
+{
+    std::size_t hash = std::hash<std::string_view>{}(name);
+    std::size_t mask = slots.size() - 1;
+
+    std::size_t index = hash & mask;
+    for (; slots[index] != 0; index = (index + 1) & mask)
+    {
+        SymbolId id = slots[index] - 1;
+        if(hashes[id] == hash && names[id] == name)
+            return id;
+    }
+
+    //New name, 'index' is the empty slot probing stopped at
+    SymbolId id = static_cast<SymbolId>(names.size());
+    names.push_back(storage.emplace_back(name));
+    hashes.push_back(hash);
+    slots[index] = id + 1;
+
+    if(names.size() * 2 > slots.size())
+        grow();
+    return id;
+}
+
+void SymbolInterner::grow()
+{
+    std::vector<SymbolId> grown(slots.size() * 2, 0);
+    std::size_t           mask = grown.size() - 1;
+
+    for (SymbolId id = 0; id < names.size(); ++id)
+    {
+        std::size_t index = hashes[id] & mask;
+        while(grown[index] != 0)
+            index = (index + 1) & mask;
+        grown[index] = id + 1;
+    }
+    slots = std::move(grown);
+}
@@ -0,0 +1,62 @@
+/* Every distinct identifier of a compilation unit gets a 32 bit id the moment it is lexed.
+ * From then on names are only ever compared, hashed and stored as ids: macros, the parser's scopes, AST nodes
+ * and function descriptors all carry SymbolId. The text is only looked up again for errors and traces.
+ * One interner per compilation unit (owned by Lexer), so units compiled in parallel (-j) never share it.
+*/
+#ifndef UNNAMED_SYMBOL_INTERNER_HPP
+#define UNNAMED_SYMBOL_INTERNER_HPP
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using SymbolId = std::uint32_t;
+
+//Interned up front in this order by every interner, so code can refer to them without a lookup
+enum PredefinedSymbol : SymbolId
+{
+    //Directives
+    SYMBOL_INCLUDE,
+    SYMBOL_DEFINE,
+    //Marks vargs in the scope of a function having them, '...' can't be an identifier so it never clashes
+    SYMBOL_ELLIPSIS,
+    //Builtin functions
+    SYMBOL_WRITE_CONSOLE,
+    SYMBOL_IREAD_CONSOLE,
+    SYMBOL_SQRT,
+    SYMBOL_GAMMA,
+    SYMBOL_GETTIME,
+
+    SYMBOL_PREDEFINED_COUNT
+};
+
+class SymbolInterner
+{
+public:
+    SymbolInterner();
+
+    SymbolInterner(const SymbolInterner&)            = delete;
+    SymbolInterner& operator=(const SymbolInterner&) = delete;
+
+    //Same text always gives the same id, ids are handed out densely starting from 0
+    SymbolId         intern(std::string_view name);
+    std::string_view nameOf(SymbolId id) const { return names[id]; }
+    //Ids are always less than this, good for sizing tables indexed by id
+    std::size_t      size() const { return names.size(); }
+
+private:
+    void grow();
+
+private:
+    //Open addressing (linear probing), 'slots' hold id + 1 with 0 being empty. Capacity is a power of 2,
+    //never more than half full. Hash of every name is kept so probing and growing never hash anything twice
+    std::vector<SymbolId>         slots;
+    std::vector<std::size_t>      hashes;
+    std::vector<std::string_view> names;
+    //Names point into these, deque never moves what it already holds
+    std::deque<std::string>       storage;
+};
+
+#endif
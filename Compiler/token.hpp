@@ -3,6 +3,9 @@
 
 #include <unordered_map>
 #include <string>
+#include <string_view>
+
+#include "symbol_interner.hpp"
 
 enum TokenType : std::uint8_t {
     //Primitive Types
@@ -82,8 +85,11 @@ struct Token
 {
     Token() = default;
 
-    std::string  token_value;
-    TokenType    token_type;
+    //Points into the lexer text (or a string literal for EOF), only valid as long as the lexer is
+    std::string_view token_value;
+    TokenType        token_type;
+    //Interned 'token_value', only set for TOKEN_ID
+    SymbolId         token_symbol;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,91 @@
+/* Lock free single producer / single consumer ring of tokens, for pipelined lexing (lexer on its own thread pushes,
+ * parser pops). Each side only ever writes its own index, the other side's index is cached and only loaded again
+ * when the ring looks full (producer) or empty (consumer), so the two threads rarely touch the same cache line.
+*/
+#ifndef UNNAMED_TOKEN_RING_HPP
+#define UNNAMED_TOKEN_RING_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "token.hpp"
+
+//Power of 2, indices only ever grow and are masked on access
+#define TOKEN_RING_SIZE 4096
+
+//Token along with where the lexer was right after lexing it, anything reported while parser is on it points there
+struct RingToken
+{
+    Token         token;
+    std::uint32_t line;
+    std::uint32_t col;
+};
+
+class TokenRing
+{
+    public:
+        //Producer. False if 'stop' got set while waiting for room
+        bool push(const RingToken& item, const std::atomic<bool>& stop)
+        {
+            std::size_t tail = tail_index.load(std::memory_order_relaxed);
+            while(tail - cached_head == TOKEN_RING_SIZE)
+            {
+                cached_head = head_index.load(std::memory_order_acquire);
+                if(tail - cached_head < TOKEN_RING_SIZE)
+                    break;
+                if(stop.load(std::memory_order_acquire))
+                    return false;
+                std::this_thread::yield();
+            }
+
+            slots[tail & (TOKEN_RING_SIZE - 1)] = item;
+            tail_index.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        //Consumer. Next token, waits for the producer if there is none yet. Stays in the ring till pop()
+        const RingToken& front()
+        {
+            std::size_t head = head_index.load(std::memory_order_relaxed);
+            if(head == cached_tail)
+            {
+                cached_tail = tail_index.load(std::memory_order_acquire);
+                if(head == cached_tail)
+                {
+                    waiting.store(true);
+                    while((cached_tail = tail_index.load(std::memory_order_acquire)) == head)
+                        std::this_thread::yield();
+                    waiting.store(false);
+                }
+            }
+            return slots[head & (TOKEN_RING_SIZE - 1)];
+        }
+
+        void pop()
+        {
+            head_index.store(head_index.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        //Producer. Consumer took every token out and is waiting for the next one, nothing it does depends on
+        //the producer anymore. Head first, consumer clears 'waiting' before it pops the token it waited for
+        bool consumerCaughtUp() const
+        {
+            return head_index.load() == tail_index.load(std::memory_order_relaxed) && waiting.load();
+        }
+
+    private:
+        std::array<RingToken, TOKEN_RING_SIZE> slots;
+
+        //Written by consumer
+        alignas(64) std::atomic<std::size_t> head_index{0};
+        std::atomic<bool>                    waiting{false};
+        std::size_t                          cached_tail = 0;
+
+        //Written by producer
+        alignas(64) std::atomic<std::size_t> tail_index{0};
+        std::size_t                          cached_head = 0;
+};
+
+#endif
@@ -0,0 +1,115 @@
+#include <mutex>
+#include <streambuf>
+
+#include "trace.hpp"
+
+//Same order as TraceCategory
+static constexpr std::string_view categoryNames[TRACE_CATEGORY_COUNT] = {"lex", "parse", "opt", "ilgen"};
+
+//Thread buffers are written out once they get this big
+#define TRACE_FLUSH_THRESHOLD (64 * 1024)
+
+static std::mutex outputMutex;
+
+//Appends to a plain string, std::ostream formatting without any of the stringstream overhead
+class TraceLineBuffer : public std::streambuf
+{
+    public:
+        std::string data;
+
+    protected:
+        int_type overflow(int_type chr) override
+        {
+            if(chr != traits_type::eof())
+                data.push_back(static_cast<char>(chr));
+            return chr;
+        }
+        std::streamsize xsputn(const char* text, std::streamsize count) override
+        {
+            data.append(text, static_cast<std::size_t>(count));
+            return count;
+        }
+};
+
+//Lines of this thread not written out yet, whatever is left goes out when the thread ends
+struct TraceThreadLines
+{
+    TraceLineBuffer buffer;
+    std::ostream    stream{&buffer};
+
+    ~TraceThreadLines() { Tracer::flush(); }
+};
+
+static thread_local TraceThreadLines lines;
+
+bool Tracer::configure(std::string_view spec)
+{
+    while(!spec.empty())
+    {
+        std::size_t      comma = spec.find(',');
+        std::string_view entry = spec.substr(0, comma);
+        spec = comma == std::string_view::npos ? std::string_view{} : spec.substr(comma + 1);
+
+        std::uint8_t level = TRACE_DETAIL;
+        std::size_t  colon = entry.find(':');
+        if(colon != std::string_view::npos)
+        {
+            std::string_view levelText = entry.substr(colon + 1);
+            if(levelText.size() != 1 || levelText[0] < '0' || levelText[0] > '0' + TRACE_DETAIL)
+                return false;
+            level = levelText[0] - '0';
+            entry = entry.substr(0, colon);
+        }
+
+        if(entry == "all") {
+            for (auto &&categoryLevel : levels)
+                categoryLevel = level;
+            continue;
+        }
+
+        std::size_t category = 0;
+        while(category < TRACE_CATEGORY_COUNT && categoryNames[category] != entry)
+            ++category;
+        if(category == TRACE_CATEGORY_COUNT)
+            return false;
+        levels[category] = level;
+    }
+    return true;
+}
+
+bool Tracer::setOutput(const char* path)
+{
+    output = std::fopen(path, "w");
+    return output != nullptr;
+}
+
+std::ostream& Tracer::beginLine(TraceCategory category, TraceLevel level)
+{
+    if(listingFormat)
+        lines.stream << categoryNames[category] << '\t' << static_cast<int>(level) << '\t';
+    else
+        lines.stream << '[' << categoryNames[category] << "] ";
+    return lines.stream;
+}
+
+void Tracer::endLine()
+{
+    lines.buffer.data.push_back('\n');
+    if(lines.buffer.data.size() >= TRACE_FLUSH_THRESHOLD)
+        flush();
+}
+
+void Tracer::flush()
+{
+    std::string& data = lines.buffer.data;
+    if(data.empty())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(outputMutex);
+        std::FILE* file = output != nullptr ? output : stderr;
+        std::fwrite(data.data(), 1, data.size(), file);
+        std::fflush(file);
+    }
+    data.clear();
+}
@@ -0,0 +1,77 @@
+/* Compiler traces, what the lexer, parser, optimizations and ILGenerator are doing. For debugging the compiler itself.
+ * Only built in when the compiler is built with FLUX_ENABLE_TRACE defined, every FLUX_TRACE compiles to nothing
+ * otherwise (its still type checked so traces don't rot).
+ * Built in, '--trace=' picks categories and how much of each gets written. Lines go to a buffer per thread and are
+ * written out in big chunks, units compiled in parallel (-j) never get their lines mixed up mid line.
+ *
+ * Text format:    [category] message
+ * Listing format: category<TAB>level<TAB>message, ILGenerator writes records of the IL it hands over instead of what
+ *                 it is doing (il<TAB>address<TAB>instruction<TAB>operand<TAB>scope index), every jump already patched
+*/
+#ifndef UNNAMED_TRACE_HPP
+#define UNNAMED_TRACE_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+#ifdef FLUX_ENABLE_TRACE
+    constexpr bool traceBuiltIn = true;
+#else
+    constexpr bool traceBuiltIn = false;
+#endif
+
+enum TraceCategory : std::uint8_t
+{
+    TRACE_LEX,
+    TRACE_PARSE,
+    TRACE_OPT,
+    TRACE_ILGEN,
+
+    TRACE_CATEGORY_COUNT
+};
+
+//Higher levels write more, a category without level in '--trace=' gets everything
+enum TraceLevel : std::uint8_t
+{
+    TRACE_OFF,
+    TRACE_SUMMARY, //Once per file / function / optimization applied
+    TRACE_DETAIL   //Once per token / statement / instruction
+};
+
+//Writes 'message' (anything that goes into an std::ostream, '<<' chains too) as one line
+#define FLUX_TRACE(category, level, message)                                  \
+    do {                                                                      \
+        if(traceBuiltIn && Tracer::enabled(category, level)) {                \
+            Tracer::beginLine(category, level) << message;                    \
+            Tracer::endLine();                                                \
+        }                                                                     \
+    } while(0)
+
+class Tracer
+{
+    public:
+        //What comes after '--trace=': comma separated categories (lex, parse, opt, ilgen or all), each optionally
+        //followed by ':level' (1 summary, 2 detail). False if its malformed. Done before any compilation starts
+        static bool configure(std::string_view spec);
+        //Default is stderr. False if 'path' can't be opened
+        static bool setOutput(const char* path);
+        static void setListing(bool listing) { listingFormat = listing; }
+
+        static bool enabled(TraceCategory category, TraceLevel level) { return levels[category] >= level; }
+        static bool isListing() { return listingFormat; }
+
+        static std::ostream& beginLine(TraceCategory, TraceLevel);
+        static void          endLine();
+        //Writes out this thread's lines. Threads do it themselves when they end, errors do it right before exiting
+        static void          flush();
+
+    private:
+        static inline std::uint8_t levels[TRACE_CATEGORY_COUNT] = {};
+        static inline bool         listingFormat = false;
+        static inline std::FILE*   output        = nullptr; //nullptr is stderr
+};
+
+#endif
@@ -2,8 +2,8 @@
 
 void __VMInternals_WriteToConsole__()
 {
-    //Get the number of arguments (uint64_t)
-    auto nArgs = std::get<std::uint64_t>(globalStack.back());
+    //Get the number of arguments (uint64_t, verifier made sure of it)
+    auto nArgs = *std::get_if<std::uint64_t>(&globalStack.back());
     globalStack.pop_back();
 
     //No arguments, just print newline
@@ -19,7 +19,7 @@ void __VMInternals_WriteToConsole__()
         }, globalStack[globalStack.size() - i - 1]);
 
     //Clean the stack
-    globalStack.erase(globalStack.end() - nArgs, globalStack.end());
+    globalStack.resize(globalStack.size() - nArgs);
 }
 
 void __VMInternals_ReadIntFromConsole__()
@@ -7,15 +7,14 @@
 */
 
 #include <vector>
-#include <functional>
-#include <unordered_map>
+#include <array>
 #include <type_traits>
 #include <chrono>
 
 #include "interpreter.hpp" //Object
 
 //Stack is in interpreter.cpp
-extern std::vector<Object> globalStack;
+extern OperandStack globalStack;
 
 //----------ALL THE BUILTINS FROM HERE----------
 void __VMInternals_WriteToConsole__();
@@ -25,16 +24,17 @@ void __VMInternals_Gamma__();
 void __VMInternals_GetCurrentTime__();
 
 //----------BUILTIN TABLE----------
-//BuiltinType found in Common/common.hpp
-static std::unordered_map<BuiltinType, std::function<void()>> builtinTable = {
+//Indexed directly by BuiltinType (found in Common/common.hpp), verifier makes sure the index is valid.
+//What each one takes and returns is in builtinSignatures (Common/opcode_table.hpp)
+static const std::array<void(*)(), BUILTIN_COUNT> builtinTable = {{
     //IO
-    {BUILTIN_WRITE_CONSOLE, &__VMInternals_WriteToConsole__    },
-    {BUILTIN_IREAD_CONSOLE, &__VMInternals_ReadIntFromConsole__},
+    &__VMInternals_WriteToConsole__,
+    &__VMInternals_ReadIntFromConsole__,
     //MATH
-    {BUILTIN_SQRT,          &__VMInternals_Sqrt__},
-    {BUILTIN_GAMMA,         &__VMInternals_Gamma__},
+    &__VMInternals_Sqrt__,
+    &__VMInternals_Gamma__,
     //TIME
-    {BUILTIN_GETTIME,       &__VMInternals_GetCurrentTime__}
-};
+    &__VMInternals_GetCurrentTime__
+}};
 
 #endif
\ No newline at end of file
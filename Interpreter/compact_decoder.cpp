@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#include "compact_decoder.hpp"
+#include "..\Common\error_printer.hpp"
+#include "..\Common\opcode_table.hpp"
+
+static_assert(static_cast<int>(END_OF_FILE) < static_cast<int>(PUSH_SMALL_INT), "Compact short forms must not overlap real opcodes");
+
+class CompactReader
+{
+    public:
+        CompactReader(const std::uint8_t* bytes, std::size_t size)
+            : current(bytes), end(bytes + size)
+        {}
+
+        bool atEnd() const { return current == end; }
+
+        std::uint8_t readByte()
+        {
+            if(current == end)
+                printRuntimeError("DecodingError", "Unexpected end of compact code");
+            return *current++;
+        }
+
+        std::uint64_t readULEB128()
+        {
+            std::uint64_t result = 0;
+            for (std::uint32_t shift = 0; shift < 64; shift += 7)
+            {
+                std::uint8_t byte = readByte();
+                result |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+                if(!(byte & 0x80))
+                    return result;
+            }
+            printRuntimeError("DecodingError", "Varint is too long");
+            return 0;
+        }
+
+        std::int64_t readSLEB128()
+        {
+            std::int64_t  result = 0;
+            std::uint32_t shift  = 0;
+            std::uint8_t  byte;
+            do {
+                if(shift >= 64)
+                    printRuntimeError("DecodingError", "Varint is too long");
+                byte    = readByte();
+                result |= static_cast<std::int64_t>(byte & 0x7F) << shift;
+                shift  += 7;
+            } while(byte & 0x80);
+
+            //Sign extend
+            if(shift < 64 && (byte & 0x40))
+                result |= -(static_cast<std::int64_t>(1) << shift);
+            return result;
+        }
+
+        std::uint16_t readULEB128As16()
+        {
+            std::uint64_t value = readULEB128();
+            if(value > UINT16_MAX)
+                printRuntimeError("DecodingError", "16bit operand out of range: ", value);
+            return static_cast<std::uint16_t>(value);
+        }
+
+        template<typename T>
+        T readRaw()
+        {
+            if(static_cast<std::size_t>(end - current) < sizeof(T))
+                printRuntimeError("DecodingError", "Unexpected end of compact code");
+
+            T value;
+            std::memcpy(&value, current, sizeof(T));
+            current += sizeof(T);
+            return value;
+        }
+
+    private:
+        const std::uint8_t* current;
+        const std::uint8_t* end;
+};
+
+void decodeCompactFunction(const LoadedModule& module, std::size_t descriptorIndex, ListOfVMInstruction& code)
+{
+    const CflxFunction& descriptor = module.functions[descriptorIndex];
+    if(descriptor.compactOffset > module.compactCodeSize)
+        printRuntimeError("DecodingError", "Function ", descriptorIndex, " is out of compact code bounds");
+
+    //Length is checked against the bytes actually there, a bogus one can't make us allocate the world
+    CompactReader reader{reinterpret_cast<const std::uint8_t*>(module.compactCode) + descriptor.compactOffset,
+                         module.compactCodeSize - descriptor.compactOffset};
+
+    code.clear();
+    code.reserve(std::min<std::uint64_t>(descriptor.codeLength, module.compactCodeSize - descriptor.compactOffset));
+
+    while(code.size() < descriptor.codeLength)
+    {
+        //Jumps are relative to the function, which starts at 0 here
+        const std::int64_t index = static_cast<std::int64_t>(code.size());
+
+        std::uint8_t opcode = reader.readByte();
+
+        //Short forms first, they expand to normal instructions
+        switch (opcode)
+        {
+            case PUSH_SMALL_INT:
+                code.emplace_back(PUSH_INT64).operand.i64 = reader.readRaw<std::int8_t>();
+                continue;
+            case JUMP_SHORT:
+                code.emplace_back(JUMP).operand.u64 = static_cast<std::uint64_t>(index + reader.readRaw<std::int8_t>());
+                continue;
+            case JUMP_SHORT16:
+                code.emplace_back(JUMP).operand.u64 = static_cast<std::uint64_t>(index + reader.readRaw<std::int16_t>());
+                continue;
+        }
+
+        if(opcode > END_OF_FILE)
+            printRuntimeError("DecodingError", "Unknown instruction in compact code: ", (int)opcode);
+
+        ILInstruction  inst = static_cast<ILInstruction>(opcode);
+        VMInstruction& decoded = code.emplace_back(inst);
+
+        switch (opcodeInfo(inst).operand)
+        {
+            case OPERAND_NONE:
+                break;
+            case OPERAND_INT64:
+                decoded.operand.i64 = reader.readSLEB128();
+                break;
+            case OPERAND_FLOAT:
+                decoded.operand.f64 = reader.readRaw<double>();
+                break;
+            case OPERAND_UINT64:
+                decoded.operand.u64 = reader.readULEB128();
+                break;
+            case OPERAND_CONST:
+            {
+                std::uint64_t constantIndex = reader.readULEB128();
+                if(constantIndex > UINT32_MAX)
+                    printRuntimeError("DecodingError", "Constant index out of range: ", constantIndex);
+                decoded.operand.u32 = static_cast<std::uint32_t>(constantIndex);
+            }
+            break;
+            case OPERAND_UINT16:
+                decoded.operand.u16 = reader.readULEB128As16();
+                break;
+            case OPERAND_SLOT:
+                decoded.operand.u16 = reader.readULEB128As16();
+                decoded.scopeIndex  = reader.readULEB128As16();
+                break;
+            //Out of range targets just wrap around, verifier rejects them
+            case OPERAND_TARGET:
+                decoded.operand.u64 = static_cast<std::uint64_t>(index + reader.readRaw<std::int32_t>());
+                break;
+            case OPERAND_RETURN:
+            {
+                std::uint64_t value = reader.readULEB128();
+                decoded.operand.u64 = (value >> 1) | ((value & 1) ? RETURN_VALUE_BIT : 0);
+            }
+            break;
+        }
+    }
+}
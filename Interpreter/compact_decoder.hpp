@@ -0,0 +1,13 @@
+/* Expands compact code (CFLX_SECTION_COMPACT_CODE, encoding described in cflx_format.hpp) into
+ * the same VMInstruction records a normal .cflx has, everything after this doesn't care which one it was.
+*/
+#ifndef UNNAMED_COMPACT_DECODER_HPP
+#define UNNAMED_COMPACT_DECODER_HPP
+
+#include "module.hpp"
+
+//Expands a single function (descriptor index), exits with DecodingError on malformed input.
+//Verifier still checks the result like any other code
+void decodeCompactFunction(const LoadedModule&, std::size_t, ListOfVMInstruction&);
+
+#endif
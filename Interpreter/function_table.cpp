@@ -0,0 +1,71 @@
+#include <algorithm>
+#include <thread>
+
+#include "function_table.hpp"
+#include "compact_decoder.hpp"
+#include "verifier.hpp"
+
+void FunctionTable::setModule(const LoadedModule& loadedModule)
+{
+    //Nothing is looked at here, descriptors are enough to call anything
+    module  = &loadedModule;
+    entries = std::make_unique<Entry[]>(loadedModule.functionCount);
+}
+
+const VMInstruction* FunctionTable::prepare(std::size_t index)
+{
+    Entry& entry = entries[index];
+
+    //Whoever comes first prepares it, everyone else waits right here till its done
+    std::call_once(entry.prepared, [&]() {
+        const CflxFunction&  descriptor = module->functions[index];
+        const VMInstruction* body;
+        std::size_t          length;
+
+        if(module->header->flags & CFLX_FLAG_COMPACT_CODE)
+        {
+            decodeCompactFunction(*module, index, entry.decodedBody);
+            body   = entry.decodedBody.data();
+            length = entry.decodedBody.size();
+        }
+        else
+        {
+            //loadModule made sure the range is inside of code
+            body   = module->code + descriptor.codeOffset;
+            length = descriptor.codeLength;
+        }
+
+        entry.maxStack = ByteCodeVerifier{*module}.verifyFunction(index, body, length);
+        entry.body.store(body, std::memory_order_release);
+    });
+
+    return entry.body.load(std::memory_order_acquire);
+}
+
+std::size_t FunctionTable::getCodeSize() const
+{
+    if(module->header->flags & CFLX_FLAG_COMPACT_CODE)
+        return module->compactCodeSize;
+    return module->codeLength * sizeof(VMInstruction);
+}
+
+void FunctionTable::prepareAll(unsigned int threadCount)
+{
+    std::size_t              functionCount = module->functionCount;
+    std::atomic<std::size_t> nextToPrepare{0};
+
+    //Every thread (this one included) just takes the next index till there is none left
+    auto prepareRest = [&]() {
+        for (std::size_t index = nextToPrepare++; index < functionCount; index = nextToPrepare++)
+            getBody(index);
+    };
+
+    std::vector<std::thread> workers;
+    std::size_t workerCount = std::min<std::size_t>(threadCount, functionCount) - 1;
+    for (std::size_t i = 0; i < workerCount; ++i)
+        workers.emplace_back(prepareRest);
+
+    prepareRest();
+    for (auto &&worker : workers)
+        worker.join();
+}
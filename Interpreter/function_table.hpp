@@ -0,0 +1,58 @@
+/* Function bodies are prepared (expanded if the code is compact, then verified) before main runs, big modules on a pool
+ * of threads. Nothing executes unless the whole module was accepted.
+ * Main deliberately waits for the pool: starting it as soon as its own body is verified would hide the rest of the
+ * preparation behind it, but main could then print, read input or run for a while before a bad function elsewhere
+ * ends the process. The pool only makes that wait shorter, lazy mode is the way to skip it.
+ * Lazy mode (opt in) prepares a function the first time something calls it instead, short runs of big programs pay
+ * only for the code they execute but a bad function is only rejected once its reached.
+ * Every entry starts out empty and is patched with the ready body once, after that a call is a single load.
+*/
+#ifndef UNNAMED_FUNCTION_TABLE_HPP
+#define UNNAMED_FUNCTION_TABLE_HPP
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "module.hpp"
+
+//Modules with less code than this (in bytes, as stored in the file) are prepared on one thread, threads would cost more than they save
+#define PARALLEL_PREPARE_MIN_CODE_SIZE (1 << 20)
+
+class FunctionTable
+{
+    public:
+        void setModule(const LoadedModule&);
+        //Size of code in the file, compact or not
+        std::size_t getCodeSize() const;
+        //Prepares every function on 'threadCount' threads (calling one included), returns once all of them are done
+        void prepareAll(unsigned int threadCount);
+
+        //Body of the function at descriptor 'index', ready to run (prepared right here if it wasn't). Safe to call from any thread
+        const VMInstruction* getBody(std::size_t index)
+        {
+            const VMInstruction* body = entries[index].body.load(std::memory_order_acquire);
+            return body != nullptr ? body : prepare(index);
+        }
+
+        //Stack entries the function at 'index' needs (params included), only valid once getBody returned
+        std::size_t getMaxStack(std::size_t index) const { return entries[index].maxStack; }
+
+    private:
+        const VMInstruction* prepare(std::size_t);
+
+    private:
+        struct Entry
+        {
+            std::once_flag                    prepared;
+            std::atomic<const VMInstruction*> body{nullptr};
+            ListOfVMInstruction               decodedBody; //Only for compact code, in place code needs no copy
+            std::size_t                       maxStack = 0; //Set before body, body is what publishes it
+        };
+
+        const LoadedModule*      module = nullptr;
+        std::unique_ptr<Entry[]> entries;
+};
+
+#endif
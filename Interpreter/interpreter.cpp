@@ -1,5 +1,8 @@
 #include <unordered_map>
 #include <chrono>
+#include <algorithm>
+#include <thread>
+#include <type_traits>
 
 #include "interpreter.hpp"
 
@@ -8,20 +11,50 @@
 #define GLOBAL_INDEX 0
 
 //All the bery useful stuff used by any (good / working) interpreter
-ObjectStack   globalStack;
-SymbolTable   globalSymbolTable;
+OperandStack  globalStack;
+ObjectStack   globalFrames; //Global frame followed by every active function frame, variables are accessed by slot
 IteratorStack globalIteratorStack;
 Object        returnRegister; //Return value of function pushed to this register thingy
 
 //Think of this as program counter
 std::uint64_t globalInstructionIndex = 0;
 
+//Exponentiation by squaring, exact over the whole 64bit range (wraps around on overflow just like MUL)
+static std::int64_t integerPow(std::int64_t base, std::int64_t exponent)
+{
+    //Integer semantics, 1 / base^n truncates to 0 unless base is 1 or -1
+    if(exponent < 0)
+    {
+        if(base == 0)
+            printRuntimeError("RuntimeError", "Zero raised to a negative power");
+        if(base == 1 || base == -1)
+            return (exponent & 1) ? base : 1;
+        return 0;
+    }
+
+    std::uint64_t result  = 1;
+    std::uint64_t squared = static_cast<std::uint64_t>(base);
+
+    while(exponent)
+    {
+        if(exponent & 1)
+            result *= squared;
+        squared  *= squared;
+        exponent >>= 1;
+    }
+    return static_cast<std::int64_t>(result);
+}
+
 void ByteCodeInterpreter::handleArithmeticOperators(ILInstruction inst)
 {
     auto elem1 = globalStack.back();
     globalStack.pop_back();
-    auto& elem2 = globalStack.back();
+    applyArithmetic(inst, elem1, globalStack.back());
+}
 
+//'elem2' (left hand side) gets the result
+void ByteCodeInterpreter::applyArithmetic(ILInstruction inst, const Object& elem1, Object& elem2)
+{
     std::visit([&](auto&& arg1, auto&& arg2) {
         using Elem1Type = std::decay_t<decltype(arg1)>;
         using Elem2Type = std::decay_t<decltype(arg2)>;
@@ -35,13 +68,19 @@ void ByteCodeInterpreter::handleArithmeticOperators(ILInstruction inst)
             case ILInstruction::MUL:
                 elem2 = arg2 * arg1; break;
             case ILInstruction::POW:
-                elem2 = std::pow(arg2, arg1); break;
+            {
+                if constexpr(std::is_integral_v<Elem1Type> && std::is_integral_v<Elem2Type>)
+                    elem2 = integerPow(static_cast<std::int64_t>(arg2), static_cast<std::int64_t>(arg1));
+                else
+                    elem2 = std::pow(arg2, arg1);
+            }
+            break;
             case ILInstruction::MOD:
             {
                 if(arg1 == 0) {
                     std::cout << "[RuntimeError]: Modulus By 0"; std::exit(1);
                 }
-                if constexpr(std::is_same_v<Elem1Type, int> && std::is_same_v<Elem2Type, int>)
+                if constexpr(std::is_integral_v<Elem1Type> && std::is_integral_v<Elem2Type>)
                     elem2 = arg2 % arg1;
                 else
                     elem2 = std::fmod(arg2, arg1);
@@ -54,10 +93,62 @@ void ByteCodeInterpreter::handleArithmeticOperators(ILInstruction inst)
                 }
                 elem2 = arg2 / arg1;
             }
+            break;
+            //Only ever called with the ones above
+            default:
+                break;
         }
     }, elem1, elem2);
 }
 
+void ByteCodeInterpreter::handleIntegerPower()
+{
+    //Compiler only emits IPOW for Int ^ Int, anything else goes through the generic path
+    auto exponent = std::get_if<std::int64_t>(&globalStack.back());
+    auto base     = std::get_if<std::int64_t>(&STACK_REVERSE_ACCESS_ELEM(2));
+
+    if(!exponent || !base) {
+        handleArithmeticOperators(ILInstruction::POW);
+        return;
+    }
+
+    *base = integerPow(*base, *exponent);
+    globalStack.pop_back();
+}
+
+void ByteCodeInterpreter::handlePowerOfTwoOperators(ILInstruction inst, std::uint16_t shift)
+{
+    auto value = std::get_if<std::int64_t>(&globalStack.back());
+
+    //Same as IPOW, fallback to generic path. Power of two is never pushed, stack only has room for what the opcode table says
+    if(!value)
+    {
+        applyArithmetic(inst == MUL_POW2 ? MUL : inst == DIV_POW2 ? DIV : MOD, Object{static_cast<std::int64_t>(1) << shift}, globalStack.back());
+        return;
+    }
+
+    //Shifting negative values right rounds towards -inf, division has to round towards 0
+    //Bias is (2^shift - 1) for negative values and 0 otherwise
+    const std::int64_t mask = (static_cast<std::int64_t>(1) << shift) - 1;
+    const std::int64_t bias = (*value >> 63) & mask;
+
+    switch (inst)
+    {
+        case ILInstruction::MUL_POW2:
+            *value = static_cast<std::int64_t>(static_cast<std::uint64_t>(*value) << shift);
+            break;
+        case ILInstruction::DIV_POW2:
+            *value = (*value + bias) >> shift;
+            break;
+        case ILInstruction::MOD_POW2:
+            //Remainder takes the sign of the dividend, same as '%'
+            *value = ((*value + bias) & mask) - bias;
+            break;
+        default:
+            break;
+    }
+}
+
 void ByteCodeInterpreter::handleUnaryOperators()
 {
     //Unary not handled in 'handleComparisionAndLogical'
@@ -66,26 +157,24 @@ void ByteCodeInterpreter::handleUnaryOperators()
     }, globalStack.back());
 }
 
-void ByteCodeInterpreter::handleVariableAssignment(ILInstruction inst, const std::string& identifier, const std::uint8_t scopeIndex)
+void ByteCodeInterpreter::handleVariableAssignment(ILInstruction inst, const std::uint16_t slot, const std::uint8_t scopeIndex)
 {
     auto elem = globalStack.back();
 
     const bool shouldPop = inst != ASSIGN_VAR_NO_POP && inst != REASSIGN_VAR_NO_POP;
-    const bool shouldReassign = inst == REASSIGN_VAR || inst == REASSIGN_VAR_NO_POP;
 
     //Pop the stack to get the evaluated expression if necessary
     if (shouldPop)
         globalStack.pop_back();
     
-    //Determine whether to reassign the variable or not
-    shouldReassign ? setValueToNthFrame(identifier, std::move(elem), scopeIndex)
-                   : setValueToTopFrame(identifier, std::move(elem));
+    //Assignment and reassignment are the same thing now, slot was already decided by compiler
+    setValueToNthFrame(slot, std::move(elem), scopeIndex);
 }
 
-void ByteCodeInterpreter::handleVariableAccess(const std::string& identifier, const std::uint8_t scopeIndex)
+void ByteCodeInterpreter::handleVariableAccess(const std::uint16_t slot, const std::uint8_t scopeIndex)
 {
     //Variant should handle the rest ig
-    globalStack.emplace_back(std::move(getValueFromNthFrame(identifier, scopeIndex)));
+    globalStack.emplace_back(getValueFromNthFrame(slot, scopeIndex));
 }
 
 void ByteCodeInterpreter::handleCasting(ILInstruction inst)
@@ -140,7 +229,7 @@ void ByteCodeInterpreter::handleJump(std::size_t jumpOffset)
     globalInstructionIndex = jumpOffset - 1;
 }
 
-void ByteCodeInterpreter::handleIteratorInit(const std::string& iterId, std::uint16_t iterParams)
+void ByteCodeInterpreter::handleIteratorInit(const VMInstruction& iterId, std::uint16_t iterParams)
 {
     //iterParams -> Iterator Type << 8 | Identifier Type
     //Higher 8bits are Iterator Type
@@ -164,20 +253,18 @@ void ByteCodeInterpreter::handleIteratorInit(const std::string& iterId, std::uin
                 getIterator<std::double_t>(iterId, (IteratorType)iterType)
             );
             break;
+        //Verifier rejects any other type
+        default:
+            break;
     }
 }
 
 void ByteCodeInterpreter::handleIteratorHasNext(std::size_t jumpOffset)
 {
     //Get the currently used iterator and call hasNext()
-    //If the next element exists, i mean cool, dont do anything, else jump and pop the iterator from stack
+    //If the next element exists, i mean cool, dont do anything, else jump to ITER_END (which pops the iterator)
     if(!globalIteratorStack.back()->hasNext())
-    {
-        //Set jump location
         globalInstructionIndex = jumpOffset - 1;
-        //Pop the iterator
-        globalIteratorStack.pop_back();
-    }
 }
 
 void ByteCodeInterpreter::handleIteratorNext(std::size_t jumpOffset)
@@ -208,8 +295,8 @@ void ByteCodeInterpreter::handleReturn(std::size_t returnParams)
 
 void ByteCodeInterpreter::handleFunctionEnd(std::uint16_t vargsType)
 {
-    //Destroy function scope and set globalInstructionIndex to what it was before function call
-    destroyFunctionScope();
+    //Destroy function frame and set globalInstructionIndex to what it was before function call
+    destroyFunctionFrame();
     
     //If we use vargs, clean up them as well till return address
     if(vargsType != EVAL_UNKNOWN)
@@ -218,151 +305,64 @@ void ByteCodeInterpreter::handleFunctionEnd(std::uint16_t vargsType)
         functionStartingStack.pop_back();
     }
 
-    auto val = std::get<std::uint64_t>(globalStack.back());
+    //Verifier made sure return address is on top
+    auto val = *std::get_if<std::uint64_t>(&globalStack.back());
     globalInstructionIndex = val - 1;
 
     globalStack.pop_back();
 }
 
-void ByteCodeInterpreter::setFile(const char* filename)
+void ByteCodeInterpreter::setFile(const char* filename, const InterpreterOptions& interpreterOptions)
 {
-    inFile.open(filename, std::ios_base::binary);
-            
-    if (!inFile) {
+    options = interpreterOptions;
+
+    //Nothing is read here, pages are loaded by the OS as the code touches them
+    if (!mappedFile.open(filename)) {
         std::cerr << "[FileReadingError]: Error opening file: " << filename << '\n';
         std::exit(1);
     }
-}
 
-void ByteCodeInterpreter::decodeFile()
-{
-    bool hasInst = true;
-    
-    //Inefficient ahhh
-    std::vector<std::pair<std::size_t, ListOfInstruction>> functionStack;
-    //Think of this as a main function
-    functionStack.emplace_back(0, ListOfInstruction{});
-    //Using this so i can change where i can emplace instructions
-    ListOfInstruction* refToInstructionList = &(functionStack.back().second);
-
-    //Our buffer which will store chunks of file
-    std::size_t       chunkBufferIndex;
-    std::array<Byte, FILE_READ_CHUNK_SIZE> chunkBuffer;
-
-    //Read one chunk initially ofc
-    readFileChunk(chunkBuffer, chunkBufferIndex);
+    //Only the header, section table and function table are looked at (whole file with --checksum), mapping is page aligned and sections are aligned within the file
+    loadModule(mappedFile.data(), mappedFile.size(), module, options.verifyChecksum);
+    functionTable.setModule(module);
 
-    while (hasInst)
+    constantPool.reserve(module.constantCount);
+    for (std::size_t i = 0; i < module.constantCount; ++i)
     {
-        //Instruction is 1 byte, read it and increment
-        Byte instByte = chunkBuffer[chunkBufferIndex++];
-        ILInstruction inst = static_cast<ILInstruction>(instByte);
-
-        //Check if we need to refill buffer
-        if(chunkBufferIndex >= chunkBuffer.size())
-            readFileChunk(chunkBuffer, chunkBufferIndex);
-
-        switch (inst)
-        {
-            case END_OF_FILE:
-                refToInstructionList->emplace_back(inst);
-                hasInst = false;
-                break;
-            
-            case FUNC_START:
-            {   
-                std::size_t funcStartIndex = readOperand<std::size_t>(chunkBuffer, chunkBufferIndex);
-                functionStack.emplace_back(funcStartIndex, ListOfInstruction{});
-                refToInstructionList = &(functionStack.back().second);
-            }
-            break;
-
-            case FUNC_END:
-            {
-                //Emplace FUNC_END instruction before creating a function frame
-                refToInstructionList->emplace_back(ILInstruction::FUNC_END, readOperand<std::uint16_t>(chunkBuffer, chunkBufferIndex));
-
-                //Create the frame now
-                std::size_t funcStartIndex = functionStack.back().first;
-                functionTable.emplace(funcStartIndex, std::move(functionStack.back().second));
-                functionStack.pop_back();
-                refToInstructionList = &(functionStack.back().second);
-            }
-            break;
-
-            //Primitive types
-            case PUSH_INT64:
-                refToInstructionList->emplace_back(inst, readOperand<std::int64_t>(chunkBuffer, chunkBufferIndex));
-                break;
-            case PUSH_UINT64:
-                refToInstructionList->emplace_back(inst, readOperand<std::uint64_t>(chunkBuffer, chunkBufferIndex));
-                break;
-            case PUSH_FLOAT:
-                refToInstructionList->emplace_back(inst, readOperand<std::double_t>(chunkBuffer, chunkBufferIndex));
-                break;
-
-            //Variable assignment / accessing
-            case ILInstruction::ASSIGN_VAR:
-            case ILInstruction::ASSIGN_VAR_NO_POP:
-                refToInstructionList->emplace_back(inst, std::move(readStringOperand(chunkBuffer, chunkBufferIndex)), 0);
-                break;
-
-            case ILInstruction::REASSIGN_VAR:
-            case ILInstruction::REASSIGN_VAR_NO_POP:
-            case ILInstruction::ACCESS_VAR:
-                refToInstructionList->emplace_back(inst, std::move(readStringOperand(chunkBuffer, chunkBufferIndex)));
-                //Having to do it like this cuz it wasnt working when i do it inline with emplace_back
-                refToInstructionList->back().scopeIndexIfNeeded = readOperand<std::uint16_t>(chunkBuffer, chunkBufferIndex);
-                break;
-
-            //Jump cases
-            case ILInstruction::JUMP:
-            case ILInstruction::JUMP_IF_FALSE:
-            //As they have same operands to decode, just put them here
-            case ILInstruction::ITER_HAS_NEXT:
-            case ILInstruction::ITER_NEXT:
-            case ILInstruction::FUNC_CALL:
-            case ILInstruction::FUNC_VARGS:
-            case ILInstruction::RETURN:
-                refToInstructionList->emplace_back(inst, readOperand<std::size_t>(chunkBuffer, chunkBufferIndex));
-                break;
-            
-            //Iterator
-            case ILInstruction::DATAINST_ITER_ID:
-                refToInstructionList->emplace_back(inst, std::move(readStringOperand(chunkBuffer, chunkBufferIndex)));
-                break;
-            case ILInstruction::ITER_INIT:
-            //Same for this instruction
-            case ILInstruction::DESTROY_MULTIPLE_SYMBOL_TABLES:
-            case ILInstruction::BUILTIN_CALL:
-                refToInstructionList->emplace_back(inst, readOperand<std::uint16_t>(chunkBuffer, chunkBufferIndex));
-                break;
-            //Rest of it just read instruction
-            default:
-                refToInstructionList->emplace_back(inst);
-                break;
+        const CflxConstant& constant = module.constants[i];
+        if(constant.type == EVAL_INT)
+            constantPool.emplace_back(static_cast<std::int64_t>(constant.bits));
+        else {
+            std::double_t value;
+            std::memcpy(&value, &constant.bits, sizeof(value));
+            constantPool.emplace_back(value);
         }
     }
-
-    //Move the so called main function scope thingy to 'instructions' as its the first thing used by interpretInstructions
-    instructions = std::move(functionStack.back().second);
 }
 
-void ByteCodeInterpreter::interpretInstructions(ListOfInstruction& externalInstructions)
+//Everything in here was proven safe by ByteCodeVerifier, operands are read straight out of the union
+void ByteCodeInterpreter::interpretInstructions(const VMInstruction* externalInstructions)
 {
     if(currentCallStackDepth > maxCallStackDepth)
         printRuntimeError("RecursionError", "Max call stack depth reached, over 1000 function calls");
 
     while(true)
     {
-        Instruction& i = externalInstructions[globalInstructionIndex];
+        const VMInstruction& i = externalInstructions[globalInstructionIndex];
 
         switch (i.inst)
         {
             case ILInstruction::PUSH_INT64:
+                globalStack.emplace_back(i.operand.i64);
+                break;
             case ILInstruction::PUSH_UINT64:
+                globalStack.emplace_back(i.operand.u64);
+                break;
             case ILInstruction::PUSH_FLOAT:
-                pushInstructionValue(i.value);
+                globalStack.emplace_back(i.operand.f64);
+                break;
+            case ILInstruction::PUSH_CONST:
+                globalStack.push_back(constantPool[i.operand.u32]);
                 break;
             
             //Unary Operations, '+' as unary -> useless ahh
@@ -380,6 +380,25 @@ void ByteCodeInterpreter::interpretInstructions(ListOfInstruction& externalInstr
                 handleArithmeticOperators(i.inst);
                 break;
             
+            //Strength reduced arithmetic
+            case ILInstruction::IPOW:
+                handleIntegerPower();
+                break;
+            case ILInstruction::MUL_POW2:
+            case ILInstruction::DIV_POW2:
+            case ILInstruction::MOD_POW2:
+                handlePowerOfTwoOperators(i.inst, i.operand.u16);
+                break;
+            case ILInstruction::DUP:
+            {
+                Object top = globalStack.back();
+                globalStack.emplace_back(std::move(top));
+            }
+            break;
+            case ILInstruction::POP:
+                globalStack.pop_back();
+                break;
+            
             //Casting stuff
             case ILInstruction::CAST_FLOAT:
             case ILInstruction::CAST_INT:
@@ -406,49 +425,47 @@ void ByteCodeInterpreter::interpretInstructions(ListOfInstruction& externalInstr
             case ILInstruction::ASSIGN_VAR_NO_POP:
             case ILInstruction::REASSIGN_VAR:
             case ILInstruction::REASSIGN_VAR_NO_POP:
-                handleVariableAssignment(i.inst, std::get<std::string>(i.value), i.scopeIndexIfNeeded);
+                handleVariableAssignment(i.inst, i.operand.u16, i.scopeIndex);
                 break;
             
             case ILInstruction::ACCESS_VAR:
-                handleVariableAccess(std::get<std::string>(i.value), i.scopeIndexIfNeeded);
+                handleVariableAccess(i.operand.u16, i.scopeIndex);
                 break;
             
             //Jump conditions
             case ILInstruction::JUMP_IF_FALSE:
-                handleJumpIfFalse(std::get<std::size_t>(i.value));
+                handleJumpIfFalse(i.operand.u64);
                 break;
             //Unconditional jump
             case ILInstruction::JUMP:
-                handleJump(std::get<std::size_t>(i.value));
+                handleJump(i.operand.u64);
                 break;
             
             //Iterators
             case ILInstruction::ITER_INIT:
-                handleIteratorInit(std::get<std::string>(externalInstructions[globalInstructionIndex - 1].value),
-                                    std::get<std::uint16_t>(i.value));
+                handleIteratorInit(externalInstructions[globalInstructionIndex - 1], i.operand.u16);
                 break;
             case ILInstruction::ITER_HAS_NEXT:
-                handleIteratorHasNext(std::get<std::size_t>(i.value));
+                handleIteratorHasNext(i.operand.u64);
                 break;
             case ILInstruction::ITER_CURRENT:
-                setValueToTopFrame(globalIteratorStack.back()->getId(), std::move(globalIteratorStack.back()->getCurrent()));
+                setValueToNthFrame(globalIteratorStack.back()->getSlot(), globalIteratorStack.back()->getCurrent(),
+                                    globalIteratorStack.back()->getScopeIndex());
                 break;
             case ILInstruction::ITER_NEXT:
-                handleIteratorNext(std::get<std::size_t>(i.value));
+                handleIteratorNext(i.operand.u64);
                 break;
             case ILInstruction::ITER_RECALC_STEP:
                 globalIteratorStack.back()->recalcStep();
                 break;
-            
-            //Symbol table
-            case ILInstruction::CREATE_SYMBOL_TABLE:
-                createSymbolTable();
+            //Loop is over (or Break / Return from inside of it)
+            case ILInstruction::ITER_END:
+                globalIteratorStack.pop_back();
                 break;
-            case ILInstruction::DESTROY_SYMBOL_TABLE:
-                destroySymbolTable();
-                break;
-            case ILInstruction::DESTROY_MULTIPLE_SYMBOL_TABLES:
-                destroyMultipleSymbolTables(std::get<std::uint16_t>(i.value));
+            
+            //Frame
+            case ILInstruction::ALLOC_FRAME:
+                allocateFrame(i.operand.u16);
                 break;
             
             //Functions and return values
@@ -456,29 +473,33 @@ void ByteCodeInterpreter::interpretInstructions(ListOfInstruction& externalInstr
             case ILInstruction::FUNC_VARGS:
             {
                 functionStartingStack.emplace_back(globalStack.size());
-                globalStack.emplace_back(std::get<std::size_t>(i.value));
+                globalStack.emplace_back(i.operand.u64);
             }
             break;
             //Return address is already saved to stack, call function resetting instruction index to 0
             case ILInstruction::FUNC_CALL:
             {
+                //Operand is the function index, body is prepared on the very first call
+                const VMInstruction* body = functionTable.getBody(i.operand.u64);
+                globalStack.reserve(functionTable.getMaxStack(i.operand.u64));
+
                 globalInstructionIndex = 0;
                 IN_FUNC
-                ByteCodeInterpreter::getInstance().interpretInstructions(functionTable.at(std::get<std::size_t>(i.value) - 1));
+                ByteCodeInterpreter::getInstance().interpretInstructions(body);
                 OUT_FUNC
             }
             break;
             //Fancy ahh
             case ILInstruction::BUILTIN_CALL:
                 //Call the function at the index specified by call
-                builtinTable.at(static_cast<BuiltinType>(std::get<std::uint16_t>(i.value)))();
+                builtinTable[i.operand.u16]();
                 break;
             case ILInstruction::FUNC_END:
-                handleFunctionEnd(std::get<std::uint16_t>(i.value));
+                handleFunctionEnd(i.operand.u16);
                 return;
             //Place the value in returnRegister
             case RETURN:
-                handleReturn(std::get<std::size_t>(i.value));
+                handleReturn(i.operand.u64);
                 break;
             //Will optimize this later
             case USE_RETURN_VAL:
@@ -496,6 +517,10 @@ void ByteCodeInterpreter::interpretInstructions(ListOfInstruction& externalInstr
                     }, globalStack.back());
                 }
                 return;
+
+            //FUNC_START is IL only, verifier never lets it into a body
+            default:
+                break;
         }
         
         //Increment instruction index at the end
@@ -505,32 +530,35 @@ void ByteCodeInterpreter::interpretInstructions(ListOfInstruction& externalInstr
 
 void ByteCodeInterpreter::interpret()
 {
-    //Initialize global symbol table with one frame / global frame
-    globalSymbolTable.emplace_back();
+    //Global frame is allocated by the first instruction (ALLOC_FRAME) itself
+    //Whole module is verified before any of it runs (main waits for every thread, see function_table.hpp),
+    //lazy mode only prepares main here and everything else when its called
+    auto start_pm = std::chrono::high_resolution_clock::now();
 
-    auto start_df = std::chrono::high_resolution_clock::now();
+    if(!options.lazyPrepare)
+        functionTable.prepareAll(functionTable.getCodeSize() >= PARALLEL_PREPARE_MIN_CODE_SIZE ? std::max(std::thread::hardware_concurrency(), 1u) : 1);
 
-    //Decode File
-    decodeFile();
+    const VMInstruction* mainBody = functionTable.getBody(0);
+    globalStack.reserve(functionTable.getMaxStack(0));
 
-    auto end_df = std::chrono::high_resolution_clock::now();
+    auto end_pm = std::chrono::high_resolution_clock::now();
     
     auto start_ii = std::chrono::high_resolution_clock::now();
 
-    //Execute instructions
-    interpretInstructions(instructions);
+    //Execute instructions, main is always the first function
+    interpretInstructions(mainBody);
 
     auto end_ii = std::chrono::high_resolution_clock::now();
 
-    std::cout << "Time to decode entire file: " <<
-        (std::chrono::duration_cast<std::chrono::microseconds>(end_df - start_df)).count() << " microsec" << '\n';
-    std::cout << "Time to interpret decoded instructions: " <<
+    std::cout << "Time to prepare functions: " <<
+        (std::chrono::duration_cast<std::chrono::microseconds>(end_pm - start_pm)).count() << " microsec" << '\n';
+    std::cout << "Time to interpret instructions: " <<
         (std::chrono::duration_cast<std::chrono::microseconds>(end_ii - start_ii)).count() <<  " microsec" << '\n';
 }
 
 //-----------------Helper Fuctions-----------------
 template<typename T>
-IterPtr ByteCodeInterpreter::getIterator(const std::string& id, IteratorType iterType)
+IterPtr ByteCodeInterpreter::getIterator(const VMInstruction& iterId, IteratorType iterType)
 {
     switch (iterType)
     {
@@ -545,7 +573,7 @@ IterPtr ByteCodeInterpreter::getIterator(const std::string& id, IteratorType ite
             globalStack.resize(globalStack.size() - 3);
             
             return std::visit([&](auto&& step, auto&& stop, auto&& start) {
-                return std::make_unique<RangeIterator<T>>(id, start, stop, step);
+                return std::make_unique<RangeIterator<T>>(iterId.operand.u16, iterId.scopeIndex, start, stop, step);
             }, vstep, vstop, vstart);
         }
         break;
@@ -554,7 +582,7 @@ IterPtr ByteCodeInterpreter::getIterator(const std::string& id, IteratorType ite
             auto start = functionStartingStack.back();
             //We need to get the size of vargs, which is exactly after top function ret addr
             return std::visit([&](auto&& size) {
-                return std::make_unique<EllipsisIterator>(id, start + 1, size);
+                return std::make_unique<EllipsisIterator>(iterId.operand.u16, iterId.scopeIndex, start + 1, size);
             }, globalStack[start]);
         }
         break;
@@ -566,26 +594,30 @@ IterPtr ByteCodeInterpreter::getIterator(const std::string& id, IteratorType ite
 template<typename T, typename U>
 void ByteCodeInterpreter::compare(const T& arg1, const U& arg2, ILInstruction inst)
 {
+    //Same conversion the operators would do on their own, spelled out so mixed signedness doesn't warn
+    using CommonType = std::common_type_t<T, U>;
+    const CommonType lhs = static_cast<CommonType>(arg1), rhs = static_cast<CommonType>(arg2);
+
     int result = 0;
     switch (inst) {
         //Comparision operators
         case ILInstruction::CMP_EQ:
-            result = (arg1 == arg2);
+            result = (lhs == rhs);
             break;
         case ILInstruction::CMP_NEQ:
-            result = (arg1 != arg2);
+            result = (lhs != rhs);
             break;
         case ILInstruction::CMP_LT:
-            result = (arg1 < arg2);
+            result = (lhs < rhs);
             break;
         case ILInstruction::CMP_GT:
-            result = (arg1 > arg2);
+            result = (lhs > rhs);
             break;
         case ILInstruction::CMP_LTEQ:
-            result = (arg1 <= arg2);
+            result = (lhs <= rhs);
             break;
         case ILInstruction::CMP_GTEQ:
-            result = (arg1 >= arg2);
+            result = (lhs >= rhs);
             break;
         //Type comparison (is operator)
         case ILInstruction::CMP_IS:
@@ -615,126 +647,31 @@ void ByteCodeInterpreter::compare(const T& arg1, const U& arg2, ILInstruction in
         case ILInstruction::NOT:
             result = !arg1;
             break;
+        default:
+            break;
     }
     globalStack.push_back(result);
 }
 
-void ByteCodeInterpreter::pushInstructionValue(const InstructionValue& val)
+//Frame related
+void ByteCodeInterpreter::allocateFrame(std::uint16_t frameSize)
 {
-    std::visit([&](auto&& arg){
-        using T = std::decay_t<decltype(arg)>;
-
-        if constexpr(std::is_same_v<T, std::int64_t>
-                    || std::is_same_v<T, std::uint64_t>
-                    || std::is_same_v<T, std::double_t>)
-            globalStack.emplace_back(std::move(arg));
-    }, val);
+    //Frame of the current function (or global frame) starts at frameBases.back()
+    globalFrames.resize(frameBases.back() + frameSize);
 }
 
-//Symbol table related
-void ByteCodeInterpreter::createSymbolTable()
+void ByteCodeInterpreter::destroyFunctionFrame()
 {
-    globalSymbolTable.emplace_back();
+    globalFrames.resize(frameBases.back());
 }
 
-void ByteCodeInterpreter::destroySymbolTable()
+const Object& ByteCodeInterpreter::getValueFromNthFrame(const std::uint16_t slot, const std::uint8_t scopeIndex)
 {
-    globalSymbolTable.pop_back();   
+    //GLOBAL_FRAME starts at 0, LOCAL_FRAME starts at base of current function frame
+    return globalFrames[(scopeIndex == LOCAL_FRAME) * frameBases.back() + slot];
 }
 
-void ByteCodeInterpreter::destroyMultipleSymbolTables(std::uint16_t scopesToDestroy)
+void ByteCodeInterpreter::setValueToNthFrame(const std::uint16_t slot, Object&& elem, const std::uint8_t scopeIndex)
 {
-    globalSymbolTable.erase(globalSymbolTable.end() - scopesToDestroy, globalSymbolTable.end());
-}
-
-void ByteCodeInterpreter::destroyFunctionScope()
-{
-    globalSymbolTable.resize(functionStartingScope.back());
-}
-
-const Object& ByteCodeInterpreter::getValueFromNthFrame(const std::string& id, const std::uint8_t scopeIndex)
-{
-    return globalSymbolTable[(scopeIndex != 0) * (functionStartingScope.back() + scopeIndex - 1)].at(id);
-}
-
-void ByteCodeInterpreter::setValueToTopFrame(const std::string& id, Object&& elem)
-{
-    globalSymbolTable.back()[id] = std::move(elem);
-}
-
-void ByteCodeInterpreter::setValueToNthFrame(const std::string& id, Object&& elem, const std::uint8_t scopeIndex)
-{
-    globalSymbolTable[(scopeIndex != 0) * (functionStartingScope.back() + scopeIndex - 1)][id] = std::move(elem);
-}
-
-//File decoding related
-void ByteCodeInterpreter::readFileChunk(ByteArray& chunkBuffer, std::size_t& chunkBufferIndex)
-{
-    inFile.read(chunkBuffer.data(), FILE_READ_CHUNK_SIZE);
-    chunkBufferIndex = 0;
-}
-
-template<typename T>
-T ByteCodeInterpreter::readOperand(ByteArray& chunkBuffer, std::size_t& chunkBufferIndex)
-{
-    //IF rest of the stuff is outside of current chunk, handle it
-    if(chunkBufferIndex + sizeof(T) > chunkBuffer.size())
-    {
-        //Read the remaining bytes first
-        const std::size_t remainingBytesInCurrentChunk = (chunkBuffer.size() - chunkBufferIndex);
-        //This many no. of bytes is to be read in the next chunk
-        const std::size_t remainingBytesToRead         = sizeof(T) - remainingBytesInCurrentChunk;
-        //Value to be read to
-        T splitValue;
-        
-        ///STEP1: Read the remaining bytes in current chunk first into the value
-        std::memcpy(&splitValue, chunkBuffer.data() + chunkBufferIndex, remainingBytesInCurrentChunk);
-
-        ///STEP 2: Read the next chunk of file
-        readFileChunk(chunkBuffer, chunkBufferIndex);
-
-        ///STEP 3: Read the remaining bytes residing in this chunk now, from where we left of
-        std::memcpy(reinterpret_cast<char*>(&splitValue) + remainingBytesInCurrentChunk, chunkBuffer.data(), remainingBytesToRead);
-        
-        ///STEP 4: Increment the index
-        chunkBufferIndex += remainingBytesToRead;
-
-        //Finally return it
-        return splitValue;
-    }
-
-    //Read the value from current index
-    T value;
-    std::memcpy(&value, chunkBuffer.data() + chunkBufferIndex, sizeof(T));
-    chunkBufferIndex += sizeof(T);
-
-    return value;
-}
-
-std::string& ByteCodeInterpreter::readStringOperand(ByteArray& chunkBuffer, std::size_t& chunkBufferIndex)
-{
-    //Read length of string first
-    std::size_t strLength = readOperand<std::size_t>(chunkBuffer, chunkBufferIndex);
-
-    //Resize storage variable
-    currentVariable.resize(strLength);
-    
-    ///Same as readOperand, copied the entire thing
-    if(chunkBufferIndex + strLength > chunkBuffer.size())
-    {
-        const std::size_t remainingBytesInCurrentChunk = (chunkBuffer.size() - chunkBufferIndex);
-        const std::size_t remainingBytesToRead         = strLength - remainingBytesInCurrentChunk;
-
-        std::memcpy(currentVariable.data(), chunkBuffer.data() + chunkBufferIndex, remainingBytesInCurrentChunk);
-        readFileChunk(chunkBuffer, chunkBufferIndex);
-        std::memcpy(currentVariable.data() + remainingBytesInCurrentChunk, chunkBuffer.data(), remainingBytesToRead);
-        
-        chunkBufferIndex += remainingBytesToRead;
-        return currentVariable;
-    }
-    //Else its inside the chunk
-    std::memcpy(currentVariable.data(), chunkBuffer.data() + chunkBufferIndex, strLength);
-    chunkBufferIndex += strLength;
-
-    return currentVariable;
+    globalFrames[(scopeIndex == LOCAL_FRAME) * frameBases.back() + slot] = std::move(elem);
 }
\ No newline at end of file
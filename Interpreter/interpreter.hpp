@@ -1,7 +1,6 @@
 #ifndef UNNAMED_INTEPRETER_HPP
 #define UNNAMED_INTEPRETER_HPP
 
-#include <fstream>
 #include <iostream>
 #include <cmath>
 #include <cstring>
@@ -11,30 +10,37 @@
 #include <unordered_map>
 
 #include "..\Common\common.hpp"
+#include "..\Common\opcode_table.hpp"
 #include "..\Common\error_printer.hpp"
+#include "mapped_file.hpp"
+#include "module.hpp"
+#include "function_table.hpp"
 
 //Just to simply make the horrendous c++ code look much better
 using Byte   = char;
 using Object = std::variant<std::uint64_t, std::int64_t, std::double_t>; //Had no other name
 
+#include "operand_stack.hpp"
 #include "iterators.hpp"
 #include "builtins.hpp"
 
-//File decoding related
-#define FILE_READ_CHUNK_SIZE 2048
-
 //Same for these as well...
-using FunctionTable = std::unordered_map<std::size_t, ListOfInstruction>;
-using SymbolTable   = std::vector<std::unordered_map<std::string, Object>>;
 using IteratorStack = std::vector<IterPtr>;
 using ObjectStack   = std::vector<Object>;
-using ByteArray     = std::array<Byte, FILE_READ_CHUNK_SIZE>;
 
 //Again to be strictly used in ByteCodeInterpreter member functions
 #define IN_FUNC ++currentCallStackDepth;\
-                functionStartingScope.emplace_back(globalSymbolTable.size());
+                frameBases.emplace_back(globalFrames.size());
 #define OUT_FUNC --currentCallStackDepth;\
-                 functionStartingScope.pop_back();
+                 frameBases.pop_back();
+
+struct InterpreterOptions
+{
+    //Functions are prepared (and verified) the first time they are called instead of all of them before main runs
+    bool lazyPrepare    = false;
+    //Whole file is read and checked against header checksum on load, catches corruption verifier can't (like constants)
+    bool verifyChecksum = false;
+};
 
 class ByteCodeInterpreter {
     private:
@@ -50,63 +56,57 @@ class ByteCodeInterpreter {
             return instance;
         }
 
-        void setFile(const char*);
+        void setFile(const char*, const InterpreterOptions&);
         void interpret();
 
     private:
-        void decodeFile();
-        void interpretInstructions(ListOfInstruction&);
+        void interpretInstructions(const VMInstruction*);
     
     private:
         void handleUnaryOperators();
         void handleArithmeticOperators(ILInstruction);
-        void handleVariableAssignment(ILInstruction, const std::string&, const std::uint8_t);
-        void handleVariableAccess(const std::string&, const std::uint8_t);
+        void handleIntegerPower();
+        void handlePowerOfTwoOperators(ILInstruction, std::uint16_t);
+        void handleVariableAssignment(ILInstruction, const std::uint16_t, const std::uint8_t);
+        void handleVariableAccess(const std::uint16_t, const std::uint8_t);
         void handleCasting(ILInstruction);
         void handleComparisionAndLogical(ILInstruction);
         //Jump
         void handleJumpIfFalse(std::size_t);
         void handleJump(std::size_t);
         //Iterator
-        void handleIteratorInit(const std::string&, std::uint16_t);
+        void handleIteratorInit(const VMInstruction&, std::uint16_t);
         void handleIteratorHasNext(std::size_t);
         void handleIteratorNext(std::size_t);
         //Function and Return
         void handleReturn(std::size_t);
         void handleFunctionEnd(std::uint16_t);
     
-    //Symbol table related
+    //Frame related
     private:
-        void          createSymbolTable();
-        void          destroySymbolTable();
-        void          destroyMultipleSymbolTables(std::uint16_t);
-        void          destroyFunctionScope();
-        void          setValueToTopFrame(const std::string&, Object&&);
-        void          setValueToNthFrame(const std::string&, Object&&, const std::uint8_t);
-        const Object& getValueFromNthFrame(const std::string&, const std::uint8_t);
+        void          allocateFrame(std::uint16_t);
+        void          destroyFunctionFrame();
+        void          setValueToNthFrame(const std::uint16_t, Object&&, const std::uint8_t);
+        const Object& getValueFromNthFrame(const std::uint16_t, const std::uint8_t);
     
     private: //Helper functions
+        void    applyArithmetic(ILInstruction, const Object&, Object&);
         template<typename T>
-        IterPtr getIterator(const std::string&, IteratorType);
+        IterPtr getIterator(const VMInstruction&, IteratorType);
         template<typename T, typename U>
         void    compare(const T&, const U&, ILInstruction);
-        void    pushInstructionValue(const InstructionValue&);
 
-    //File decoding related
-    private:
-        void readFileChunk(ByteArray&, std::size_t&);
-        template<typename T>
-        T readOperand(ByteArray&, std::size_t&);
-        std::string& readStringOperand(ByteArray&, std::size_t&);
-    
     private:
-        ListOfInstruction instructions;
-        std::string       currentVariable;
-        std::ifstream     inFile;
+        InterpreterOptions   options;
+        //Code is executed straight out of the mapped file (or expanded compact code), FUNC_CALL operands are function indices
+        MappedFile           mappedFile;
+        LoadedModule         module;
+        FunctionTable        functionTable;
+        //Constant pool turned into ready to push values once, PUSH_CONST just copies from here
+        ObjectStack          constantPool;
         //Function stuff
-        FunctionTable     functionTable;
         std::uint32_t     maxCallStackDepth = 1000, currentCallStackDepth = 0;
-        std::vector<std::uint16_t> functionStartingScope = {1}; // Initial (main) scope u could say
+        std::vector<std::size_t>   frameBases = {0}; //Where the current function frame starts in globalFrames, 0 is global frame
         std::vector<std::size_t>   functionStartingStack; //Might merge this and above vector in future
 };
 #endif
\ No newline at end of file
@@ -6,41 +6,41 @@
 
 class Iterator;
 //Mark this as extern to get access to globalStack residing in interpreter.cpp
-extern std::vector<Object> globalStack;
+extern OperandStack globalStack;
 
 using IterPtr = std::unique_ptr<Iterator>;
 
 class Iterator
 {
     public:
-        virtual const std::string& getId()      const = 0;
         virtual       Object       getCurrent() const = 0;
         virtual       void         recalcStep()       = 0;
         virtual       void         next()             = 0;
         virtual       bool         hasNext()    const = 0;
 
+        //Where the current value is written to (slot in global or local frame)
+        std::uint16_t getSlot()       const { return iterSlot; }
+        std::uint16_t getScopeIndex() const { return iterScopeIndex; }
+
     protected:
-        std::string iterIdentifier;
+        std::uint16_t iterSlot, iterScopeIndex;
 };
 
 template<typename T>
 class RangeIterator : public Iterator
 {
     public:
-        RangeIterator(const std::string& iterId, T start, T stop, T step)
+        RangeIterator(std::uint16_t slot, std::uint16_t scopeIndex, T start, T stop, T step)
             : start(start), stop(stop), step(step)
         {
-            iterIdentifier = std::move(iterId);
+            iterSlot       = slot;
+            iterScopeIndex = scopeIndex;
         }
 
         Object getCurrent() const override {
             return start;
         }
 
-        const std::string& getId() const override {
-            return iterIdentifier;
-        }
-
         //Lets keep it simple for now
         void recalcStep() override {
             step = start < stop ? 1 : -1;
@@ -62,20 +62,17 @@ class RangeIterator : public Iterator
 class EllipsisIterator : public Iterator
 {
 public:
-    EllipsisIterator(const std::string& iterId, std::size_t start, std::size_t size)
+    EllipsisIterator(std::uint16_t slot, std::uint16_t scopeIndex, std::size_t start, std::size_t size)
         : start(start), end(start + size - 1)
     {
-        iterIdentifier = std::move(iterId);
+        iterSlot       = slot;
+        iterScopeIndex = scopeIndex;
     }
 
     Object getCurrent() const override {
         return globalStack[end];
     }
 
-    const std::string& getId() const override {
-        return iterIdentifier;
-    }
-
     //No need for this
     void recalcStep() override {}
 
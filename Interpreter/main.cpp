@@ -1,4 +1,5 @@
 #include <chrono>
+#include <cstring>
 
 #include "interpreter.hpp"
 #include "../Common/common.hpp"
@@ -9,12 +10,28 @@ int main(int argc, char** argv)
 
     std::ios::sync_with_stdio(false);
 
-    if(argc != 2) {
-        std::cout << "[USAGE]: .\\FluxInt [filename].cflx\n";
+    InterpreterOptions options;
+    const char*        filename = nullptr;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if(argv[i][0] != '-' && filename == nullptr)
+            filename = argv[i];
+        else if(std::strcmp(argv[i], "--lazy") == 0)
+            options.lazyPrepare = true;
+        else if(std::strcmp(argv[i], "--checksum") == 0)
+            options.verifyChecksum = true;
+        else {
+            std::cout << "[InterpreterError]: Unknown option: " << argv[i] << '\n';
+            std::exit(1);
+        }
+    }
+
+    if(filename == nullptr) {
+        std::cout << "[USAGE]: .\\FluxInt [--lazy] [--checksum] [filename].cflx\n";
         std::exit(1);
     }
 
-    const char* filename = argv[1];
     if(!checkFileExt(EXT, filename)) {
         std::cout << "[InterpreterError]: File must have a `" << EXT << "` extension: " << filename << '\n';
         std::exit(1);
@@ -22,7 +39,7 @@ int main(int argc, char** argv)
 
     auto start = std::chrono::high_resolution_clock::now();
 
-    ByteCodeInterpreter::getInstance().setFile(filename);
+    ByteCodeInterpreter::getInstance().setFile(filename, options);
     ByteCodeInterpreter::getInstance().interpret();
     
     //End of Compilation
@@ -0,0 +1,92 @@
+#include "mapped_file.hpp"
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+#ifdef _WIN32
+bool MappedFile::open(const char* filename)
+{
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+    if(!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+
+    //Mapping keeps its own reference to the file, handle isn't needed after this
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if(mapping == nullptr)
+        return false;
+
+    const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if(view == nullptr) {
+        CloseHandle(mapping);
+        return false;
+    }
+
+    mappingHandle = mapping;
+    mappedData    = view;
+    mappedSize    = static_cast<std::size_t>(fileSize.QuadPart);
+    return true;
+}
+
+void MappedFile::close()
+{
+    if(mappedData != nullptr)
+        UnmapViewOfFile(mappedData);
+    if(mappingHandle != nullptr)
+        CloseHandle(mappingHandle);
+
+    mappedData    = nullptr;
+    mappingHandle = nullptr;
+    mappedSize    = 0;
+}
+#else
+bool MappedFile::open(const char* filename)
+{
+    int fd = ::open(filename, O_RDONLY);
+    if(fd < 0)
+        return false;
+
+    struct stat fileInfo;
+    if(fstat(fd, &fileInfo) != 0 || fileInfo.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+
+    //Shared mapping, every FluxInt running the same file uses the same pages from page cache
+    void* view = mmap(nullptr, static_cast<std::size_t>(fileInfo.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(view == MAP_FAILED)
+        return false;
+
+    mappedData = view;
+    mappedSize = static_cast<std::size_t>(fileInfo.st_size);
+    return true;
+}
+
+void MappedFile::close()
+{
+    if(mappedData != nullptr)
+        munmap(const_cast<void*>(mappedData), mappedSize);
+
+    mappedData = nullptr;
+    mappedSize = 0;
+}
+#endif
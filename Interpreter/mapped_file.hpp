@@ -0,0 +1,33 @@
+/* Read only memory mapping of a whole file.
+ * Pages are shared with every other process mapping the same file, nothing is copied until its touched.
+*/
+#ifndef UNNAMED_MAPPED_FILE_HPP
+#define UNNAMED_MAPPED_FILE_HPP
+
+#include <cstddef>
+
+class MappedFile
+{
+    public:
+        MappedFile() = default;
+        ~MappedFile();
+
+        MappedFile(const MappedFile&)            = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        //Returns false if file can't be opened or mapped (empty file included)
+        bool        open(const char*);
+        void        close();
+
+        const void* data() const { return mappedData; }
+        std::size_t size() const { return mappedSize; }
+
+    private:
+        const void* mappedData = nullptr;
+        std::size_t mappedSize = 0;
+#ifdef _WIN32
+        void*       mappingHandle = nullptr;
+#endif
+};
+
+#endif
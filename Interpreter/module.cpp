@@ -0,0 +1,115 @@
+#include <cstring>
+
+#include "module.hpp"
+#include "..\Common\error_printer.hpp"
+
+//Section has to be inside of the file, aligned and made of whole records
+template<typename T>
+static void getSection(const char* base, std::size_t fileSize, const CflxSection& section, const T*& out, std::size_t& count)
+{
+    if(out != nullptr)
+        printRuntimeError("LoadingError", "Duplicate section of type ", section.type);
+
+    if(section.offset > fileSize || section.size > fileSize - section.offset)
+        printRuntimeError("LoadingError", "Section of type ", section.type, " is out of file bounds");
+    if(section.offset % CFLX_SECTION_ALIGNMENT != 0 || section.size % sizeof(T) != 0)
+        printRuntimeError("LoadingError", "Section of type ", section.type, " is misaligned");
+
+    out   = reinterpret_cast<const T*>(base + section.offset);
+    count = section.size / sizeof(T);
+}
+
+void loadModule(const void* data, std::size_t size, LoadedModule& module, bool verifyChecksum)
+{
+    const char* base = static_cast<const char*>(data);
+
+    if(size < sizeof(CflxHeader))
+        printRuntimeError("LoadingError", "File is too small to be a .cflx file");
+
+    const CflxHeader* header = reinterpret_cast<const CflxHeader*>(base);
+    if(std::memcmp(header->magic, CFLX_MAGIC, sizeof(CFLX_MAGIC)) != 0)
+        printRuntimeError("LoadingError", "Not a .cflx file (bad magic number)");
+
+    //Newer minor versions only add stuff we can skip, different major version we can't run at all
+    if(header->versionMajor != CFLX_VERSION_MAJOR)
+        printRuntimeError("LoadingError", "Unsupported .cflx version ", header->versionMajor, ".", header->versionMinor,
+                          ", interpreter supports ", CFLX_VERSION_MAJOR, ".x");
+
+    if(header->sectionCount > (size - sizeof(CflxHeader)) / sizeof(CflxSection))
+        printRuntimeError("LoadingError", "Section table is out of file bounds");
+
+    //Reads every page of the file, everything that could make the interpreter misbehave is checked without it anyway
+    if(verifyChecksum && cflxChecksum(base + sizeof(CflxHeader), size - sizeof(CflxHeader)) != header->checksum)
+        printRuntimeError("LoadingError", "Checksum mismatch, file is corrupted");
+
+    module.header = header;
+
+    const CflxSection* sections = reinterpret_cast<const CflxSection*>(base + sizeof(CflxHeader));
+    for (std::uint32_t i = 0; i < header->sectionCount; ++i)
+    {
+        const CflxSection& section = sections[i];
+        switch (section.type)
+        {
+            case CFLX_SECTION_CODE:
+                getSection(base, size, section, module.code, module.codeLength);
+                break;
+            case CFLX_SECTION_CONSTANT_POOL:
+                getSection(base, size, section, module.constants, module.constantCount);
+                break;
+            case CFLX_SECTION_STRING_TABLE:
+                getSection(base, size, section, module.strings, module.stringsSize);
+                break;
+            case CFLX_SECTION_FUNCTIONS:
+                getSection(base, size, section, module.functions, module.functionCount);
+                break;
+            case CFLX_SECTION_DEBUG_LINES:
+                getSection(base, size, section, module.lines, module.lineCount);
+                break;
+            case CFLX_SECTION_EXPORTS:
+                getSection(base, size, section, module.exports, module.exportCount);
+                break;
+            case CFLX_SECTION_COMPACT_CODE:
+                getSection(base, size, section, module.compactCode, module.compactCodeSize);
+                break;
+            //Anything unknown is from a newer minor version
+            default:
+                break;
+        }
+    }
+
+    //Compact files carry their code only in compact form, the other one would be ignored anyway
+    bool isCompact = header->flags & CFLX_FLAG_COMPACT_CODE;
+    if(isCompact && module.code != nullptr)
+        printRuntimeError("LoadingError", "Compact file has a normal code section");
+    if(!isCompact && module.compactCode != nullptr)
+        printRuntimeError("LoadingError", "Compact code section in a file without compact flag");
+
+    if((isCompact ? module.compactCode == nullptr : module.code == nullptr) || module.functions == nullptr || module.strings == nullptr)
+        printRuntimeError("LoadingError", "Missing code, function or string table section");
+    if(module.functionCount == 0)
+        printRuntimeError("LoadingError", "Function table has no main");
+    if(module.stringsSize == 0 || module.strings[module.stringsSize - 1] != '\0')
+        printRuntimeError("LoadingError", "String table is not '\\0' terminated");
+
+    for (std::size_t i = 0; i < module.constantCount; ++i)
+        if(module.constants[i].type != EVAL_INT && module.constants[i].type != EVAL_FLOAT)
+            printRuntimeError("LoadingError", "Constant ", i, " has unknown type ", (int)module.constants[i].type);
+
+    //Code itself is checked by verifier, where it sits and names are checked here for every function
+    for (std::size_t i = 0; i < module.functionCount; ++i)
+    {
+        const CflxFunction& function = module.functions[i];
+        if(function.nameOffset >= module.stringsSize)
+            printRuntimeError("LoadingError", "Function ", i, " has name out of string table");
+
+        //Compact length is only known once its decoded, it just has to start inside of compact code
+        bool outOfBounds = isCompact ? function.compactOffset >= module.compactCodeSize
+                                     : function.codeOffset > module.codeLength || function.codeLength > module.codeLength - function.codeOffset;
+        if(function.codeLength == 0 || outOfBounds)
+            printRuntimeError("LoadingError", "Function ", i, " is out of code bounds");
+    }
+
+    for (std::size_t i = 0; i < module.exportCount; ++i)
+        if(module.exports[i].nameOffset >= module.stringsSize || module.exports[i].functionIndex >= module.functionCount)
+            printRuntimeError("LoadingError", "Export ", i, " is out of range");
+}
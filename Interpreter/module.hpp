@@ -0,0 +1,38 @@
+/* Loaded (memory mapped) .cflx module, every pointer points straight into the mapping.
+ * loadModule checks the container (header, section table, where each function sits, optionally checksum), ByteCodeVerifier checks the code.
+*/
+#ifndef UNNAMED_MODULE_HPP
+#define UNNAMED_MODULE_HPP
+
+#include <cstddef>
+
+#include "..\Common\common.hpp"
+#include "..\Common\cflx_format.hpp"
+
+struct LoadedModule
+{
+    const CflxHeader*    header        = nullptr;
+    const VMInstruction* code          = nullptr;
+    std::size_t          codeLength    = 0;
+    const CflxConstant*  constants     = nullptr;
+    std::size_t          constantCount = 0;
+    const char*          strings       = nullptr;
+    std::size_t          stringsSize   = 0;
+    const CflxFunction*  functions     = nullptr;
+    std::size_t          functionCount = 0;
+    //Optional
+    const CflxLine*      lines         = nullptr;
+    std::size_t          lineCount     = 0;
+    const CflxExport*    exports       = nullptr;
+    std::size_t          exportCount   = 0;
+    //Only with CFLX_FLAG_COMPACT_CODE, code is null until its decoded
+    const char*          compactCode     = nullptr;
+    std::size_t          compactCodeSize = 0;
+
+    const char* getString(std::uint32_t offset) const { return strings + offset; }
+};
+
+//Exits with LoadingError if anything in the container is wrong, checksum of the whole file only if asked for
+void loadModule(const void*, std::size_t, LoadedModule&, bool verifyChecksum);
+
+#endif
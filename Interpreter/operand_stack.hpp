@@ -0,0 +1,51 @@
+/* Operand stack of the interpreter. Every function gets room for the deepest its stack can go (max stack depth
+ * from its descriptor, proven by verifier) the moment its called, pushing and popping never check anything after that.
+ * Only reserve() can move the values, nothing holds a reference to one across a call.
+*/
+#ifndef UNNAMED_OPERAND_STACK_HPP
+#define UNNAMED_OPERAND_STACK_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+class OperandStack
+{
+    public:
+        //Room for 'count' more values on top of whatever is on stack right now
+        void reserve(std::size_t count)
+        {
+            std::size_t used = size();
+            if(used + count <= storage.size())
+                return;
+
+            //Double it so deep recursion doesn't move everything on every call
+            storage.resize(std::max(used + count, storage.size() * 2));
+            base = storage.data();
+            top  = base + used;
+        }
+
+        template<typename T>
+        void emplace_back(T&& value) { *top++ = std::forward<T>(value); }
+        void push_back(const Object& value) { *top++ = value; }
+        void pop_back() { --top; }
+
+        Object&       back()       { return top[-1]; }
+        const Object& back() const { return top[-1]; }
+
+        Object&       operator[](std::size_t index)       { return base[index]; }
+        const Object& operator[](std::size_t index) const { return base[index]; }
+
+        std::size_t size()  const { return static_cast<std::size_t>(top - base); }
+        bool        empty() const { return top == base; }
+        //Only ever shrinks (vargs cleanup, builtins taking vargs)
+        void        resize(std::size_t newSize) { top = base + newSize; }
+
+    private:
+        std::vector<Object> storage;
+        Object*             base = nullptr;
+        Object*             top  = nullptr;
+};
+
+#endif
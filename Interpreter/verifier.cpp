@@ -0,0 +1,435 @@
+#include <climits>
+
+#include "verifier.hpp"
+
+std::size_t ByteCodeVerifier::verifyFunction(std::size_t descriptorIndex, const VMInstruction* body, std::size_t length)
+{
+    //Calls are checked against the callee descriptor, so nothing else has to be loaded for this
+    FunctionInfo info = collectFunctionInfo(descriptorIndex, body, length);
+
+    verifyOperands(info);
+    std::size_t maxDepth = verifyStackFlow(info);
+
+    //Compiler worked it out already, its proven to be enough by now. Files from before it did are sized by us
+    if(module.header->versionMinor >= CFLX_VERSION_MAX_STACK)
+        return module.functions[descriptorIndex].maxStack;
+    return maxDepth;
+}
+
+FunctionInfo ByteCodeVerifier::collectFunctionInfo(std::size_t descriptorIndex, const VMInstruction* body, std::size_t length)
+{
+    const CflxFunction& descriptor = module.functions[descriptorIndex];
+
+    if(length == 0)
+        printRuntimeError("VerificationError", "Function ", descriptorIndex, " has no code");
+
+    FunctionInfo info;
+    info.body            = body;
+    info.length          = length;
+    info.descriptorIndex = descriptorIndex;
+    info.isMain          = descriptorIndex == 0;
+
+    currentFunction = &info;
+    currentIndex    = 0;
+
+    //Function ends with FUNC_END, main with END_OF_FILE
+    currentIndex = info.length - 1;
+    if(info.body[currentIndex].inst != (info.isMain ? END_OF_FILE : FUNC_END))
+        reject("Expected ", info.isMain ? "END_OF_FILE" : "FUNC_END", " as the last instruction");
+
+    //Frame is allocated by the very first instruction, every slot is checked against this
+    currentIndex = 0;
+    if(info.body[0].inst != ALLOC_FRAME)
+        reject("Expected ALLOC_FRAME as the first instruction");
+    info.frameSize = info.body[0].operand.u16;
+
+    if(!info.isMain)
+    {
+        //Params are assigned to slots 0..N-1 right after ALLOC_FRAME, in order
+        for (std::size_t i = 1; i < info.length; ++i)
+        {
+            const VMInstruction& inst = info.body[i];
+            if(inst.inst != ASSIGN_VAR || inst.scopeIndex != LOCAL_FRAME || inst.operand.u16 != info.paramCount)
+                break;
+            ++info.paramCount;
+        }
+
+        currentIndex = info.length - 1;
+        if(info.body[currentIndex].operand.u16 > EVAL_UNKNOWN)
+            reject("Invalid vargs type: ", info.body[currentIndex].operand.u16);
+        info.hasVargs = info.body[currentIndex].operand.u16 != EVAL_UNKNOWN;
+    }
+
+    //Descriptor has to agree with the code itself
+    if(descriptor.frameSize != info.frameSize || descriptor.paramCount != info.paramCount
+       || descriptor.vargsType != (info.isMain ? static_cast<std::uint16_t>(EVAL_UNKNOWN) : info.body[info.length - 1].operand.u16))
+        reject("Function descriptor doesn't match the code");
+
+    for (std::size_t i = 0; i < info.length; ++i)
+        if(info.body[i].inst == RETURN && (info.body[i].operand.u64 & RETURN_VALUE_BIT))
+            info.returnsValue = true;
+
+    //Callers trust this flag for USE_RETURN_VAL
+    if(info.returnsValue != static_cast<bool>(descriptor.flags & CFLX_FUNCTION_RETURNS_VALUE))
+        reject("Function descriptor doesn't match the code");
+
+    currentFunction = nullptr;
+    return info;
+}
+
+//Checks which don't depend on the path taken to reach the instruction
+void ByteCodeVerifier::verifyOperands(const FunctionInfo& info)
+{
+    currentFunction = &info;
+
+    const VMInstruction* body   = info.body;
+    const std::size_t    length = info.length;
+    const bool           isMain = info.isMain;
+
+    for (currentIndex = 0; currentIndex < length; ++currentIndex)
+    {
+        const VMInstruction& i = body[currentIndex];
+
+        //We wouldn't even know what the operand means
+        if(i.inst > END_OF_FILE)
+            reject("Unknown instruction: ", (int)i.inst);
+
+        //Operands meaning the same thing for every instruction using them
+        switch (opcodeInfo(i.inst).operand)
+        {
+            case OPERAND_SLOT:
+                verifySlot(i);
+                break;
+            case OPERAND_TARGET:
+                if(i.operand.u64 >= length)
+                    reject("Jump target out of range: ", i.operand.u64);
+                break;
+            default:
+                break;
+        }
+
+        switch (i.inst)
+        {
+            case ALLOC_FRAME:
+                if(currentIndex != 0)
+                    reject("ALLOC_FRAME is only allowed as the first instruction");
+                break;
+
+            case END_OF_FILE:
+            case FUNC_END:
+                if(currentIndex != length - 1)
+                    reject(ILInstructionToString(i.inst), " is only allowed as the last instruction");
+                break;
+
+            case RETURN:
+                if(isMain)
+                    reject("RETURN outside of a function");
+                //Always jumps to FUNC_END of the same function, it cleans up the frame
+                if((i.operand.u64 & ~RETURN_VALUE_BIT) != length - 1)
+                    reject("RETURN must jump to FUNC_END, got: ", i.operand.u64 & ~RETURN_VALUE_BIT);
+                break;
+
+            case FUNC_CALL:
+                //Main can't be called
+                if(i.operand.u64 == 0 || i.operand.u64 >= module.functionCount)
+                    reject("Call to unknown function ", i.operand.u64);
+                break;
+
+            case PUSH_CONST:
+                if(i.operand.u32 >= module.constantCount)
+                    reject("Constant index out of range: ", i.operand.u32);
+                break;
+
+            case BUILTIN_CALL:
+                if(i.operand.u16 >= BUILTIN_COUNT)
+                    reject("Unknown builtin: ", i.operand.u16);
+                break;
+
+            case MUL_POW2:
+            case DIV_POW2:
+            case MOD_POW2:
+                if(i.operand.u16 == 0 || i.operand.u16 >= sizeof(std::int64_t) * CHAR_BIT)
+                    reject("Shift amount out of range: ", i.operand.u16);
+                break;
+
+            case ITER_INIT:
+            {
+                //Iterator writes to the slot given by DATAINST_ITER_ID right before it
+                if(currentIndex == 0 || body[currentIndex - 1].inst != DATAINST_ITER_ID)
+                    reject("ITER_INIT must come right after DATAINST_ITER_ID");
+
+                std::uint8_t iterType  = (i.operand.u16 & 0xFF00) >> 8;
+                std::uint8_t identType = (i.operand.u16 & 0x00FF);
+
+                if(iterType != RANGE_ITERATOR && iterType != ELLIPSIS_ITERATOR)
+                    reject("Unknown iterator type: ", (int)iterType);
+                if(identType != EVAL_AUTO && identType != EVAL_INT && identType != EVAL_FLOAT)
+                    reject("Unknown iterator identifier type: ", (int)identType);
+                //Ellipsis iterator walks over vargs of the current call
+                if(iterType == ELLIPSIS_ITERATOR && !info.hasVargs)
+                    reject("Ellipsis iterator used in a function without vargs");
+            }
+            break;
+
+            case USE_RETURN_VAL:
+            {
+                //Return register only holds something meaningful right after a call to function returning a value
+                if(currentIndex == 0 || body[currentIndex - 1].inst != FUNC_CALL)
+                    reject("USE_RETURN_VAL must come right after FUNC_CALL");
+
+                const CflxFunction& callee = module.functions[body[currentIndex - 1].operand.u64];
+                if(!(callee.flags & CFLX_FUNCTION_RETURNS_VALUE))
+                    reject("USE_RETURN_VAL after a call to function which never returns a value");
+            }
+            break;
+
+            case FUNC_START:
+                reject("FUNC_START can't be inside of a function body");
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    currentFunction = nullptr;
+}
+
+void ByteCodeVerifier::verifySlot(const VMInstruction& i)
+{
+    const bool isMain = currentFunction->isMain;
+
+    switch (i.scopeIndex)
+    {
+        case GLOBAL_FRAME:
+            //Main is always verified first, so its frame size is already checked against its code
+            if(i.operand.u16 >= module.functions[0].frameSize)
+                reject("Global slot ", i.operand.u16, " out of range, frame size is ", module.functions[0].frameSize);
+            break;
+        case LOCAL_FRAME:
+            if(isMain)
+                reject("Local variable accessed outside of a function");
+            if(i.operand.u16 >= currentFunction->frameSize)
+                reject("Local slot ", i.operand.u16, " out of range, frame size is ", currentFunction->frameSize);
+            break;
+        default:
+            reject("Unknown frame type: ", i.scopeIndex);
+    }
+}
+
+//Walks every path through the function once, stack state has to be identical wherever two paths meet
+std::size_t ByteCodeVerifier::verifyStackFlow(const FunctionInfo& info)
+{
+    currentFunction = &info;
+
+    std::vector<std::optional<AbstractState>> states(info.length);
+    std::vector<std::size_t>                  worklist;
+
+    //Caller pushed params (vargs and return address are below, function never sees them)
+    AbstractState entry;
+    entry.stack.assign(info.paramCount, AbstractEntry{AbstractEntryKind::Value, 0});
+
+    currentIndex = 0;
+    mergeState(states, worklist, 0, entry);
+
+    //Deepest the stack gets and where
+    std::size_t maxDepth = entry.stack.size(), deepestIndex = 0;
+
+    std::vector<std::size_t> successors;
+    while(!worklist.empty())
+    {
+        currentIndex = worklist.back();
+        worklist.pop_back();
+
+        AbstractState state = *states[currentIndex];
+        successors.clear();
+
+        applyInstruction(info, currentIndex, state, successors);
+        if(state.stack.size() > maxDepth) {
+            maxDepth     = state.stack.size();
+            deepestIndex = currentIndex;
+        }
+
+        for (auto &&successor : successors)
+            mergeState(states, worklist, successor, state);
+    }
+
+    //Interpreter only makes room for what the descriptor says
+    const CflxFunction& descriptor = module.functions[info.descriptorIndex];
+    if(module.header->versionMinor >= CFLX_VERSION_MAX_STACK && maxDepth > descriptor.maxStack) {
+        currentIndex = deepestIndex;
+        reject("Stack gets ", maxDepth, " deep, function descriptor only has room for ", descriptor.maxStack);
+    }
+
+    currentFunction = nullptr;
+    return maxDepth;
+}
+
+void ByteCodeVerifier::mergeState(std::vector<std::optional<AbstractState>>& states, std::vector<std::size_t>& worklist,
+                                  std::size_t target, const AbstractState& state)
+{
+    if(!states[target]) {
+        states[target] = state;
+        worklist.emplace_back(target);
+        return;
+    }
+
+    if(*states[target] != state)
+        reject("Inconsistent stack at jump target ", target, " (depth ", states[target]->stack.size(),
+               " vs ", state.stack.size(), ", iterators ", states[target]->iteratorDepth, " vs ", state.iteratorDepth, ")");
+}
+
+void ByteCodeVerifier::applyInstruction(const FunctionInfo& info, std::size_t index, AbstractState& state, std::vector<std::size_t>& successors)
+{
+    const VMInstruction& i  = info.body[index];
+    const OpcodeInfo&    op = opcodeInfo(i.inst);
+    const AbstractEntry value{AbstractEntryKind::Value, 0};
+
+    //Internal data, iterators and stack effects depending on the operand, everything else comes from the opcode table
+    switch (i.inst)
+    {
+        case PUSH_UINT64:
+            state.stack.push_back(AbstractEntry{AbstractEntryKind::Constant, i.operand.u64});
+            break;
+
+        //Iterators
+        case ITER_INIT:
+        {
+            //Range iterator takes start, stop, step from stack
+            std::uint8_t iterType = (i.operand.u16 & 0xFF00) >> 8;
+            if(iterType == RANGE_ITERATOR)
+                popValues(state, 3);
+            ++state.iteratorDepth;
+        }
+        break;
+        case ITER_HAS_NEXT:
+        case ITER_NEXT:
+        case ITER_CURRENT:
+        case ITER_RECALC_STEP:
+            requireIterator(state);
+            break;
+        case ITER_END:
+            requireIterator(state);
+            --state.iteratorDepth;
+            break;
+
+        //Functions
+        case FUNC_VARGS:
+            state.stack.push_back(AbstractEntry{AbstractEntryKind::VargsCount, i.operand.u64});
+            break;
+        case FUNC_CALL:
+        {
+            const CflxFunction& callee = module.functions[i.operand.u64];
+
+            //Layout (top to bottom): params, vargs, vargs count, return address
+            popValues(state, callee.paramCount);
+            if(callee.vargsType != EVAL_UNKNOWN)
+            {
+                //Vargs values first, their count tells how many
+                std::size_t nVargs = 0;
+                while(!state.stack.empty() && state.stack.back().kind == AbstractEntryKind::Value) {
+                    state.stack.pop_back();
+                    ++nVargs;
+                }
+
+                AbstractEntry count = popEntry(state);
+                if(count.kind != AbstractEntryKind::VargsCount || count.constant != nVargs)
+                    reject("Vargs count doesn't match number of arguments passed");
+            }
+
+            //FUNC_END of callee jumps to this
+            AbstractEntry returnAddress = popEntry(state);
+            if(returnAddress.kind != AbstractEntryKind::Constant || returnAddress.constant != index + 1)
+                reject("Expected return address ", index + 1, " below function arguments");
+        }
+        break;
+        case BUILTIN_CALL:
+        {
+            const BuiltinSignature& builtin = builtinSignatures[i.operand.u16];
+            if(builtin.argCount == BUILTIN_VARGS)
+            {
+                AbstractEntry count = popEntry(state);
+                if(count.kind != AbstractEntryKind::Constant)
+                    reject("Expected argument count for builtin taking vargs");
+                popValues(state, count.constant);
+            }
+            else
+                popValues(state, builtin.argCount);
+
+            if(builtin.returnsValue)
+                state.stack.push_back(value);
+        }
+        break;
+        case RETURN:
+            if(i.operand.u64 & RETURN_VALUE_BIT)
+                popValues(state, 1);
+            break;
+        case FUNC_END:
+            if(!state.stack.empty() || state.iteratorDepth != 0)
+                reject("Function leaves ", state.stack.size(), " values and ", state.iteratorDepth, " iterators behind");
+            break;
+        case FUNC_START:
+            reject("Unexpected instruction");
+            break;
+
+        default:
+            popValues(state, op.pops);
+            state.stack.insert(state.stack.end(), op.pushes, value);
+    }
+
+    //Last instruction is always a terminal so falling through is always in range
+    switch (op.branch)
+    {
+        case BRANCH_NONE:
+            successors.push_back(index + 1);
+            break;
+        case BRANCH_CONDITIONAL:
+            successors.push_back(i.operand.u64);
+            successors.push_back(index + 1);
+            break;
+        case BRANCH_ALWAYS:
+            successors.push_back(i.operand.u64);
+            break;
+        case BRANCH_RETURN:
+            successors.push_back(i.operand.u64 & ~RETURN_VALUE_BIT);
+            break;
+        case BRANCH_END:
+            break;
+    }
+}
+
+void ByteCodeVerifier::popValues(AbstractState& state, std::size_t n)
+{
+    for (std::size_t i = 0; i < n; ++i)
+        if(popEntry(state).kind != AbstractEntryKind::Value)
+            reject("Expected a value on stack, found internal data (return address / argument count)");
+}
+
+AbstractEntry ByteCodeVerifier::popEntry(AbstractState& state)
+{
+    if(state.stack.empty())
+        reject("Stack underflow");
+
+    AbstractEntry entry = state.stack.back();
+    state.stack.pop_back();
+    return entry;
+}
+
+void ByteCodeVerifier::requireIterator(const AbstractState& state)
+{
+    if(state.iteratorDepth == 0)
+        reject("No active iterator");
+}
+
+template<typename... Args>
+void ByteCodeVerifier::reject(Args&&... args)
+{
+    const char* inst = currentIndex < currentFunction->length && currentFunction->body[currentIndex].inst <= END_OF_FILE
+                           ? ILInstructionToString(currentFunction->body[currentIndex].inst) : "?";
+
+    if(currentFunction->isMain)
+        printRuntimeError("VerificationError", "In main, instruction ", currentIndex, " (", inst, "): ", std::forward<Args>(args)...);
+    else
+        printRuntimeError("VerificationError", "In function '", module.getString(module.functions[currentFunction->descriptorIndex].nameOffset),
+                          "', instruction ", currentIndex, " (", inst, "): ", std::forward<Args>(args)...);
+}
@@ -0,0 +1,99 @@
+/* Bytecode verifier, runs once per function (and main) before the first time it gets executed.
+ * For every function it proves that jump targets are in range, stack depth is the same
+ * no matter which path reaches an instruction, operands are valid for their opcode, builtin ids exist
+ * and every variable slot lives inside of its frame, and the stack never gets deeper than the descriptor says.
+ * If any of it fails the file is rejected.
+ * Interpreter relies on all of this and runs without checking anything itself.
+*/
+#ifndef UNNAMED_VERIFIER_HPP
+#define UNNAMED_VERIFIER_HPP
+
+#include <vector>
+#include <optional>
+
+#include "interpreter.hpp"
+#include "module.hpp"
+
+//What we know about a single stack entry without running anything
+enum class AbstractEntryKind : std::uint8_t
+{
+    Value,      //Int / Float, anything user code can touch
+    Constant,   //PUSH_UINT64, return address or builtin vargs count
+    VargsCount  //FUNC_VARGS, number of vargs passed to a function
+};
+
+struct AbstractEntry
+{
+    AbstractEntryKind kind;
+    std::uint64_t     constant; //Unused for Value
+
+    bool operator==(const AbstractEntry& other) const {
+        return kind == other.kind && (kind == AbstractEntryKind::Value || constant == other.constant);
+    }
+    bool operator!=(const AbstractEntry& other) const { return !(*this == other); }
+};
+
+//Stack and iterator stack as seen by a single function (relative to where the function started)
+struct AbstractState
+{
+    std::vector<AbstractEntry> stack;
+    std::size_t                iteratorDepth = 0;
+
+    bool operator==(const AbstractState& other) const {
+        return iteratorDepth == other.iteratorDepth && stack == other.stack;
+    }
+    bool operator!=(const AbstractState& other) const { return !(*this == other); }
+};
+
+struct FunctionInfo
+{
+    const VMInstruction* body;
+    std::size_t          length;
+    std::size_t          descriptorIndex; //What FUNC_CALL uses
+    bool                 isMain        = false;
+    std::uint16_t        frameSize     = 0;
+    std::uint16_t        paramCount    = 0;
+    bool                 hasVargs      = false;
+    bool                 returnsValue  = false;
+};
+
+class ByteCodeVerifier
+{
+    public:
+        ByteCodeVerifier(const LoadedModule& module)
+            : module(module)
+        {}
+
+        //Exits with VerificationError if anything is wrong, code is never modified (it may be mapped read only).
+        //Function at index 0 (main) has to be verified before any other one.
+        //Returns how many stack entries the function needs (params included), never less than it actually uses
+        std::size_t verifyFunction(std::size_t, const VMInstruction*, std::size_t);
+
+    private:
+        FunctionInfo collectFunctionInfo(std::size_t, const VMInstruction*, std::size_t);
+        void         verifyOperands(const FunctionInfo&);
+        std::size_t  verifyStackFlow(const FunctionInfo&);
+
+    //Stack flow helpers
+    private:
+        void          applyInstruction(const FunctionInfo&, std::size_t, AbstractState&, std::vector<std::size_t>&);
+        void          popValues(AbstractState&, std::size_t);
+        AbstractEntry popEntry(AbstractState&);
+        void          requireIterator(const AbstractState&);
+        void          mergeState(std::vector<std::optional<AbstractState>>&, std::vector<std::size_t>&,
+                                 std::size_t, const AbstractState&);
+
+    private:
+        void verifySlot(const VMInstruction&);
+        template<typename... Args>
+        void reject(Args&&...);
+
+    private:
+        const LoadedModule& module;
+
+        //For error messages
+        const FunctionInfo* currentFunction = nullptr;
+        std::size_t         currentIndex    = 0;
+};
+
+#endif